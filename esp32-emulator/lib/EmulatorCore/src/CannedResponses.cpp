@@ -0,0 +1,22 @@
+#include "CannedResponses.h"
+#include <string.h>
+
+void CannedResponses::build(UnitreeCodec& codec) {
+    for (uint8_t instruction = 1; instruction <= CANNED_MAX_INSTRUCTION; instruction++) {
+        for (uint8_t status = 0; status <= 1; status++) {
+            codec.encodeResponse(instruction, &status, 1,
+                                 statusFrames[instruction][status], CANNED_STATUS_FRAME);
+        }
+    }
+
+    uint8_t payload[CANNED_SERIAL_PAYLOAD];
+    serialPayload(payload);
+    codec.encodeResponse(INSTR_GET_SERIAL, payload, sizeof(payload), serialFrame, sizeof(serialFrame));
+}
+
+void CannedResponses::serialPayload(uint8_t* out) {
+    // Whole serial in one chunk
+    out[0] = 0x01; // Chunk 1
+    out[1] = 0x01; // Total 1 chunk
+    memcpy(out + 2, SERIAL_NUMBER, sizeof(SERIAL_NUMBER) - 1);
+}
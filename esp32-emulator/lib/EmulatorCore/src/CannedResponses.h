@@ -0,0 +1,104 @@
+/**
+ * Canned emulator replies
+ *
+ * Every status reply (ack 0x01 / nack 0x00 per instruction) and the serial
+ * number frame are fixed, and the key and IV never change, so their
+ * ciphertexts are built once at boot. Replying is then a notify straight
+ * from this table.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <UnitreeCodec.h>
+
+// Canned serial number returned by instruction 2
+#ifndef SERIAL_NUMBER
+#define SERIAL_NUMBER "ESP32-EMULATOR-v1.0-TESTDEVICE"
+#endif
+
+// Set to 0 to rebuild and re-encrypt every reply (for latency comparisons)
+#ifndef CANNED_RESPONSES
+#define CANNED_RESPONSES 1
+#endif
+
+#define CANNED_MAX_INSTRUCTION  INSTR_SET_COUNTRY
+#define CANNED_STATUS_FRAME     (FRAME_OVERHEAD + 1)
+// [chunk_index, total_chunks, serial...]
+#define CANNED_SERIAL_PAYLOAD   (2 + sizeof(SERIAL_NUMBER) - 1)
+#define CANNED_SERIAL_FRAME     (FRAME_OVERHEAD + CANNED_SERIAL_PAYLOAD)
+
+// Scratch space for a reply; fits the serial split into 1-byte chunks
+#define REPLY_MAX_SIZE 512
+static_assert((sizeof(SERIAL_NUMBER) - 1) * (FRAME_OVERHEAD + 3) <= REPLY_MAX_SIZE,
+              "REPLY_MAX_SIZE too small for a fully chunked serial");
+
+// Encrypted reply: points at a canned frame or the caller's scratch buffer.
+// Chunked replies are frames packed back to back, each frameSize bytes
+// except a shorter last one; frameSize 0 means a single frame. The fault
+// fields are only set by the fault injector; masks cover the first 32 frames.
+struct Response {
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    size_t frameSize = 0;
+    uint32_t delayMs = 0;         // hold the reply (or the session) this long
+    uint32_t dropMask = 0;        // frame i is not sent
+    uint32_t duplicateMask = 0;   // frame i is sent twice
+    bool reversed = false;        // frames go out last first
+
+    Response() = default;
+    Response(const uint8_t* data, size_t len, size_t frameSize = 0)
+        : data(data), len(len), frameSize(frameSize) {}
+
+    size_t frames() const {
+        if (len == 0) return 0;
+        return frameSize == 0 ? 1 : (len + frameSize - 1) / frameSize;
+    }
+
+    // Frame i in layout order
+    const uint8_t* frame(size_t i) const { return data + i * (frameSize ? frameSize : len); }
+    size_t frameLength(size_t i) const {
+        size_t step = frameSize ? frameSize : len;
+        return len - i * step < step ? len - i * step : step;
+    }
+
+    // Calls send(data, len) for each frame in transmit order, applying the
+    // fault fields
+    template<typename Send>
+    void forEachFrame(Send send) const {
+        size_t count = frames();
+        for (size_t n = 0; n < count; n++) {
+            size_t i = reversed ? count - 1 - n : n;
+            uint32_t bit = i < 32 ? 1UL << i : 0;
+            if (dropMask & bit) continue;
+            send(frame(i), frameLength(i));
+            if (duplicateMask & bit) send(frame(i), frameLength(i));
+        }
+    }
+};
+
+class CannedResponses {
+public:
+    // Encrypt every canned frame; call once after codec.begin()
+    void build(UnitreeCodec& codec);
+
+    // Status reply for instruction, status 0x01 success or 0x00 failure
+    Response status(uint8_t instruction, uint8_t status) const {
+        if (instruction == 0 || instruction > CANNED_MAX_INSTRUCTION || status > 1) {
+            return Response();
+        }
+        return Response(statusFrames[instruction][status], CANNED_STATUS_FRAME);
+    }
+
+    Response serial() const {
+        return Response(serialFrame, CANNED_SERIAL_FRAME);
+    }
+
+    // Serial reply payload for the single-chunk case
+    static void serialPayload(uint8_t* out);
+
+private:
+    uint8_t statusFrames[CANNED_MAX_INSTRUCTION + 1][2][CANNED_STATUS_FRAME];
+    uint8_t serialFrame[CANNED_SERIAL_FRAME];
+};
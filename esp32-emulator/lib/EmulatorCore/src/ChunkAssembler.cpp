@@ -0,0 +1,83 @@
+#include "ChunkAssembler.h"
+#include <string.h>
+
+void ChunkAssembler::reset() {
+    receivedMask = 0;
+    totalChunks = 0;
+    receivedCount = 0;
+    stride = 0;
+    finalLen = 0;
+    finalParked = false;
+    length = 0;
+    complete = false;
+}
+
+// Move a final chunk that arrived before any other to its real offset
+void ChunkAssembler::parkFinal() {
+    if (!finalParked) return;
+    memmove(slab + (size_t)(totalChunks - 1) * stride,
+            slab + REASSEMBLY_MAX_BYTES - finalLen, finalLen);
+    finalParked = false;
+}
+
+ChunkResult ChunkAssembler::add(uint8_t index, uint8_t total, const uint8_t* data, size_t len) {
+    if (complete || (receivedCount > 0 && total != totalChunks)) {
+        reset();
+    }
+    if (total == 0 || total > REASSEMBLY_MAX_CHUNKS || index == 0 || index > total) {
+        reset();
+        return CHUNK_REJECTED;
+    }
+
+    uint32_t bit = 1UL << (index - 1);
+    if (receivedMask & bit) {
+        return CHUNK_DUPLICATE;
+    }
+    totalChunks = total;
+
+    size_t offset;
+    if (index < total) {
+        if (len == 0 || (stride != 0 && len != stride)) {
+            reset();
+            return CHUNK_REJECTED;
+        }
+        stride = len;
+        // The whole field, final chunk included, must fit once stride is fixed
+        size_t end = (size_t)(total - 1) * stride + ((receivedMask >> (total - 1)) & 1 ? finalLen : 0);
+        if (end > REASSEMBLY_MAX_BYTES) {
+            reset();
+            return CHUNK_REJECTED;
+        }
+        parkFinal();
+        offset = (size_t)(index - 1) * stride;
+    } else {
+        if (len > REASSEMBLY_MAX_BYTES) {
+            reset();
+            return CHUNK_REJECTED;
+        }
+        if (total == 1) {
+            offset = 0;
+        } else if (stride != 0) {
+            offset = (size_t)(total - 1) * stride;
+        } else {
+            offset = REASSEMBLY_MAX_BYTES - len;
+            finalParked = true;
+        }
+        if (offset + len > REASSEMBLY_MAX_BYTES) {
+            reset();
+            return CHUNK_REJECTED;
+        }
+        finalLen = len;
+    }
+
+    memcpy(slab + offset, data, len);
+    receivedMask |= bit;
+    receivedCount++;
+
+    if (receivedCount < totalChunks) {
+        return CHUNK_STORED;
+    }
+    length = (size_t)(totalChunks - 1) * stride + finalLen;
+    complete = true;
+    return CHUNK_COMPLETE;
+}
@@ -0,0 +1,70 @@
+/**
+ * Chunked field reassembly
+ *
+ * SSID and password arrive as [chunk_index, total_chunks, data...] frames,
+ * 1-based, every chunk but the last the same size. Each chunk is copied
+ * straight to its offset in a fixed slab and marked in a bitmap, so
+ * retransmits and out-of-order delivery are handled without any heap use.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest reassembled field; SSIDs and WPA passphrases need far less
+#ifndef REASSEMBLY_MAX_BYTES
+#define REASSEMBLY_MAX_BYTES 256
+#endif
+
+// Chunks tracked per field (bits in the received mask)
+#define REASSEMBLY_MAX_CHUNKS 32
+
+// A partial field this long without a new chunk is discarded
+#ifndef REASSEMBLY_TIMEOUT_MS
+#define REASSEMBLY_TIMEOUT_MS 5000
+#endif
+
+enum ChunkResult : uint8_t {
+    CHUNK_STORED,     // accepted, more chunks outstanding
+    CHUNK_DUPLICATE,  // already have this index; ignored
+    CHUNK_COMPLETE,   // last missing chunk; data()/size() hold the field
+    CHUNK_REJECTED    // bad index/total, size mismatch or overflow; state reset
+};
+
+class ChunkAssembler {
+public:
+    void reset();
+
+    // Place one chunk. A total that differs from the sequence in progress,
+    // or any chunk after completion, starts a new sequence.
+    ChunkResult add(uint8_t index, uint8_t total, const uint8_t* data, size_t len);
+
+    // Reassembled field, valid after CHUNK_COMPLETE until the next add()
+    const uint8_t* data() const { return slab; }
+    size_t size() const { return complete ? length : 0; }
+
+    uint8_t received() const { return receivedCount; }
+    uint8_t total() const { return totalChunks; }
+
+    // Some chunks in, the field not yet complete
+    bool partial() const { return receivedCount > 0 && !complete; }
+
+    // Caller's timestamp of the latest chunk, for reassembly timeouts
+    void touch(uint32_t nowMs) { lastChunkMs = nowMs; }
+    uint32_t idleMs(uint32_t nowMs) const { return nowMs - lastChunkMs; }
+
+private:
+    void parkFinal();
+
+    uint8_t slab[REASSEMBLY_MAX_BYTES];
+    uint32_t receivedMask = 0;
+    uint8_t totalChunks = 0;
+    uint8_t receivedCount = 0;
+    size_t stride = 0;       // data bytes in every non-final chunk
+    size_t finalLen = 0;     // data bytes in the final chunk
+    bool finalParked = false;  // final chunk held at the slab tail until stride is known
+    size_t length = 0;
+    bool complete = false;
+    uint32_t lastChunkMs = 0;
+};
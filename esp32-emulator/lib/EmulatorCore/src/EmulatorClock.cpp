@@ -0,0 +1,58 @@
+#include "EmulatorClock.h"
+
+static VirtualClock defaultClock;
+static EmulatorClock* currentClock = &defaultClock;
+
+EmulatorClock& emulatorClock() {
+    return *currentClock;
+}
+
+void setEmulatorClock(EmulatorClock& clock) {
+    currentClock = &clock;
+}
+
+bool VirtualClock::callAfter(uint32_t ms, TimerCallback callback, void* context) {
+    if (timerCount == VIRTUAL_TIMER_SLOTS) return false;
+    timers[timerCount++] = {nowUs + (uint64_t)ms * 1000, nextOrder++, callback, context};
+    return true;
+}
+
+int VirtualClock::earliest() const {
+    int best = -1;
+    for (size_t i = 0; i < timerCount; i++) {
+        const Timer& timer = timers[i];
+        if (best < 0 || timer.deadlineUs < timers[best].deadlineUs ||
+            (timer.deadlineUs == timers[best].deadlineUs && (int32_t)(timer.order - timers[best].order) < 0)) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+// Remove the timer before running it, so the callback may reschedule
+void VirtualClock::fire(int slot) {
+    Timer timer = timers[slot];
+    timers[slot] = timers[--timerCount];
+    if (timer.deadlineUs > nowUs) nowUs = timer.deadlineUs;
+    timer.callback(timer.context);
+}
+
+void VirtualClock::advanceTo(uint64_t us) {
+    for (;;) {
+        int slot = earliest();
+        if (slot < 0 || timers[slot].deadlineUs > us) break;
+        fire(slot);
+    }
+    if (us > nowUs) nowUs = us;
+}
+
+void VirtualClock::advanceUs(uint64_t us) {
+    advanceTo(nowUs + us);
+}
+
+bool VirtualClock::runNext() {
+    int slot = earliest();
+    if (slot < 0) return false;
+    fire(slot);
+    return true;
+}
@@ -0,0 +1,79 @@
+/**
+ * Injectable time source and one-shot scheduler
+ *
+ * Everything the emulator does with time (timestamps, injected delays,
+ * timeouts, deferred work) goes through emulatorClock(). The firmware
+ * installs a clock on Arduino/FreeRTOS time; host tools use a
+ * VirtualClock, where time only moves when something sleeps or the
+ * caller advances it, so sessions with timeouts and retries simulate
+ * hours of traffic as fast as the CPU allows.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*TimerCallback)(void* context);
+
+class EmulatorClock {
+public:
+    virtual ~EmulatorClock() {}
+
+    // Free-running counters; wrap like Arduino's micros() and millis()
+    virtual uint32_t micros() = 0;
+    virtual uint32_t millis() = 0;
+
+    // Block the calling task for ms
+    virtual void sleep(uint32_t ms) = 0;
+
+    // Run callback once, ms from now, on the clock's timer context.
+    // False when no timer slot is free.
+    virtual bool callAfter(uint32_t ms, TimerCallback callback, void* context) = 0;
+};
+
+// The clock in use; a VirtualClock until setEmulatorClock() is called
+EmulatorClock& emulatorClock();
+void setEmulatorClock(EmulatorClock& clock);
+
+// Pending timers per VirtualClock
+#define VIRTUAL_TIMER_SLOTS 32
+
+class VirtualClock: public EmulatorClock {
+public:
+    uint32_t micros() override { return (uint32_t)nowUs; }
+    uint32_t millis() override { return (uint32_t)(nowUs / 1000); }
+
+    // Advances virtual time, firing any timers that fall due on the way
+    void sleep(uint32_t ms) override { advanceUs((uint64_t)ms * 1000); }
+
+    bool callAfter(uint32_t ms, TimerCallback callback, void* context) override;
+
+    // Move time forward by us, firing due timers in deadline order (ties
+    // in scheduling order); a timer may schedule further timers
+    void advanceUs(uint64_t us);
+    void advanceTo(uint64_t us);
+
+    // Jump to the earliest pending timer and fire it; false if none
+    bool runNext();
+
+    uint64_t elapsedUs() const { return nowUs; }
+    size_t pending() const { return timerCount; }
+
+private:
+    struct Timer {
+        uint64_t deadlineUs;
+        uint32_t order;
+        TimerCallback callback;
+        void* context;
+    };
+
+    // Index of the earliest timer, or -1
+    int earliest() const;
+    void fire(int slot);
+
+    Timer timers[VIRTUAL_TIMER_SLOTS] = {};
+    size_t timerCount = 0;
+    uint32_t nextOrder = 0;
+    uint64_t nowUs = 0;
+};
@@ -0,0 +1,409 @@
+#include "EmulatorCore.h"
+#include "InjectionDetector.h"
+#include <stdio.h>
+#include <string.h>
+
+// Log level for this file (-DLOG_LEVEL_CORE=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_CORE
+#define LOG_LEVEL_CORE LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_CORE
+
+// One session per connected client
+SessionPool sessions;
+
+// Shared frame codec (AES-CFB128 + checksum)
+UnitreeCodec codec;
+
+// Fixed replies, encrypted once at boot
+CannedResponses canned;
+
+// Off unless FAULT_PROFILE or a runtime profile enables it
+FaultInjector faults;
+
+// Off unless PEER_GUARD_PROFILE or a runtime profile enables it
+PeerGuard peerGuard;
+
+// Off until the firmware (or a host tool) calls begin()
+SessionTrace sessionTrace;
+
+// Counters behind the statistics characteristic
+ProtocolStats protocolStats;
+
+void initCrypto() {
+    codec.begin();
+    canned.build(codec);
+    faults.configure(FAULT_PROFILE);
+    peerGuard.configure(PEER_GUARD_PROFILE);
+}
+
+// Create encrypted response packet in out (FRAME_MAX_SIZE bytes)
+size_t createResponse(uint8_t instruction, const uint8_t* data, size_t len, uint8_t* out) {
+    return codec.encodeResponse(instruction, data, len, out, FRAME_MAX_SIZE);
+}
+
+// Create single status byte response (0x01 success, 0x00 failure)
+size_t createResponse(uint8_t instruction, uint8_t status, uint8_t* out) {
+    return createResponse(instruction, &status, 1, out);
+}
+
+// Status reply, from the canned table unless it is compiled out
+Response statusResponse(uint8_t instruction, uint8_t status, uint8_t* scratch) {
+#if CANNED_RESPONSES
+    return canned.status(instruction, status);
+#else
+    return Response(scratch, createResponse(instruction, status, scratch));
+#endif
+}
+
+size_t serialChunkSize(uint16_t mtu) {
+    // Each notify carries [opcode, length, instr, index, total, data..., checksum],
+    // or the sealed form of it in the hardened profile
+    const size_t overhead = ATT_NOTIFY_OVERHEAD + FRAME_OVERHEAD + 2 +
+                            (HARDENED_PROTOCOL ? HARDENED_SEAL_GROWTH : 0);
+    size_t chunkSize = mtu > overhead ? mtu - overhead : 1;
+    if (SERIAL_CHUNK_SIZE > 0 && chunkSize > SERIAL_CHUNK_SIZE) {
+        chunkSize = SERIAL_CHUNK_SIZE;
+    }
+    return chunkSize;
+}
+
+// Serial number reply, split into as many chunks as the session's MTU needs
+Response serialResponse(const EmulatorSession& session, uint8_t* scratch) {
+    const size_t serialLen = sizeof(SERIAL_NUMBER) - 1;
+    size_t chunkSize = serialChunkSize(session.mtu);
+#if CANNED_RESPONSES
+    if (chunkSize >= serialLen) {
+        return canned.serial();
+    }
+#endif
+
+    uint8_t total = (uint8_t)((serialLen + chunkSize - 1) / chunkSize);
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    size_t len = 0;
+    for (uint8_t index = 1; index <= total; index++) {
+        size_t offset = (size_t)(index - 1) * chunkSize;
+        size_t count = serialLen - offset < chunkSize ? serialLen - offset : chunkSize;
+        payload[0] = index;
+        payload[1] = total;
+        memcpy(payload + 2, SERIAL_NUMBER + offset, count);
+        len += codec.encodeResponse(INSTR_GET_SERIAL, payload, 2 + count,
+                                    scratch + len, REPLY_MAX_SIZE - len);
+    }
+    return Response(scratch, len, total > 1 ? FRAME_OVERHEAD + 2 + chunkSize : 0);
+}
+
+// Handle Instruction 1: Handshake/Authentication
+Response handleHandshake(EmulatorSession& session, const uint8_t* packet, size_t len, uint8_t* scratch) {
+    // Packet format: [0x52, len, 0x01, 0x00, 0x00, 'u','n','i','t','r','e','e', checksum]
+    // The authentication string (should be "unitree") is compared in place
+    static const char AUTH_STRING[] = "unitree";
+    const uint8_t* auth = packet + 5;
+    size_t authLen = len - 6;
+
+    LOG_HEX("    Auth string", auth, authLen);
+
+    if (authLen == sizeof(AUTH_STRING) - 1 && memcmp(auth, AUTH_STRING, authLen) == 0) {
+        session.authenticated = true;
+        LOG_DEBUG("    Status: accepted\n");
+        return statusResponse(INSTR_HANDSHAKE, 0x01, scratch); // Success
+    } else {
+        session.authenticated = false;
+        session.offenses |= OFFENSE_AUTH;
+        protocolStats.authReject();
+        LOG_DEBUG("    Status: rejected\n");
+        return statusResponse(INSTR_HANDSHAKE, 0x00, scratch); // Failure
+    }
+}
+
+// Handle Instruction 2: Get Serial Number
+Response handleGetSerial(EmulatorSession& session, const uint8_t* packet, size_t len, uint8_t* scratch) {
+    LOG_DEBUG("    Serial number: %s (%u-byte chunks, MTU %u)\n", SERIAL_NUMBER,
+              (unsigned)serialChunkSize(session.mtu), session.mtu);
+
+    return serialResponse(session, scratch);
+}
+
+// Handle Instruction 3: Initialize WiFi
+Response handleInitWiFi(EmulatorSession& session, const uint8_t* packet, size_t len, uint8_t* scratch) {
+    uint8_t mode = packet[3];
+
+    if (mode == 0x01) {
+        LOG_DEBUG("    Mode: access point\n");
+    } else if (mode == 0x02) {
+        LOG_DEBUG("    Mode: station\n");
+    } else {
+        LOG_DEBUG("    Mode: unknown (0x%02X)\n", mode);
+    }
+
+    return statusResponse(INSTR_INIT_WIFI, 0x01, scratch); // Success
+}
+
+// Log the injection rules that matched in field and flag the offense
+static void flagInjection(EmulatorSession& session, const char* field, uint32_t hits) {
+    session.offenses |= OFFENSE_INJECTION;
+    LOG_WARN("    Warning: potential command injection in %s\n", field);
+    for (size_t rule = 0; rule < INJECTION_RULE_COUNT; rule++) {
+        if (hits & (1UL << rule)) {
+            LOG_WARN("      rule: %s\n", INJECTION_RULES[rule].name);
+        }
+    }
+}
+
+// Place one SSID/password chunk; when the field completes it is copied
+// into value (REASSEMBLY_MAX_BYTES + 1) in one go
+ChunkResult receiveChunk(ChunkAssembler& chunks, char* value, const char* label,
+                         const uint8_t* packet, size_t len) {
+    uint8_t chunkIndex = packet[3];
+    uint8_t totalChunks = packet[4];
+
+    // A client that went quiet mid-field starts over rather than mixing
+    // its old chunks with new ones
+    uint32_t nowMs = emulatorClock().millis();
+    if (chunks.partial() && chunks.idleMs(nowMs) > REASSEMBLY_TIMEOUT_MS) {
+        LOG_WARN("    %s: %u/%u chunks timed out after %u ms, discarded\n", label, chunks.received(),
+                 chunks.total(), (unsigned)chunks.idleMs(nowMs));
+        protocolStats.reassemblyTimeout();
+        chunks.reset();
+    }
+    chunks.touch(nowMs);
+
+    // Chunk data sits between the chunk header and the checksum
+    ChunkResult result = chunks.add(chunkIndex, totalChunks, packet + 5, len - 6);
+
+    switch (result) {
+        case CHUNK_STORED:
+            LOG_DEBUG("    %s chunk %u/%u\n", label, chunkIndex, totalChunks);
+            break;
+        case CHUNK_DUPLICATE:
+            LOG_DEBUG("    %s chunk %u/%u: duplicate, ignored\n", label, chunkIndex, totalChunks);
+            break;
+        case CHUNK_REJECTED:
+            LOG_ERROR("    Error: %s chunk %u/%u rejected\n", label, chunkIndex, totalChunks);
+            break;
+        case CHUNK_COMPLETE:
+            memcpy(value, chunks.data(), chunks.size());
+            value[chunks.size()] = '\0';
+            LOG_INFO("    %s: %s\n", label, value);
+            break;
+    }
+    return result;
+}
+
+// Handle Instruction 4: Set SSID
+Response handleSetSSID(EmulatorSession& session, const uint8_t* packet, size_t len, uint8_t* scratch) {
+    switch (receiveChunk(session.ssidChunks, session.ssid, "SSID", packet, len)) {
+        case CHUNK_COMPLETE:
+            // CRITICAL: Only send response for LAST chunk (matches real robot behavior)
+            return statusResponse(INSTR_SET_SSID, 0x01, scratch);
+        case CHUNK_REJECTED:
+            return statusResponse(INSTR_SET_SSID, 0x00, scratch);
+        default:
+            // Intermediate chunk - do NOT send response (script doesn't wait for it)
+            return Response(); // Empty = no response
+    }
+}
+
+// Handle Instruction 5: Set Password
+Response handleSetPassword(EmulatorSession& session, const uint8_t* packet, size_t len, uint8_t* scratch) {
+    switch (receiveChunk(session.passwordChunks, session.password, "Password", packet, len)) {
+        case CHUNK_COMPLETE:
+            // Check for injection patterns
+            if (uint32_t hits = scanInjection(session.password)) {
+                flagInjection(session, "password", hits);
+                LOG_WARN("    Payload: %s\n", session.password);
+            }
+
+            // CRITICAL: Only send response for LAST chunk (matches real robot behavior)
+            return statusResponse(INSTR_SET_PASSWORD, 0x01, scratch);
+        case CHUNK_REJECTED:
+            return statusResponse(INSTR_SET_PASSWORD, 0x00, scratch);
+        default:
+            // Intermediate chunk - do NOT send response (script doesn't wait for it)
+            return Response(); // Empty = no response
+    }
+}
+
+// What the robot runs with the SSID and password appended, quoted
+static const char HOSTAPD_COMMAND[] = "sudo sh /unitree/module/network_manager/upper_bluetooth/hostapd_restart.sh ";
+
+// Handle Instruction 6: Set Country Code (TRIGGER)
+Response handleSetCountry(EmulatorSession& session, const uint8_t* packet, size_t len, uint8_t* scratch) {
+    // Extract country code
+    size_t countryLen = 0;
+    for (size_t i = 4; i < len - 1 && countryLen < sizeof(session.country) - 1; i++) {
+        if (packet[i] != 0x00) {
+            session.country[countryLen++] = (char)packet[i];
+        }
+    }
+    session.country[countryLen] = '\0';
+
+    LOG_INFO("    Country: %s\n", session.country);
+    LOG_INFO("    SSID: %s\n", session.ssid);
+    LOG_INFO("    Password: %s\n", session.password);
+
+    // Simulate the vulnerable command execution; built on the stack, and
+    // only when INFO lines are compiled in
+    if constexpr (LOG_LEVEL_INFO <= LOG_MODULE_LEVEL) {
+        char command[sizeof(HOSTAPD_COMMAND) + 2 * REASSEMBLY_MAX_BYTES + 4];
+        snprintf(command, sizeof(command), "%s\"%s %s\"", HOSTAPD_COMMAND, session.ssid, session.password);
+        LOG_INFO("    Simulated command: %s\n", command);
+    }
+
+    // Every field ends up in the shell command
+    if (uint32_t hits = scanInjection(session.ssid)) flagInjection(session, "SSID", hits);
+    if (uint32_t hits = scanInjection(session.password)) flagInjection(session, "password", hits);
+    if (uint32_t hits = scanInjection(session.country)) flagInjection(session, "country", hits);
+
+    // Parse what would actually execute if this were real
+    const char* start = strstr(session.password, ";$(");
+    if (start != nullptr) {
+        start += 3;
+        const char* end = strstr(start, ");");
+        if (end != nullptr && end > start) {
+            char injected[REASSEMBLY_MAX_BYTES + 1];
+            snprintf(injected, sizeof(injected), "%.*s", (int)(end - start), start);
+            LOG_INFO("    Injected command: %s\n", injected);
+        }
+    }
+
+    return statusResponse(INSTR_SET_COUNTRY, 0x01, scratch); // Success
+}
+
+// Instruction table, indexed by instruction byte. Adding an instruction is
+// one entry here; length and auth checks happen once in processPacket.
+static constexpr InstructionInfo instructionTable[INSTR_MAX + 1] = {
+    // instruction          handler            minLength  auth   chunked  replies
+    {0x00,                  nullptr,           0,         false, false,   false},
+    {INSTR_HANDSHAKE,       handleHandshake,   12,        false, false,   true},
+    {INSTR_GET_SERIAL,      handleGetSerial,   4,         true,  false,   true},
+    {INSTR_INIT_WIFI,       handleInitWiFi,    4,         false, false,   true},
+    {INSTR_SET_SSID,        handleSetSSID,     6,         false, true,    true},
+    {INSTR_SET_PASSWORD,    handleSetPassword, 6,         false, true,    true},
+    {INSTR_SET_COUNTRY,     handleSetCountry,  5,         false, false,   true},
+};
+
+// Every entry sits at its own index and declares a frame length the
+// handlers can index into without further checks
+static constexpr bool instructionTableValid() {
+    for (size_t i = 0; i <= INSTR_MAX; i++) {
+        const InstructionInfo& info = instructionTable[i];
+        if (info.instruction != i) return false;
+        if (info.handler == nullptr) continue;
+        if (info.minLength < FRAME_OVERHEAD) return false;
+        if (info.chunked && info.minLength < FRAME_OVERHEAD + 2) return false;  // index, total
+    }
+    return true;
+}
+static_assert(instructionTableValid(), "instructionTable entry out of place or too short");
+
+const InstructionInfo* instructionInfo(uint8_t instruction) {
+    if (instruction > INSTR_MAX || instructionTable[instruction].handler == nullptr) {
+        return nullptr;
+    }
+    return &instructionTable[instruction];
+}
+
+// Validate and run one request
+static Response dispatchPacket(EmulatorSession& session, const uint8_t* decrypted, size_t len,
+                               bool checksumOk, uint8_t* scratch) {
+    // Validate packet structure
+    if (len < 4) {
+        session.offenses |= OFFENSE_MALFORMED;
+        protocolStats.lengthFailure();
+        LOG_ERROR("    Error: packet too short\n");
+        return Response();
+    }
+
+    uint8_t opcode = decrypted[0];
+    uint8_t length = decrypted[1];
+    uint8_t instruction = decrypted[2];
+
+    if (opcode != OPCODE_REQUEST) {
+        session.offenses |= OFFENSE_MALFORMED;
+        protocolStats.invalidFrame();
+        LOG_ERROR("    Error: invalid opcode 0x%02X\n", opcode);
+        return Response();
+    }
+
+    if (length != len) {
+        protocolStats.lengthFailure();
+        LOG_WARN("    Warning: length mismatch (header=%u, actual=%u)\n", length, (unsigned)len);
+    }
+
+    if (!checksumOk) {
+        session.offenses |= OFFENSE_MALFORMED;
+        protocolStats.checksumFailure();
+        LOG_ERROR("    Error: checksum validation failed\n");
+        return Response();
+    }
+
+    LOG_DEBUG("    Instruction: 0x%02X\n", instruction);
+
+    const InstructionInfo* info = instructionInfo(instruction);
+    if (info == nullptr) {
+        session.offenses |= OFFENSE_MALFORMED;
+        protocolStats.invalidFrame();
+        LOG_ERROR("    Error: unknown instruction 0x%02X\n", instruction);
+        return Response();
+    }
+
+    // Shared checks; failures get a status 0x00 reply, as the robot does
+    if (len < info->minLength) {
+        session.offenses |= OFFENSE_MALFORMED;
+        protocolStats.lengthFailure();
+        LOG_ERROR("    Error: packet too short\n");
+        return info->replies ? statusResponse(instruction, 0x00, scratch) : Response();
+    }
+    if (info->requiresAuth && !session.authenticated) {
+        protocolStats.authReject();
+        LOG_ERROR("    Error: not authenticated\n");
+        return info->replies ? statusResponse(instruction, 0x00, scratch) : Response();
+    }
+
+    return info->handler(session, decrypted, len, scratch);
+}
+
+// Record a request, preceded by the connection's MTU when it changed
+static void traceRequest(EmulatorSession& session, uint8_t instruction,
+                         const uint8_t* decrypted, size_t len) {
+    if (session.tracedMtu != session.mtu) {
+        uint8_t mtu[2] = {(uint8_t)session.mtu, (uint8_t)(session.mtu >> 8)};
+        sessionTrace.record(TRACE_MTU, session.connHandle, 0, mtu, sizeof(mtu));
+        session.tracedMtu = session.mtu;
+    }
+    sessionTrace.record(TRACE_REQUEST, session.connHandle, instruction, decrypted, len);
+}
+
+// Record the reply frames as they will go out, decrypted
+static void traceResponse(const EmulatorSession& session, uint8_t instruction,
+                          const Response& response) {
+    response.forEachFrame([&](const uint8_t* frame, size_t frameLen) {
+        uint8_t plain[FRAME_MAX_SIZE];
+        codec.decrypt(frame, frameLen, plain);
+        sessionTrace.record(TRACE_RESPONSE, session.connHandle, instruction, plain, frameLen);
+    });
+}
+
+// Process received packet
+Response processPacket(EmulatorSession& session, const uint8_t* decrypted, size_t len,
+                       bool checksumOk, uint8_t* scratch) {
+    uint8_t instruction = len > 2 ? decrypted[2] : 0;
+    protocolStats.frameReceived(instruction);
+    if (sessionTrace.enabled()) {
+        traceRequest(session, instruction, decrypted, len);
+    }
+
+    Response response = dispatchPacket(session, decrypted, len, checksumOk, scratch);
+    if (faults.enabled()) {
+        response = faults.apply(session.connHandle, instruction, response, scratch);
+    }
+    if (response.len > 0) {
+        protocolStats.framesSent(instruction, response.frames());
+    }
+
+    if (sessionTrace.enabled()) {
+        traceResponse(session, instruction, response);
+    }
+    return response;
+}
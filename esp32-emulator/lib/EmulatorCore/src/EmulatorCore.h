@@ -0,0 +1,72 @@
+/**
+ * Unitree emulator protocol core
+ *
+ * Per-connection session state, instruction handlers and packet dispatch. Nothing in here
+ * depends on Arduino or NimBLE, so the same code runs on the ESP32 and in
+ * the host tools. Logging goes through the UnitreeLog ring.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <UnitreeCodec.h>
+#include <UnitreeLog.h>
+#include "CannedResponses.h"
+#include "EmulatorClock.h"
+#include "FaultInjector.h"
+#include "PeerGuard.h"
+#include "SessionTrace.h"
+#include "ProtocolStats.h"
+#include "SessionPool.h"
+
+// Cap on serial bytes per reply chunk; 0 follows the connection MTU alone
+#ifndef SERIAL_CHUNK_SIZE
+#define SERIAL_CHUNK_SIZE 0
+#endif
+
+extern SessionPool sessions;
+extern UnitreeCodec codec;
+extern CannedResponses canned;
+extern FaultInjector faults;
+extern PeerGuard peerGuard;
+extern SessionTrace sessionTrace;
+extern ProtocolStats protocolStats;
+
+// Instruction handler; length and auth were already checked by the dispatcher
+typedef Response (*InstructionHandler)(EmulatorSession& session, const uint8_t* packet,
+                                       size_t len, uint8_t* scratch);
+
+// Per-instruction metadata, one entry per instruction byte
+struct InstructionInfo {
+    uint8_t instruction;
+    InstructionHandler handler;  // nullptr = unknown instruction
+    uint8_t minLength;           // whole frame, checksum included
+    bool requiresAuth;           // handshake must have succeeded
+    bool chunked;                // [chunk_index, total_chunks, data...] payload
+    bool replies;                // sends a reply (chunked: on the last chunk only)
+};
+
+// Table entry for instruction, or nullptr if it is unknown
+const InstructionInfo* instructionInfo(uint8_t instruction);
+
+// Initialise the codec and encrypt the canned replies
+void initCrypto();
+
+// Encrypted response frames written to out (FRAME_MAX_SIZE bytes)
+size_t createResponse(uint8_t instruction, const uint8_t* data, size_t len, uint8_t* out);
+size_t createResponse(uint8_t instruction, uint8_t status, uint8_t* out);
+
+// Serial chunk size for a connection: what fits one notify at mtu, capped
+// by SERIAL_CHUNK_SIZE when that is set
+size_t serialChunkSize(uint16_t mtu);
+
+// Validate and dispatch a decrypted request from session. checksumOk comes from the
+// codec's single-pass decode. The reply is either a canned frame or built
+// in scratch (REPLY_MAX_SIZE bytes); an empty Response means no reply.
+// Offenses the request commits are flagged on session.offenses for the
+// peer guard. With a fault profile active the reply may carry a delay and drop,
+// duplicate or reorder marks for the transport to honour. While the
+// session trace is on, the request and each reply frame are recorded.
+Response processPacket(EmulatorSession& session, const uint8_t* decrypted, size_t len,
+                       bool checksumOk, uint8_t* scratch);
@@ -0,0 +1,206 @@
+#include "EmulatorEndpoint.h"
+
+// Log level for this file (-DLOG_LEVEL_CORE=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_CORE
+#define LOG_LEVEL_CORE LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_CORE
+
+EmulatorSession* EmulatorEndpoint::connect(uint16_t connHandle, uint16_t mtu, uint64_t peer, uint32_t generation) {
+    uint64_t key = peer ? peer : PEER_PER_CONNECTION(connHandle);
+    if (peerGuard.enabled() && !peerGuard.allowConnect(key, emulatorClock().millis())) {
+        LOG_WARN("    Peer guard: conn %u refused, peer locked out\n", connHandle);
+        return nullptr;
+    }
+
+    EmulatorSession* session = sessions.acquire(connHandle, generation);
+    if (session) {
+        session->mtu = mtu;
+        session->peer = key;
+    }
+    return session;
+}
+
+void EmulatorEndpoint::mtuChanged(uint16_t connHandle, uint16_t mtu, uint32_t generation) {
+    EmulatorSession* session = sessions.find(connHandle);
+    if (session && (!generation || session->generation == generation)) {
+        session->mtu = mtu;
+    }
+}
+
+bool EmulatorEndpoint::disconnect(uint16_t connHandle, uint32_t generation) {
+    if (!sessions.release(connHandle, generation)) return false;
+    sessionTrace.record(TRACE_DISCONNECT, connHandle, 0, nullptr, 0);
+    return true;
+}
+
+WriteResult EmulatorEndpoint::write(uint16_t connHandle, const uint8_t* data, size_t len, uint32_t token) {
+    LOG_DEBUG("\n[*] Write request (conn %u, %u bytes)\n", connHandle, (unsigned)len);
+
+    EmulatorSession* session = sessions.find(connHandle);
+    if (!session) {
+        LOG_ERROR("    Error: no session for connection\n");
+        return WRITE_NO_SESSION;
+    }
+
+    if (len == 0) {
+        LOG_DEBUG("    Note: empty payload\n");
+        return WRITE_NO_REPLY;
+    }
+
+    // Spend the peer's token before any decoding, so a flood costs little
+    if (peerGuard.enabled()) {
+        GuardVerdict verdict = peerGuard.admit(session->peer, emulatorClock().millis());
+        if (verdict != GUARD_PASS) {
+            LOG_DEBUG("    Peer guard: frame dropped\n");
+            if (verdict == GUARD_DISCONNECT) dropPeer(*session);
+            return WRITE_THROTTLED;
+        }
+    }
+
+#if HARDENED_PROTOCOL
+    WriteResult result = writeHardened(*session, data, len, token);
+#else
+    // Decrypt the data and check the checksum in one pass
+    uint8_t decrypted[FRAME_MAX_SIZE];
+    bool checksumOk = false;
+    size_t decryptedLen = codec.decodeFrame(data, len, decrypted, sizeof(decrypted), &checksumOk);
+
+    bool handshake = decryptedLen > 2 && decrypted[2] == INSTR_HANDSHAKE;
+    uint32_t start = handshake ? emulatorClock().micros() : 0;
+
+    uint8_t scratch[REPLY_MAX_SIZE];
+    Response response = processPacket(*session, decrypted, decryptedLen, checksumOk, scratch);
+    if (handshake) {
+        protocolStats.handshake(emulatorClock().micros() - start);
+    }
+    WriteResult result = deliver(*session, response, token);
+#endif
+
+    // Charge what the frame did wrong once its reply is on the way
+    if (session->offenses) {
+        uint8_t offenses = session->offenses;
+        session->offenses = 0;
+        if (peerGuard.enabled() &&
+            peerGuard.report(session->peer, offenses, emulatorClock().millis()) == GUARD_DISCONNECT) {
+            dropPeer(*session);
+        }
+    }
+    return result;
+}
+
+// Once per session; frames that arrive before the link goes are dropped
+void EmulatorEndpoint::dropPeer(EmulatorSession& session) {
+    if (session.cut) return;
+    session.cut = true;
+    LOG_WARN("    Peer guard: disconnecting conn %u\n", session.connHandle);
+    transport.disconnect(session);
+}
+
+WriteResult EmulatorEndpoint::deliver(EmulatorSession& session, const Response& response, uint32_t token) {
+    if (response.len == 0 && response.delayMs == 0) {
+        LOG_DEBUG("    Note: no response for this chunk\n");
+        return WRITE_NO_REPLY;
+    }
+
+    // A stall without frames still goes to the transport, which holds it
+    bool accepted = transport.send(session, response, token);
+    if (response.len == 0) return WRITE_NO_REPLY;
+    return accepted ? WRITE_REPLIED : WRITE_SEND_FAILED;
+}
+
+#if HARDENED_PROTOCOL
+
+// Seal each plaintext-profile reply frame under the session key. Sealing
+// grows every frame by the same amount, so the chunk layout carries over.
+static Response sealResponse(EmulatorSession& session, const Response& response, uint8_t* sealed) {
+    size_t len = 0;
+    for (size_t i = 0; i < response.frames(); i++) {
+        uint8_t plain[FRAME_MAX_SIZE];
+        size_t plainLen = codec.decodeFrame(response.frame(i), response.frameLength(i), plain, sizeof(plain));
+        if (plainLen < FRAME_OVERHEAD) return Response();
+        size_t frameLen = session.channel.seal(plain[0], plain[2], plain + FRAME_HEADER_SIZE,
+                                               plainLen - FRAME_OVERHEAD, sealed + len,
+                                               HARDENED_REPLY_MAX_SIZE - len);
+        if (frameLen == 0) return Response();
+        len += frameLen;
+    }
+
+    Response out = response;
+    out.data = sealed;
+    out.len = len;
+    out.frameSize = response.frameSize ? response.frameSize + HARDENED_SEAL_GROWTH : 0;
+    return out;
+}
+
+WriteResult EmulatorEndpoint::writeHardened(EmulatorSession& session, const uint8_t* data, size_t len,
+                                            uint32_t token) {
+    uint32_t start = emulatorClock().micros();
+    uint8_t reply[HARDENED_REPLY_MAX_SIZE];
+
+    // Hello: new key pair, key agreement, our hello back in the clear
+    if (HardenedChannel::isHello(data, len)) {
+        session.authenticated = false;
+        if (session.mtu < HARDENED_MIN_MTU) {
+            protocolStats.invalidFrame();
+            LOG_WARN("    Warning: MTU %u too small for the hardened profile (need %u)\n",
+                     session.mtu, (unsigned)HARDENED_MIN_MTU);
+            return WRITE_NO_REPLY;
+        }
+        if (!session.channel.begin(HardenedChannel::SERVER) || !session.channel.acceptHello(data, len)) {
+            session.channel.end();
+            session.offenses |= OFFENSE_MALFORMED;
+            protocolStats.invalidFrame();
+            LOG_WARN("    Warning: key agreement failed\n");
+            return WRITE_NO_REPLY;
+        }
+        size_t helloLen = session.channel.encodeHello(reply, sizeof(reply));
+        session.handshakeUs = emulatorClock().micros() - start;
+        LOG_DEBUG("    Key agreement: %u us\n", session.handshakeUs);
+        return deliver(session, Response(reply, helloLen), token);
+    }
+
+    // Everything else must be sealed under the session key; the static-key
+    // frames of the vulnerable profile are refused outright
+    uint8_t plain[FRAME_MAX_SIZE];
+    size_t plainLen = 0;
+    if (!HardenedChannel::isSealed(data, len) || !session.channel.keyed() ||
+        (plainLen = session.channel.open(data, len, plain, sizeof(plain))) == 0) {
+        session.offenses |= OFFENSE_MALFORMED;
+        protocolStats.invalidFrame();
+        LOG_WARN("    Warning: frame not sealed under the session key, dropped\n");
+        return WRITE_NO_REPLY;
+    }
+
+    // Challenge-response: the payload is the client's proof
+    if (plain[2] == INSTR_HANDSHAKE) {
+        protocolStats.frameReceived(INSTR_HANDSHAKE);
+        bool accepted = session.channel.checkPeerProof(plain + FRAME_HEADER_SIZE, plainLen - FRAME_OVERHEAD);
+        session.authenticated = accepted;
+
+        uint8_t payload[1 + HARDENED_PROOF_SIZE] = {(uint8_t)(accepted ? 0x01 : 0x00)};
+        size_t payloadLen = 1;
+        if (accepted) {
+            session.channel.proof(HardenedChannel::SERVER, payload + 1);
+            payloadLen += HARDENED_PROOF_SIZE;
+        } else {
+            session.offenses |= OFFENSE_AUTH;
+            protocolStats.authReject();
+        }
+        size_t replyLen = session.channel.seal(OPCODE_RESPONSE, INSTR_HANDSHAKE, payload, payloadLen,
+                                               reply, sizeof(reply));
+        protocolStats.framesSent(INSTR_HANDSHAKE, 1);
+        protocolStats.handshake(session.handshakeUs + (emulatorClock().micros() - start));
+        LOG_DEBUG("    Proof %s\n", accepted ? "accepted" : "rejected");
+        return deliver(session, Response(reply, replyLen), token);
+    }
+
+    uint8_t scratch[REPLY_MAX_SIZE];
+    Response response = processPacket(session, plain, plainLen, true, scratch);
+    if (response.len > 0) {
+        response = sealResponse(session, response, reply);
+    }
+    return deliver(session, response, token);
+}
+
+#endif
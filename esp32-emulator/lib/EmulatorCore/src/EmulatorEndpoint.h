@@ -0,0 +1,80 @@
+/**
+ * Link-layer boundary of the emulator
+ *
+ * EmulatorEndpoint does what the GATT server does with the Unitree
+ * service: connections come and go, clients write frames and replies go
+ * back as notifications. It owns the session lifecycle and the decode and
+ * dispatch step; an EmulatorTransport delivers the replies. On the ESP32
+ * the transport is the NimBLE transmit queue, on the host an in-process
+ * or Unix socket stand-in, so the whole request/response path runs
+ * without a radio. With the peer guard on, every write first spends a
+ * token from the peer's bucket and the frame's offenses are charged after
+ * its reply; a lockout asks the transport to drop the link.
+ *
+ * The endpoint and the session pool it works on have no lock: every
+ * call (connect, mtuChanged, write, disconnect) must come from one task,
+ * in the order the link events happened. The firmware's BLE callbacks
+ * only queue events; its worker task makes all of these calls.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "EmulatorCore.h"
+
+class EmulatorTransport {
+public:
+    virtual ~EmulatorTransport() {}
+
+    // Deliver response's frames (honouring its fault fields, delayMs
+    // included; a pure stall has no frames) to the session's connection. token is the value given to write(); the
+    // firmware passes the write timestamp. False if the frames were not
+    // accepted.
+    virtual bool send(EmulatorSession& session, const Response& response, uint32_t token) = 0;
+
+    // Drop the session's link (peer guard lockout). Transports without a
+    // link to drop ignore it; the guard refuses the peer's frames anyway.
+    virtual void disconnect(EmulatorSession& session) {}
+};
+
+// Sealed replies: REPLY_MAX_SIZE grown by the seal overhead per frame
+#define HARDENED_REPLY_MAX_SIZE  (REPLY_MAX_SIZE + 32 * HARDENED_SEAL_GROWTH)
+
+enum WriteResult : uint8_t {
+    WRITE_REPLIED,      // reply handed to the transport
+    WRITE_NO_REPLY,     // rejected frame or a chunk that needs no reply
+    WRITE_NO_SESSION,   // connection unknown to the pool
+    WRITE_SEND_FAILED,  // transport refused the reply
+    WRITE_THROTTLED     // dropped undecoded by the peer guard
+};
+
+class EmulatorEndpoint {
+public:
+    explicit EmulatorEndpoint(EmulatorTransport& transport) : transport(transport) {}
+
+    // New connection from peer (a peerKey(), 0 if the transport has no
+    // address); nullptr when every session is in use or the peer guard
+    // has the peer locked out. generation numbers connections on a handle
+    // so late events for an earlier one are ignored (0: the pool picks).
+    EmulatorSession* connect(uint16_t connHandle, uint16_t mtu, uint64_t peer = 0, uint32_t generation = 0);
+
+    // Reply chunks follow the MTU negotiated on each connection
+    void mtuChanged(uint16_t connHandle, uint16_t mtu, uint32_t generation = 0);
+
+    // Record the disconnect and free the session; a generation other than
+    // the session's (when not 0) leaves it alone. False if nothing was freed.
+    bool disconnect(uint16_t connHandle, uint32_t generation = 0);
+
+    // One write to the request characteristic: decode, dispatch, reply
+    WriteResult write(uint16_t connHandle, const uint8_t* data, size_t len, uint32_t token = 0);
+
+private:
+    WriteResult deliver(EmulatorSession& session, const Response& response, uint32_t token);
+    void dropPeer(EmulatorSession& session);
+#if HARDENED_PROTOCOL
+    WriteResult writeHardened(EmulatorSession& session, const uint8_t* data, size_t len, uint32_t token);
+#endif
+
+    EmulatorTransport& transport;
+};
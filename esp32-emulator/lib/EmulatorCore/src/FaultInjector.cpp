@@ -0,0 +1,165 @@
+#include "FaultInjector.h"
+#include "EmulatorCore.h"
+#include "ProfileSpec.h"
+#include <UnitreeLog.h>
+#include <string.h>
+
+// Log level for this file (-DLOG_LEVEL_CORE=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_CORE
+#define LOG_LEVEL_CORE LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_CORE
+
+bool FaultInjector::configure(const char* spec) {
+    FaultProfile parsed;
+    bool any = false;
+
+    const char* p = spec;
+    while (*p) {
+        while (*p == ' ' || *p == ',' || *p == '\t') p++;
+        if (!*p) break;
+
+        const char* token = p;
+        while (*p && *p != ' ' && *p != ',' && *p != '\t') p++;
+        size_t tokenLen = p - token;
+
+        if (keyIs(token, tokenLen, "off")) continue;
+
+        const char* eq = (const char*)memchr(token, '=', tokenLen);
+        if (!eq) return false;
+        size_t keyLen = eq - token;
+        const char* valueText = eq + 1;
+        size_t valueLen = token + tokenLen - valueText;
+
+        unsigned long value;
+        if (keyIs(token, keyLen, "seed")) {
+            if (!parseValue(valueText, valueLen, 0, 0xFFFFFFFFUL, &value)) return false;
+            parsed.seed = value;
+            continue;
+        } else if (keyIs(token, keyLen, "stallms")) {
+            if (!parseValue(valueText, valueLen, 0, 60000, &value)) return false;
+            parsed.stallMs = value;
+            continue;
+        } else if (keyIs(token, keyLen, "jitter")) {
+            if (!parseValue(valueText, valueLen, 0, 60000, &value)) return false;
+            parsed.jitterMs = value;
+        } else if (keyIs(token, keyLen, "delay")) {
+            if (!parseValue(valueText, valueLen, 0, 60000, &value)) return false;
+            for (size_t i = 1; i <= INSTR_MAX; i++) parsed.delayMs[i] = value;
+        } else if (keyLen > 5 && memcmp(token, "delay", 5) == 0) {
+            unsigned long instruction;
+            if (!parseValue(token + 5, keyLen - 5, 1, INSTR_MAX, &instruction)) return false;
+            if (!parseValue(valueText, valueLen, 0, 60000, &value)) return false;
+            parsed.delayMs[instruction] = value;
+        } else {
+            uint8_t* percent = nullptr;
+            if (keyIs(token, keyLen, "drop")) percent = &parsed.dropPercent;
+            else if (keyIs(token, keyLen, "dup")) percent = &parsed.duplicatePercent;
+            else if (keyIs(token, keyLen, "reorder")) percent = &parsed.reorderPercent;
+            else if (keyIs(token, keyLen, "corrupt")) percent = &parsed.corruptPercent;
+            else if (keyIs(token, keyLen, "stall")) percent = &parsed.stallPercent;
+            if (!percent || !parseValue(valueText, valueLen, 0, 100, &value)) return false;
+            *percent = value;
+        }
+        any = any || value > 0;
+    }
+
+    config = parsed;
+    counts = FaultStats();
+    state = parsed.seed ? parsed.seed : 1;  // xorshift never leaves zero
+    sequence = 0;
+    active = any;
+    return true;
+}
+
+// xorshift32
+uint32_t FaultInjector::next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+bool FaultInjector::roll(uint8_t percent) {
+    return percent > 0 && next() % 100 < percent;
+}
+
+// Number the fault and record it in the trace, which keeps it even in
+// builds whose log level drops the WARN line that follows
+void FaultInjector::note(uint16_t connHandle, uint8_t instruction, FaultKind kind, uint32_t value) {
+    ++sequence;
+    if (!sessionTrace.enabled()) return;
+    uint8_t data[9] = {kind};
+    for (int i = 0; i < 4; i++) {
+        data[1 + i] = (uint8_t)(sequence >> (8 * i));
+        data[5 + i] = (uint8_t)(value >> (8 * i));
+    }
+    sessionTrace.record(TRACE_FAULT, connHandle, instruction, data, sizeof(data));
+}
+
+Response FaultInjector::apply(uint16_t connHandle, uint8_t instruction, Response response, uint8_t* scratch) {
+    if (!active) return response;
+
+    // A stall holds the session whether or not there is a reply
+    if (roll(config.stallPercent)) {
+        response.delayMs += config.stallMs;
+        counts.stalled++;
+        note(connHandle, instruction, FAULT_STALL, config.stallMs);
+        LOG_WARN("    [fault %u] conn %u instr 0x%02X: stall %u ms\n",
+                 (unsigned)sequence, connHandle, instruction, config.stallMs);
+    }
+    if (response.len == 0) return response;
+
+    uint32_t delayMs = instruction <= INSTR_MAX ? config.delayMs[instruction] : 0;
+    if (config.jitterMs > 0) delayMs += next() % (config.jitterMs + 1u);
+    if (delayMs > 0) {
+        response.delayMs += delayMs;
+        counts.delayed++;
+        note(connHandle, instruction, FAULT_DELAY, delayMs);
+        LOG_WARN("    [fault %u] conn %u instr 0x%02X: delay %u ms\n",
+                 (unsigned)sequence, connHandle, instruction, (unsigned)delayMs);
+    }
+
+    size_t frames = response.frames();
+    if (frames > 1 && roll(config.reorderPercent)) {
+        response.reversed = true;
+        counts.reordered++;
+        note(connHandle, instruction, FAULT_REORDER, (uint32_t)frames);
+        LOG_WARN("    [fault %u] conn %u instr 0x%02X: %u chunks reversed\n",
+                 (unsigned)sequence, connHandle, instruction, (unsigned)frames);
+    }
+
+    if (roll(config.corruptPercent)) {
+        // Copy canned frames before touching them
+        if (response.data != scratch) {
+            memcpy(scratch, response.data, response.len);
+            response.data = scratch;
+        }
+        // CFB: flipping a ciphertext byte flips the same plaintext byte, so
+        // the last byte of a frame is its checksum
+        size_t i = next() % frames;
+        uint8_t* checksum = scratch + (response.frame(i) - scratch) + response.frameLength(i) - 1;
+        *checksum ^= (uint8_t)(1 + next() % 255);
+        counts.corrupted++;
+        note(connHandle, instruction, FAULT_CORRUPT, (uint32_t)(i + 1));
+        LOG_WARN("    [fault %u] conn %u instr 0x%02X: checksum corrupted in frame %u\n",
+                 (unsigned)sequence, connHandle, instruction, (unsigned)(i + 1));
+    }
+
+    for (size_t i = 0; i < frames && i < 32; i++) {
+        if (roll(config.dropPercent)) {
+            response.dropMask |= 1UL << i;
+            counts.dropped++;
+            note(connHandle, instruction, FAULT_DROP, (uint32_t)(i + 1));
+            LOG_WARN("    [fault %u] conn %u instr 0x%02X: frame %u dropped\n",
+                     (unsigned)sequence, connHandle, instruction, (unsigned)(i + 1));
+        } else if (roll(config.duplicatePercent)) {
+            response.duplicateMask |= 1UL << i;
+            counts.duplicated++;
+            note(connHandle, instruction, FAULT_DUPLICATE, (uint32_t)(i + 1));
+            LOG_WARN("    [fault %u] conn %u instr 0x%02X: frame %u duplicated\n",
+                     (unsigned)sequence, connHandle, instruction, (unsigned)(i + 1));
+        }
+    }
+    return response;
+}
@@ -0,0 +1,85 @@
+/**
+ * Fault injection for client robustness tests
+ *
+ * A runtime profile makes the emulator misbehave on purpose: per-instruction
+ * delays with jitter, dropped and duplicated notifications, serial chunks
+ * sent in reverse, corrupted checksums and session stalls. Every decision
+ * comes from a seeded xorshift PRNG, so the same profile and request
+ * sequence replay the same faults. Each injected fault is counted, logged
+ * at WARN with a sequence number and, whatever the log level, recorded in
+ * the session trace (TRACE_FAULT) while it is on.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <UnitreeProtocol.h>
+#include "CannedResponses.h"
+
+// Profile applied at boot, e.g. -DFAULT_PROFILE='"seed=7 drop=10 delay2=300"'
+#ifndef FAULT_PROFILE
+#define FAULT_PROFILE ""
+#endif
+
+struct FaultProfile {
+    uint32_t seed = 1;
+    uint16_t delayMs[INSTR_MAX + 1] = {};  // before each reply, by instruction
+    uint16_t jitterMs = 0;                 // extra 0..jitterMs on every delayed reply
+    uint8_t dropPercent = 0;               // per notification
+    uint8_t duplicatePercent = 0;          // per notification
+    uint8_t reorderPercent = 0;            // per chunked reply
+    uint8_t corruptPercent = 0;            // per reply, one frame's checksum
+    uint8_t stallPercent = 0;              // per request
+    uint16_t stallMs = 5000;
+};
+
+// What a TRACE_FAULT record describes; its data is the kind, then the
+// fault's sequence number and value (ms, chunk count or frame number) as
+// little-endian u32
+enum FaultKind : uint8_t {
+    FAULT_STALL     = 0,
+    FAULT_DELAY     = 1,
+    FAULT_REORDER   = 2,
+    FAULT_CORRUPT   = 3,
+    FAULT_DROP      = 4,
+    FAULT_DUPLICATE = 5
+};
+
+struct FaultStats {
+    uint32_t delayed = 0;
+    uint32_t dropped = 0;
+    uint32_t duplicated = 0;
+    uint32_t reordered = 0;
+    uint32_t corrupted = 0;
+    uint32_t stalled = 0;
+};
+
+class FaultInjector {
+public:
+    // Replace the profile from "key=value" pairs separated by spaces or
+    // commas, and reseed. Keys: seed, delay (all instructions), delay<N>
+    // (instruction N), jitter, drop, dup, reorder, corrupt, stall (percent),
+    // stallms. "off" or "" disables. False on a bad key or value; the
+    // previous profile is kept.
+    bool configure(const char* spec);
+
+    bool enabled() const { return active; }
+    const FaultProfile& profile() const { return config; }
+    const FaultStats& stats() const { return counts; }
+
+    // Apply the profile to the reply for instruction on connHandle. A reply
+    // whose bytes change is copied into scratch (REPLY_MAX_SIZE bytes) first.
+    Response apply(uint16_t connHandle, uint8_t instruction, Response response, uint8_t* scratch);
+
+private:
+    uint32_t next();
+    bool roll(uint8_t percent);
+    void note(uint16_t connHandle, uint8_t instruction, FaultKind kind, uint32_t value);
+
+    FaultProfile config;
+    FaultStats counts;
+    uint32_t state = 1;
+    uint32_t sequence = 0;
+    bool active = false;
+};
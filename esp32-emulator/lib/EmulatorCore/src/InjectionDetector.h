@@ -0,0 +1,147 @@
+/**
+ * Single-pass shell injection detector
+ *
+ * The rule patterns are compiled at build time into an Aho-Corasick
+ * automaton with full DFA transitions on raw bytes: a flat [state][256]
+ * table, so a scan is one lookup per input byte whatever the number of
+ * rules, and returns a bitmask of the rules that matched (bit i =
+ * INJECTION_RULES[i]). With the default rules the table is 20 x 256 bytes.
+ *
+ * Replace the rule set with -DINJECTION_RULES_HEADER='"MyRules.h"', a
+ * header defining `inline constexpr InjectionRule INJECTION_RULES[]`.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct InjectionRule {
+    const char* pattern;
+    const char* name;
+};
+
+#ifdef INJECTION_RULES_HEADER
+#include INJECTION_RULES_HEADER
+#else
+// Shell metacharacters and substitutions that break out of the quoted
+// hostapd_restart.sh argument
+inline constexpr InjectionRule INJECTION_RULES[] = {
+    {";$(", "separator + command substitution"},
+    {"$(",  "command substitution"},
+    {"`",   "backtick substitution"},
+    {"${",  "parameter expansion"},
+    {"\"",  "quote break"},
+    {";",   "command separator"},
+    {"&&",  "and-chain"},
+    {"||",  "or-chain"},
+    {"|",   "pipe"},
+    {"&",   "background"},
+    {">",   "redirect out"},
+    {"<",   "redirect in"},
+    {"\n",  "newline"},
+};
+#endif
+
+#define INJECTION_RULE_COUNT (sizeof(INJECTION_RULES) / sizeof(INJECTION_RULES[0]))
+static_assert(INJECTION_RULE_COUNT <= 32, "at most 32 injection rules (one result bit each)");
+
+constexpr size_t injectionPatternLength(const char* pattern) {
+    size_t len = 0;
+    while (pattern[len]) len++;
+    return len;
+}
+
+// Trie nodes needed: the root plus one per pattern byte at most
+constexpr size_t injectionStateBound() {
+    size_t states = 1;
+    for (const InjectionRule& rule : INJECTION_RULES) states += injectionPatternLength(rule.pattern);
+    return states;
+}
+
+#define INJECTION_MAX_STATES injectionStateBound()
+static_assert(INJECTION_MAX_STATES <= 256, "injection rules too long for 8-bit states");
+
+struct InjectionAutomaton {
+    uint8_t next[INJECTION_MAX_STATES][256] = {};   // [state][input byte]
+    uint32_t matches[INJECTION_MAX_STATES] = {};    // rules ending here
+    size_t states = 1;
+};
+
+constexpr InjectionAutomaton buildInjectionAutomaton() {
+    InjectionAutomaton a;
+
+    // Trie; 0 marks a missing edge since the root is nobody's child
+    for (size_t rule = 0; rule < INJECTION_RULE_COUNT; rule++) {
+        size_t state = 0;
+        for (const char* p = INJECTION_RULES[rule].pattern; *p; p++) {
+            uint8_t byte = (uint8_t)*p;
+            if (a.next[state][byte] == 0) a.next[state][byte] = (uint8_t)a.states++;
+            state = a.next[state][byte];
+        }
+        a.matches[state] |= 1UL << rule;
+    }
+
+    // Breadth-first failure links, folded into full DFA transitions
+    uint8_t fail[INJECTION_MAX_STATES] = {};
+    uint8_t queue[INJECTION_MAX_STATES] = {};
+    size_t head = 0, tail = 0;
+    for (size_t byte = 0; byte < 256; byte++) {
+        if (a.next[0][byte] != 0) queue[tail++] = a.next[0][byte];
+    }
+    while (head < tail) {
+        uint8_t state = queue[head++];
+        a.matches[state] |= a.matches[fail[state]];
+        for (size_t byte = 0; byte < 256; byte++) {
+            uint8_t child = a.next[state][byte];
+            if (child != 0) {
+                fail[child] = a.next[fail[state]][byte];
+                queue[tail++] = child;
+            } else {
+                a.next[state][byte] = a.next[fail[state]][byte];
+            }
+        }
+    }
+    return a;
+}
+
+inline constexpr InjectionAutomaton INJECTION_AUTOMATON = buildInjectionAutomaton();
+
+// One step per byte. Bytes that leave the root at the root (most text)
+// only need that row, not the previous state, so runs of them are
+// skipped without the load-to-load dependency of the state chain.
+
+// Bitmask of the rules found anywhere in data
+inline uint32_t scanInjection(const uint8_t* data, size_t len) {
+    const InjectionAutomaton& a = INJECTION_AUTOMATON;
+    const uint8_t* end = data + len;
+    uint8_t state = 0;
+    uint32_t hits = 0;
+    while (data < end) {
+        if (state == 0) {
+            while (data < end && a.next[0][*data] == 0) data++;
+            if (data == end) break;
+        }
+        state = a.next[state][*data++];
+        hits |= a.matches[state];
+    }
+    return hits;
+}
+
+// Same, up to the terminating NUL, without a strlen pass first
+inline uint32_t scanInjection(const char* text) {
+    const InjectionAutomaton& a = INJECTION_AUTOMATON;
+    const uint8_t* p = (const uint8_t*)text;
+    uint8_t state = 0;
+    uint32_t hits = 0;
+    for (;;) {
+        if (state == 0) {
+            while (*p && a.next[0][*p] == 0) p++;
+        }
+        if (!*p) break;
+        state = a.next[state][*p++];
+        hits |= a.matches[state];
+    }
+    return hits;
+}
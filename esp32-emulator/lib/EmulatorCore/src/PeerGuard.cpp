@@ -0,0 +1,206 @@
+#include "PeerGuard.h"
+#include "ProfileSpec.h"
+#include <UnitreeLog.h>
+#include <string.h>
+
+// Log level for this file (-DLOG_LEVEL_CORE=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_CORE
+#define LOG_LEVEL_CORE LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_CORE
+
+#define TOKEN_SCALE       1000   // bucket arithmetic in thousandths of a frame
+#define MAX_LOCKOUT_SHIFT 6      // lockouts stop doubling at 64x
+
+bool PeerGuard::configure(const char* spec) {
+    GuardConfig parsed;
+    bool on = false;
+
+    const char* p = spec;
+    while (*p) {
+        while (*p == ' ' || *p == ',' || *p == '\t') p++;
+        if (!*p) break;
+
+        const char* token = p;
+        while (*p && *p != ' ' && *p != ',' && *p != '\t') p++;
+        size_t tokenLen = p - token;
+
+        if (keyIs(token, tokenLen, "off")) continue;
+        if (keyIs(token, tokenLen, "on")) {
+            on = true;
+            continue;
+        }
+
+        const char* eq = (const char*)memchr(token, '=', tokenLen);
+        if (!eq) return false;
+        size_t keyLen = eq - token;
+        const char* valueText = eq + 1;
+        size_t valueLen = token + tokenLen - valueText;
+
+        unsigned long value;
+        bool ok;
+        if (keyIs(token, keyLen, "rate")) {
+            ok = parseValue(valueText, valueLen, 1, 10000, &value);
+            parsed.ratePerSecond = value;
+        } else if (keyIs(token, keyLen, "burst")) {
+            ok = parseValue(valueText, valueLen, 1, 1000, &value);
+            parsed.burst = value;
+        } else if (keyIs(token, keyLen, "cost")) {
+            ok = parseValue(valueText, valueLen, 0, 1000, &value);
+            parsed.offenseCost = value;
+        } else if (keyIs(token, keyLen, "strikes")) {
+            ok = parseValue(valueText, valueLen, 1, 255, &value);
+            parsed.strikeLimit = value;
+        } else if (keyIs(token, keyLen, "decay")) {
+            ok = parseValue(valueText, valueLen, 0, 3600000, &value);   // 0: never forgiven
+            parsed.strikeDecayMs = value;
+        } else if (keyIs(token, keyLen, "lockout")) {
+            ok = parseValue(valueText, valueLen, 0, 3600000, &value);
+            parsed.lockoutMs = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) return false;
+        on = true;
+    }
+
+    settings = parsed;
+    active = on;
+    clear();
+    return true;
+}
+
+void PeerGuard::clear() {
+    memset(table, 0, sizeof(table));
+    counts = GuardStats();
+}
+
+size_t PeerGuard::tracked() const {
+    size_t count = 0;
+    for (const PeerRecord& record : table) {
+        if (record.peer != 0) count++;
+    }
+    return count;
+}
+
+// Fibonacci hashing: the top bits of the product are well mixed even for
+// addresses that differ only in their last byte
+static size_t homeSlot(uint64_t peer) {
+    return (size_t)((peer * 0x9E3779B97F4A7C15ULL) >> 40) & (PEER_TABLE_SIZE - 1);
+}
+
+static bool lockedAt(bool locked, uint32_t lockedUntilMs, uint32_t nowMs) {
+    return locked && (int32_t)(lockedUntilMs - nowMs) > 0;
+}
+
+PeerGuard::PeerRecord* PeerGuard::lookup(uint64_t peer, uint32_t nowMs, bool create) {
+    // Slots are only ever overwritten, never emptied, so an empty slot
+    // ends the probe: the peer cannot sit further along
+    size_t home = homeSlot(peer);
+    PeerRecord* victim = nullptr;
+    for (size_t i = 0; i < PEER_PROBE_LIMIT; i++) {
+        PeerRecord& record = table[(home + i) & (PEER_TABLE_SIZE - 1)];
+        if (record.peer == peer) return &record;
+        if (record.peer == 0) {
+            victim = &record;
+            break;
+        }
+        if (!create) continue;
+
+        // Window full: prefer a peer that is not locked out, then the
+        // quietest one (or the lockout that ends soonest)
+        bool locked = lockedAt(record.locked, record.lockedUntilMs, nowMs);
+        if (!victim) {
+            victim = &record;
+            continue;
+        }
+        bool victimLocked = lockedAt(victim->locked, victim->lockedUntilMs, nowMs);
+        if (locked != victimLocked) {
+            if (!locked) victim = &record;
+        } else if (locked ? (int32_t)(record.lockedUntilMs - victim->lockedUntilMs) < 0
+                          : nowMs - record.seenMs > nowMs - victim->seenMs) {
+            victim = &record;
+        }
+    }
+    if (!create) return nullptr;
+
+    if (victim->peer != 0) counts.evictions++;
+    memset(victim, 0, sizeof(*victim));
+    victim->peer = peer;
+    victim->seenMs = nowMs;
+    victim->strikeMs = nowMs;
+    victim->tokens = (uint32_t)settings.burst * TOKEN_SCALE;
+    return victim;
+}
+
+// Refill the bucket, forgive strikes and end a lockout that ran out
+void PeerGuard::refresh(PeerRecord& record, uint32_t nowMs) {
+    uint64_t tokens = record.tokens + (uint64_t)(nowMs - record.seenMs) * settings.ratePerSecond;
+    uint32_t capacity = (uint32_t)settings.burst * TOKEN_SCALE;
+    record.tokens = tokens < capacity ? (uint32_t)tokens : capacity;
+    record.seenMs = nowMs;
+
+    if (record.strikes == 0 || settings.strikeDecayMs == 0) {
+        record.strikeMs = nowMs;
+    } else {
+        uint32_t steps = (nowMs - record.strikeMs) / settings.strikeDecayMs;
+        record.strikes = steps < record.strikes ? record.strikes - steps : 0;
+        record.strikeMs += steps * settings.strikeDecayMs;
+    }
+
+    if (record.locked && !lockedAt(true, record.lockedUntilMs, nowMs)) {
+        record.locked = false;
+    }
+}
+
+GuardVerdict PeerGuard::strike(PeerRecord& record, uint8_t count, uint32_t nowMs) {
+    unsigned strikes = record.strikes + count;
+    record.strikes = strikes < 255 ? strikes : 255;
+    if (record.strikes < settings.strikeLimit) return GUARD_PASS;
+
+    if (record.lockouts < 255) record.lockouts++;
+    unsigned shift = record.lockouts - 1 < MAX_LOCKOUT_SHIFT ? record.lockouts - 1 : MAX_LOCKOUT_SHIFT;
+    uint32_t lockMs = settings.lockoutMs << shift;
+    record.strikes = 0;
+    record.strikeMs = nowMs;
+    record.locked = lockMs > 0;
+    record.lockedUntilMs = nowMs + lockMs;
+    counts.disconnects++;
+    LOG_WARN("    Peer guard: %04x%08x locked out for %u ms (lockout %u)\n", (unsigned)(record.peer >> 32),
+             (unsigned)record.peer, (unsigned)lockMs, record.lockouts);
+    return GUARD_DISCONNECT;
+}
+
+bool PeerGuard::allowConnect(uint64_t peer, uint32_t nowMs) {
+    // Through EmulatorEndpoint::connect, on the same task as admit and
+    // report (the firmware's worker), so the table cannot move under it
+    const PeerRecord* record = lookup(peer, nowMs, false);
+    if (!record || !lockedAt(record->locked, record->lockedUntilMs, nowMs)) return true;
+    counts.refused++;
+    return false;
+}
+
+GuardVerdict PeerGuard::admit(uint64_t peer, uint32_t nowMs) {
+    PeerRecord* record = lookup(peer, nowMs, true);
+    refresh(*record, nowMs);
+    if (record->locked) return GUARD_DISCONNECT;
+
+    if (record->tokens < TOKEN_SCALE) {
+        counts.throttled++;
+        return strike(*record, 1, nowMs) == GUARD_DISCONNECT ? GUARD_DISCONNECT : GUARD_THROTTLE;
+    }
+    record->tokens -= TOKEN_SCALE;
+    return GUARD_PASS;
+}
+
+GuardVerdict PeerGuard::report(uint64_t peer, uint8_t offenses, uint32_t nowMs) {
+    if (offenses == 0) return GUARD_PASS;
+    PeerRecord* record = lookup(peer, nowMs, true);
+    refresh(*record, nowMs);
+
+    uint8_t count = __builtin_popcount(offenses);
+    counts.offenses += count;
+    uint32_t cost = (uint32_t)count * settings.offenseCost * TOKEN_SCALE;
+    record->tokens = record->tokens > cost ? record->tokens - cost : 0;
+    return strike(*record, count, nowMs);
+}
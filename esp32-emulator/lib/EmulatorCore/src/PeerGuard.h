@@ -0,0 +1,134 @@
+/**
+ * Per-peer rate limiting and lockout
+ *
+ * Optional defensive mode, to show what a robot could do about the
+ * attacks this project demonstrates. Every peer address gets a token
+ * bucket and a strike count in a small open-addressing table:
+ *
+ *   - each frame takes one token; a frame that finds the bucket empty is
+ *     dropped before it is decoded and earns a strike
+ *   - each offense (malformed frame, failed handshake, injection hit)
+ *     takes extra tokens and earns a strike; strikes decay over time
+ *   - at the strike limit the peer is disconnected and locked out, twice
+ *     as long on every repeat; a locked-out peer's connections are refused
+ *
+ * Lookups probe at most PEER_PROBE_LIMIT slots from the address hash, so
+ * every update is O(1) with no allocation. When a peer's window is full
+ * the quietest entry that is not locked out gives way. Addresses are what
+ * the link layer reports; a client that randomises its address per
+ * connection starts clean each time, which a real robot would counter by
+ * requiring bonding.
+ *
+ * The table has no lock. configure, allowConnect, admit and report must
+ * all come from one task (on the board, the worker, which also applies
+ * console profiles); stats() and tracked() are only for reports and may
+ * be read from elsewhere a moment out of date.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Profile applied at boot, e.g. -DPEER_GUARD_PROFILE='"on"' or
+// '"rate=8 burst=16 strikes=3"'; empty leaves the guard off
+#ifndef PEER_GUARD_PROFILE
+#define PEER_GUARD_PROFILE ""
+#endif
+
+// Table slots (power of two) and probe window per address
+#ifndef PEER_TABLE_SIZE
+#define PEER_TABLE_SIZE 64
+#endif
+#define PEER_PROBE_LIMIT 8
+
+static_assert((PEER_TABLE_SIZE & (PEER_TABLE_SIZE - 1)) == 0, "PEER_TABLE_SIZE must be a power of two");
+static_assert(PEER_TABLE_SIZE >= PEER_PROBE_LIMIT, "PEER_TABLE_SIZE smaller than the probe window");
+
+// What a frame did wrong, accumulated on the session while it is handled
+enum PeerOffense : uint8_t {
+    OFFENSE_MALFORMED = 0x01,   // bad length, checksum, opcode, instruction or seal
+    OFFENSE_AUTH      = 0x02,   // failed handshake
+    OFFENSE_INJECTION = 0x04    // injection detector hit in a field
+};
+
+enum GuardVerdict : uint8_t {
+    GUARD_PASS,         // handle the frame
+    GUARD_THROTTLE,     // drop the frame
+    GUARD_DISCONNECT    // drop the link; the peer is locked out
+};
+
+// Table key for a 6-byte link-layer address (least significant byte
+// first, as NimBLE holds it) and its public/random type
+inline uint64_t peerKey(const uint8_t* address, uint8_t type) {
+    uint64_t key = (uint64_t)type << 48;
+    for (size_t i = 0; i < 6; i++) key |= (uint64_t)address[i] << (8 * i);
+    return key;
+}
+
+// Key for transports that report no address: each connection its own peer
+#define PEER_PER_CONNECTION(connHandle) ((1ULL << 56) | (connHandle))
+
+struct GuardConfig {
+    uint16_t ratePerSecond = 16;   // bucket refill, frames per second
+    uint16_t burst = 32;           // bucket size, frames
+    uint16_t offenseCost = 8;      // extra tokens per offense
+    uint8_t strikeLimit = 5;
+    uint32_t strikeDecayMs = 10000;   // one strike forgiven per interval
+    uint32_t lockoutMs = 30000;       // first lockout; doubles per repeat
+};
+
+struct GuardStats {
+    uint32_t throttled = 0;     // frames dropped on an empty bucket
+    uint32_t offenses = 0;
+    uint32_t disconnects = 0;   // lockouts imposed
+    uint32_t refused = 0;       // connections from locked-out peers
+    uint32_t evictions = 0;     // peers forgotten to make room
+};
+
+class PeerGuard {
+public:
+    // Replace the settings from "key=value" pairs separated by spaces or
+    // commas and forget every peer. Keys: rate, burst, cost, strikes,
+    // decay (ms), lockout (ms). "on" enables with the defaults; "off" or ""
+    // disables. False on a bad key or value; the previous settings are kept.
+    bool configure(const char* spec);
+
+    bool enabled() const { return active; }
+    const GuardConfig& config() const { return settings; }
+    const GuardStats& stats() const { return counts; }
+    size_t tracked() const;
+
+    // A new connection from peer: false while it is locked out
+    bool allowConnect(uint64_t peer, uint32_t nowMs);
+
+    // Before a frame from peer is decoded: spend a token
+    GuardVerdict admit(uint64_t peer, uint32_t nowMs);
+
+    // After it was handled: charge the offenses it committed
+    GuardVerdict report(uint64_t peer, uint8_t offenses, uint32_t nowMs);
+
+    // Forget every peer and counter
+    void clear();
+
+private:
+    struct PeerRecord {
+        uint64_t peer;           // 0 = empty slot
+        uint32_t seenMs;         // last frame, for refill and eviction
+        uint32_t strikeMs;       // last strike decay step
+        uint32_t lockedUntilMs;
+        uint32_t tokens;         // thousandths of a frame
+        uint8_t strikes;
+        uint8_t lockouts;
+        bool locked;
+    };
+
+    PeerRecord* lookup(uint64_t peer, uint32_t nowMs, bool create);
+    void refresh(PeerRecord& record, uint32_t nowMs);
+    GuardVerdict strike(PeerRecord& record, uint8_t count, uint32_t nowMs);
+
+    PeerRecord table[PEER_TABLE_SIZE] = {};
+    GuardConfig settings;
+    GuardStats counts;
+    bool active = false;
+};
@@ -0,0 +1,32 @@
+/**
+ * Helpers for "key=value" profile strings
+ *
+ * Internal to EmulatorCore: shared by the fault injector and the peer
+ * guard, whose configure() parsers take the same token syntax. Values
+ * are copied into a small stack buffer, never the heap.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Parse one unsigned value between min and max; false on junk
+inline bool parseValue(const char* text, size_t len, unsigned long min, unsigned long max,
+                       unsigned long* out) {
+    char buffer[12];
+    if (len == 0 || len >= sizeof(buffer)) return false;
+    memcpy(buffer, text, len);
+    buffer[len] = '\0';
+
+    char* end = nullptr;
+    unsigned long value = strtoul(buffer, &end, 10);
+    if (*end != '\0' || value < min || value > max) return false;
+    *out = value;
+    return true;
+}
+
+inline bool keyIs(const char* key, size_t len, const char* name) {
+    return strlen(name) == len && memcmp(key, name, len) == 0;
+}
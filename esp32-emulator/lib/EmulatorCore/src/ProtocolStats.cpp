@@ -0,0 +1,46 @@
+#include "ProtocolStats.h"
+
+static uint8_t* putCounter(uint8_t* out, const std::atomic<uint32_t>& counter) {
+    uint32_t value = counter.load(std::memory_order_relaxed);
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+    return out + 4;
+}
+
+size_t ProtocolStats::snapshot(uint8_t* out) const {
+    uint8_t* p = out;
+    *p++ = STATS_VERSION;
+    *p++ = STATS_SLOTS;
+    *p++ = STATS_LATENCY_BUCKETS;
+    *p++ = HARDENED_PROTOCOL ? 1 : 0;
+
+    for (const Counter& counter : received) p = putCounter(p, counter);
+    for (const Counter& counter : sent) p = putCounter(p, counter);
+    p = putCounter(p, checksumFailures);
+    p = putCounter(p, lengthFailures);
+    p = putCounter(p, authRejects);
+    p = putCounter(p, invalidFrames);
+    p = putCounter(p, reassemblyTimeouts);
+    for (const Counter& counter : latencyBuckets) p = putCounter(p, counter);
+    p = putCounter(p, handshakes);
+    p = putCounter(p, handshakeTotalUs);
+    p = putCounter(p, handshakeMaxUs);
+
+    return p - out;
+}
+
+void ProtocolStats::reset() {
+    for (Counter& counter : received) counter.store(0, std::memory_order_relaxed);
+    for (Counter& counter : sent) counter.store(0, std::memory_order_relaxed);
+    checksumFailures.store(0, std::memory_order_relaxed);
+    lengthFailures.store(0, std::memory_order_relaxed);
+    authRejects.store(0, std::memory_order_relaxed);
+    invalidFrames.store(0, std::memory_order_relaxed);
+    reassemblyTimeouts.store(0, std::memory_order_relaxed);
+    for (Counter& counter : latencyBuckets) counter.store(0, std::memory_order_relaxed);
+    handshakes.store(0, std::memory_order_relaxed);
+    handshakeTotalUs.store(0, std::memory_order_relaxed);
+    handshakeMaxUs.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,96 @@
+/**
+ * Protocol and latency counters
+ *
+ * Per-instruction frame counts, validation failures and a write-to-notify
+ * latency histogram. Every counter is a relaxed std::atomic, so recording
+ * costs one atomic add from whichever task sees the event; histogram
+ * buckets are log2 of the latency in microseconds, found with one
+ * count-leading-zeros.
+ *
+ * snapshot() serialises everything for the statistics characteristic,
+ * little-endian:
+ *   u8  version (STATS_VERSION)
+ *   u8  instruction slots n (INSTR_MAX + 1; slot 0 = unknown instruction)
+ *   u8  latency buckets m
+ *   u8  profile (version 3): 0 vulnerable, 1 hardened (HARDENED_PROTOCOL)
+ *   u32 received[n], sent[n]
+ *   u32 checksumFailures, lengthFailures, authRejects, invalidFrames,
+ *       reassemblyTimeouts (version 2)
+ *   u32 latency[m]   bucket 0: < 1 us, bucket i: [2^(i-1), 2^i) us,
+ *                    last bucket: everything above
+ *   u32 handshakes, handshakeTotalUs, handshakeMaxUs (version 3): time
+ *       the emulator spent on each completed handshake (one write when
+ *       vulnerable; hello and proof together when hardened)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <HardenedChannel.h>
+#include <UnitreeProtocol.h>
+
+#define STATS_VERSION          3
+#define STATS_LATENCY_BUCKETS  24   // up to ~8 s
+#define STATS_SLOTS            (INSTR_MAX + 1)
+#define STATS_SNAPSHOT_SIZE    (4 + 4 * (2 * STATS_SLOTS + 5 + STATS_LATENCY_BUCKETS + 3))
+
+class ProtocolStats {
+public:
+    void frameReceived(uint8_t instruction) { bump(received[slot(instruction)]); }
+    void framesSent(uint8_t instruction, uint32_t count) {
+        sent[slot(instruction)].fetch_add(count, std::memory_order_relaxed);
+    }
+    void checksumFailure() { bump(checksumFailures); }
+    void lengthFailure() { bump(lengthFailures); }
+    void authReject() { bump(authRejects); }
+    void invalidFrame() { bump(invalidFrames); }
+    void reassemblyTimeout() { bump(reassemblyTimeouts); }
+
+    void latency(uint32_t us) {
+        size_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+        if (bucket >= STATS_LATENCY_BUCKETS) bucket = STATS_LATENCY_BUCKETS - 1;
+        bump(latencyBuckets[bucket]);
+    }
+
+    void handshake(uint32_t us) {
+        bump(handshakes);
+        handshakeTotalUs.fetch_add(us, std::memory_order_relaxed);
+        uint32_t max = handshakeMaxUs.load(std::memory_order_relaxed);
+        while (us > max && !handshakeMaxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Completed handshakes and the time they took, for the periodic report
+    void handshakeTimes(uint32_t& count, uint32_t& totalUs, uint32_t& maxUs) const {
+        count = handshakes.load(std::memory_order_relaxed);
+        totalUs = handshakeTotalUs.load(std::memory_order_relaxed);
+        maxUs = handshakeMaxUs.load(std::memory_order_relaxed);
+    }
+
+    uint32_t timeouts() const { return reassemblyTimeouts.load(std::memory_order_relaxed); }
+
+    // Serialise the counters into out (STATS_SNAPSHOT_SIZE bytes)
+    size_t snapshot(uint8_t* out) const;
+
+    void reset();
+
+private:
+    typedef std::atomic<uint32_t> Counter;
+
+    static void bump(Counter& counter) { counter.fetch_add(1, std::memory_order_relaxed); }
+    static size_t slot(uint8_t instruction) { return instruction <= INSTR_MAX ? instruction : 0; }
+
+    Counter received[STATS_SLOTS] = {};
+    Counter sent[STATS_SLOTS] = {};
+    Counter checksumFailures{0};
+    Counter lengthFailures{0};
+    Counter authRejects{0};
+    Counter invalidFrames{0};
+    Counter reassemblyTimeouts{0};
+    Counter latencyBuckets[STATS_LATENCY_BUCKETS] = {};
+    Counter handshakes{0};
+    Counter handshakeTotalUs{0};
+    Counter handshakeMaxUs{0};
+};
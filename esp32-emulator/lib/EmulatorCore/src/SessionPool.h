@@ -0,0 +1,139 @@
+/**
+ * Per-connection emulator sessions
+ *
+ * Each BLE connection gets its own authentication and SSID/password
+ * reassembly state, taken from a fixed pool keyed by connection handle so
+ * parallel clients never see each other's chunks.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <HardenedChannel.h>
+#include <UnitreeProtocol.h>
+#include "ChunkAssembler.h"
+#include "PeerGuard.h"
+
+// Concurrent sessions; follows the NimBLE connection limit unless overridden
+#ifndef MAX_SESSIONS
+#ifdef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define MAX_SESSIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#else
+#define MAX_SESSIONS 3
+#endif
+#endif
+
+#define SESSION_HANDLE_NONE 0xFFFF
+
+class EmulatorSession {
+public:
+    uint16_t connHandle = SESSION_HANDLE_NONE;
+    uint32_t generation = 0;         // which connection on connHandle this is; never 0 in use
+    bool authenticated = false;
+    uint16_t mtu = ATT_MTU_DEFAULT;  // negotiated ATT MTU, sizes reply chunks
+    uint16_t tracedMtu = 0;          // last MTU written to the session trace
+    uint64_t peer = 0;               // peer guard key for the client's address
+    uint8_t offenses = 0;            // PeerOffense flags of the frame being handled
+    bool cut = false;                // peer guard already asked for a disconnect
+    char ssid[REASSEMBLY_MAX_BYTES + 1] = {};
+    char password[REASSEMBLY_MAX_BYTES + 1] = {};
+    char country[FRAME_MAX_PAYLOAD + 1] = {};   // NULs dropped; any one frame fits
+    ChunkAssembler ssidChunks;
+    ChunkAssembler passwordChunks;
+#if HARDENED_PROTOCOL
+    HardenedChannel channel;         // per-connection key, set up by the hello exchange
+    uint32_t handshakeUs = 0;        // time spent on this session's hello so far
+#endif
+
+    bool inUse() const { return connHandle != SESSION_HANDLE_NONE; }
+
+    void reset() {
+        authenticated = false;
+        mtu = ATT_MTU_DEFAULT;
+        tracedMtu = 0;
+        peer = 0;
+        offenses = 0;
+        cut = false;
+        ssid[0] = '\0';
+        password[0] = '\0';
+        country[0] = '\0';
+        ssidChunks.reset();
+        passwordChunks.reset();
+#if HARDENED_PROTOCOL
+        channel.end();
+        handshakeUs = 0;
+#endif
+    }
+};
+
+class SessionPool {
+public:
+    // Session for connHandle, or nullptr if it has none
+    EmulatorSession* find(uint16_t connHandle) {
+        for (EmulatorSession& session : sessions) {
+            if (session.connHandle == connHandle) return &session;
+        }
+        return nullptr;
+    }
+
+    // Claim a fresh session for connHandle; nullptr when the pool is full.
+    // A slot still bound to connHandle belongs to an earlier connection
+    // whose release never arrived, and is reset for the new one. generation
+    // tells this connection apart from earlier ones on the same handle (0:
+    // the pool numbers it).
+    EmulatorSession* acquire(uint16_t connHandle, uint32_t generation = 0) {
+        EmulatorSession* slot = find(connHandle);
+        for (size_t i = 0; !slot && i < MAX_SESSIONS; i++) {
+            if (!sessions[i].inUse()) slot = &sessions[i];
+        }
+        if (!slot) return nullptr;
+
+        slot->reset();
+        slot->connHandle = connHandle;
+        slot->generation = generation ? generation : nextGeneration();
+        return slot;
+    }
+
+    // Free connHandle's session, unless generation (when not 0) names an
+    // earlier connection than the one holding it. False if nothing was freed.
+    bool release(uint16_t connHandle, uint32_t generation = 0) {
+        EmulatorSession* session = find(connHandle);
+        if (!session || (generation && session->generation != generation)) return false;
+        session->reset();
+        session->connHandle = SESSION_HANDLE_NONE;
+        session->generation = 0;
+        return true;
+    }
+
+    // Drop every session, as on an emulator restart
+    void releaseAll() {
+        for (EmulatorSession& session : sessions) {
+            session.reset();
+            session.connHandle = SESSION_HANDLE_NONE;
+            session.generation = 0;
+        }
+    }
+
+    size_t active() const {
+        size_t count = 0;
+        for (const EmulatorSession& session : sessions) {
+            if (session.inUse()) count++;
+        }
+        return count;
+    }
+
+    size_t capacity() const { return MAX_SESSIONS; }
+
+    // Stable slot of a pooled session, for per-connection side tables
+    size_t indexOf(const EmulatorSession& session) const { return &session - sessions; }
+
+private:
+    uint32_t nextGeneration() {
+        if (++generationCounter == 0) generationCounter = 1;
+        return generationCounter;
+    }
+
+    EmulatorSession sessions[MAX_SESSIONS];
+    uint32_t generationCounter = 0;
+};
@@ -0,0 +1,66 @@
+#include "SessionTrace.h"
+#include <string.h>
+
+void SessionTrace::begin(uint32_t firstSequence, uint32_t (*clock)()) {
+    sequence = firstSequence;
+    now = clock;
+    on = true;
+    record(TRACE_BOOT, 0xFFFF, 0, nullptr, 0);
+}
+
+bool SessionTrace::openBlock() {
+    if (states[fill].load(std::memory_order_acquire) != BLOCK_FREE) return false;
+
+    TraceBlockHeader header = {TRACE_MAGIC, sequence++, TRACE_VERSION, 0};
+    memcpy(blocks[fill], &header, sizeof(header));
+    used = sizeof(header);
+    states[fill].store(BLOCK_FILLING, std::memory_order_relaxed);
+    return true;
+}
+
+void SessionTrace::record(TraceType type, uint16_t connHandle, uint8_t instruction,
+                          const uint8_t* data, size_t len) {
+    if (!on) return;
+    if (len > 0xFF) len = 0xFF;
+    size_t need = sizeof(TraceRecordHeader) + len;
+
+    bool open = states[fill].load(std::memory_order_relaxed) == BLOCK_FILLING;
+    if (open && used + need > TRACE_BLOCK_SIZE) {
+        seal();
+        open = false;
+    }
+    if (!open && !openBlock()) {
+        droppedCount++;
+        return;
+    }
+
+    TraceRecordHeader header = {now ? now() : 0, connHandle, type, instruction, (uint8_t)len};
+    uint8_t* out = blocks[fill] + used;
+    memcpy(out, &header, sizeof(header));
+    if (len > 0) memcpy(out + sizeof(header), data, len);
+    used += need;
+    recordCount++;
+}
+
+void SessionTrace::seal() {
+    if (states[fill].load(std::memory_order_relaxed) != BLOCK_FILLING) return;
+
+    uint8_t* block = blocks[fill];
+    uint16_t usedBytes = (uint16_t)used;
+    memcpy(block + offsetof(TraceBlockHeader, used), &usedBytes, sizeof(usedBytes));
+    memset(block + used, 0xFF, TRACE_BLOCK_SIZE - used);
+
+    states[fill].store(BLOCK_SEALED, std::memory_order_release);
+    fill = (fill + 1) % TRACE_BLOCKS;
+}
+
+const uint8_t* SessionTrace::sealed() const {
+    if (states[drain].load(std::memory_order_acquire) != BLOCK_SEALED) return nullptr;
+    return blocks[drain];
+}
+
+void SessionTrace::written() {
+    states[drain].store(BLOCK_FREE, std::memory_order_release);
+    drain = (drain + 1) % TRACE_BLOCKS;
+    writtenCount++;
+}
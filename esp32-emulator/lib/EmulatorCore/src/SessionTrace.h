@@ -0,0 +1,92 @@
+/**
+ * Binary session trace
+ *
+ * Every decrypted request and reply frame becomes a compact record
+ * (timestamp, connection, type, instruction, frame bytes) in one of a few
+ * RAM blocks sized to a flash sector. Full blocks are sealed and handed to
+ * a writer (the flash task on the ESP32) so storage only ever sees whole,
+ * sequential sector writes. The packet worker is the single producer; when
+ * every block is still waiting for the writer, records are dropped and
+ * counted instead of stalling the worker.
+ *
+ * Block layout: TraceBlockHeader, then records up to header.used; the rest
+ * of the block is 0xFF, like erased flash. All fields are little-endian.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#define TRACE_BLOCK_SIZE  4096   // one flash sector
+#ifndef TRACE_BLOCKS
+#define TRACE_BLOCKS      2
+#endif
+#define TRACE_MAGIC       0x42525455UL  // "UTRB"
+#define TRACE_VERSION     1
+
+enum TraceType : uint8_t {
+    TRACE_REQUEST    = 0,   // decrypted request frame as received
+    TRACE_RESPONSE   = 1,   // decrypted reply frame, in transmit order
+    TRACE_MTU        = 2,   // u16 ATT MTU now in effect for the connection
+    TRACE_DISCONNECT = 3,   // session released
+    TRACE_BOOT       = 4,   // emulator (re)started; all sessions gone
+    TRACE_FAULT      = 5    // injected fault; layout by FaultKind in FaultInjector.h
+};
+
+struct __attribute__((packed)) TraceBlockHeader {
+    uint32_t magic;
+    uint32_t sequence;      // increases across blocks and reboots
+    uint16_t version;
+    uint16_t used;          // bytes in the block, header included
+};
+
+struct __attribute__((packed)) TraceRecordHeader {
+    uint32_t timestampUs;
+    uint16_t connHandle;
+    uint8_t type;
+    uint8_t instruction;
+    uint8_t len;            // data bytes that follow
+};
+
+class SessionTrace {
+public:
+    // Start recording; sequence numbers continue from firstSequence.
+    // clock supplies timestamps in microseconds (nullptr: all zero).
+    void begin(uint32_t firstSequence, uint32_t (*clock)());
+    void stop() { on = false; }
+    void resume() { on = true; }
+    bool enabled() const { return on; }
+
+    // Producer side (worker only)
+    void record(TraceType type, uint16_t connHandle, uint8_t instruction,
+                const uint8_t* data, size_t len);
+    void seal();   // close the open block early, e.g. before reading flash
+
+    // Writer side: oldest sealed block (TRACE_BLOCK_SIZE bytes) or nullptr;
+    // call written() once it is stored
+    const uint8_t* sealed() const;
+    void written();
+
+    uint32_t records() const { return recordCount; }
+    uint32_t dropped() const { return droppedCount; }
+    uint32_t blocksWritten() const { return writtenCount; }
+
+private:
+    enum BlockState : uint8_t { BLOCK_FREE, BLOCK_FILLING, BLOCK_SEALED };
+
+    bool openBlock();
+
+    uint8_t blocks[TRACE_BLOCKS][TRACE_BLOCK_SIZE];
+    std::atomic<uint8_t> states[TRACE_BLOCKS] = {};
+    size_t fill = 0;        // block the worker appends to
+    size_t drain = 0;       // next block for the writer
+    size_t used = 0;
+    uint32_t sequence = 0;
+    uint32_t (*now)() = nullptr;
+    bool on = false;
+    volatile uint32_t recordCount = 0;
+    volatile uint32_t droppedCount = 0;
+    volatile uint32_t writtenCount = 0;
+};
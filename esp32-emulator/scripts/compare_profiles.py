@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""RAM and flash cost of one firmware env against another.
+
+Builds two envs of a firmware project with `pio run -t size` and prints
+both footprints and the difference. By default the vulnerable and
+hardened profiles; --envs compares any pair, e.g. the cost of logging.
+
+    scripts/compare_profiles.py [project dir]     (default: esp32-emulator)
+    scripts/compare_profiles.py ../esp32-scanner
+    scripts/compare_profiles.py --envs esp32dev-release esp32dev
+    scripts/compare_profiles.py ../esp32-scanner --envs esp32dev-release esp32dev
+
+Static RAM only; the per-session key material and the larger worker stack
+show up at run time in the telemetry report (free heap, stack high-water).
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+DEFAULT_ENVS = ("esp32dev", "esp32dev-hardened")
+
+# "RAM:   [=         ]  13.9% (used 45532 bytes from 327680 bytes)"
+SIZE_LINE = re.compile(r"^(RAM|Flash):.*used (\d+) bytes from (\d+) bytes", re.MULTILINE)
+
+
+def footprint(project, env):
+    result = subprocess.run(["pio", "run", "-d", project, "-e", env, "-t", "size"],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0:
+        sys.stderr.write(result.stdout)
+        sys.exit("pio run -e %s failed" % env)
+    sizes = {kind: int(used) for kind, used, _ in SIZE_LINE.findall(result.stdout)}
+    if set(sizes) != {"RAM", "Flash"}:
+        sys.exit("no size summary in the output of env %s" % env)
+    return sizes
+
+
+def main():
+    default = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    parser = argparse.ArgumentParser(description="Flash/RAM difference between two PlatformIO envs")
+    parser.add_argument("project", nargs="?", default=default)
+    parser.add_argument("--envs", nargs=2, metavar=("BASE", "OTHER"), default=DEFAULT_ENVS)
+    args = parser.parse_args()
+    base, other = (footprint(args.project, env) for env in args.envs)
+
+    width = max(12, *(len(env) for env in args.envs))
+    print("%-6s %*s %*s %10s" % ("", width, args.envs[0], width, args.envs[1], "delta"))
+    for kind in ("Flash", "RAM"):
+        delta = other[kind] - base[kind]
+        print("%-6s %*d %*d %+10d (%+.1f%%)" % (kind, width, base[kind], width, other[kind], delta,
+                                                 100.0 * delta / base[kind]))
+
+
+if __name__ == "__main__":
+    main()
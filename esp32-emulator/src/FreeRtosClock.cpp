@@ -0,0 +1,43 @@
+#include "FreeRtosClock.h"
+
+FreeRtosClock boardClock;
+
+void FreeRtosClock::begin() {
+    for (Slot& slot : slots) {
+        slot.timer = xTimerCreate("clock", 1, pdFALSE, &slot, expired);
+    }
+}
+
+bool FreeRtosClock::callAfter(uint32_t ms, TimerCallback callback, void* context) {
+    // Claim a free slot; callers may be on any task
+    Slot* claimed = nullptr;
+    portENTER_CRITICAL(&lock);
+    for (Slot& slot : slots) {
+        if (!slot.busy && slot.timer) {
+            slot.busy = true;
+            claimed = &slot;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    if (!claimed) return false;
+
+    claimed->callback = callback;
+    claimed->context = context;
+
+    // A period of 0 ticks is invalid; round up to one
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+    if (xTimerChangePeriod(claimed->timer, ticks ? ticks : 1, 0) != pdPASS) {
+        claimed->busy = false;
+        return false;
+    }
+    return true;
+}
+
+void FreeRtosClock::expired(TimerHandle_t timer) {
+    Slot* slot = (Slot*)pvTimerGetTimerID(timer);
+    TimerCallback callback = slot->callback;
+    void* context = slot->context;
+    slot->busy = false;
+    callback(context);
+}
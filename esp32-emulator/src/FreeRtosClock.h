@@ -0,0 +1,42 @@
+/**
+ * Board clock for the emulator core
+ *
+ * Arduino micros()/millis(), sleeps that yield to FreeRTOS, and one-shot
+ * callbacks on a small pool of FreeRTOS software timers (run on the timer
+ * service task), so deferred work such as restarting advertising never
+ * blocks a BLE callback.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/timers.h>
+#include <EmulatorClock.h>
+
+#define CLOCK_TIMER_SLOTS 4
+
+class FreeRtosClock: public EmulatorClock {
+public:
+    // Create the timer pool; call before the first callAfter()
+    void begin();
+
+    uint32_t micros() override { return ::micros(); }
+    uint32_t millis() override { return ::millis(); }
+    void sleep(uint32_t ms) override { vTaskDelay(pdMS_TO_TICKS(ms)); }
+    bool callAfter(uint32_t ms, TimerCallback callback, void* context) override;
+
+private:
+    struct Slot {
+        TimerHandle_t timer;
+        TimerCallback callback;
+        void* context;
+        volatile bool busy;
+    };
+
+    static void expired(TimerHandle_t timer);
+
+    Slot slots[CLOCK_TIMER_SLOTS] = {};
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+};
+
+extern FreeRtosClock boardClock;
@@ -0,0 +1,76 @@
+#include "TraceStore.h"
+#include <esp_partition.h>
+
+// Log level for this file (-DLOG_LEVEL_BLE=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_BLE
+#define LOG_LEVEL_BLE LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_BLE
+
+static const esp_partition_t* partition = nullptr;
+static size_t capacity = 0;      // whole sectors only
+static size_t writeOffset = 0;
+
+static uint32_t traceClock() {
+    return emulatorClock().micros();
+}
+
+// Sequence to continue from: one past the newest block already stored
+static uint32_t scanPartition() {
+    bool found = false;
+    uint32_t newest = 0;
+    size_t newestOffset = 0;
+
+    for (size_t offset = 0; offset < capacity; offset += TRACE_BLOCK_SIZE) {
+        TraceBlockHeader header;
+        if (esp_partition_read(partition, offset, &header, sizeof(header)) != ESP_OK) continue;
+        if (header.magic != TRACE_MAGIC) continue;
+        if (!found || (int32_t)(header.sequence - newest) > 0) {
+            newest = header.sequence;
+            newestOffset = offset;
+            found = true;
+        }
+    }
+
+    writeOffset = found ? (newestOffset + TRACE_BLOCK_SIZE) % capacity : 0;
+    return found ? newest + 1 : 0;
+}
+
+// Writer task: one erase + one sector write per sealed block
+static void traceTask(void* param) {
+    for (;;) {
+        while (const uint8_t* block = sessionTrace.sealed()) {
+            esp_err_t err = esp_partition_erase_range(partition, writeOffset, TRACE_BLOCK_SIZE);
+            if (err == ESP_OK) {
+                err = esp_partition_write(partition, writeOffset, block, TRACE_BLOCK_SIZE);
+            }
+            if (err != ESP_OK) {
+                LOG_ERROR("Error: trace write at 0x%x failed (%d)\n", (unsigned)writeOffset, err);
+            }
+            writeOffset = (writeOffset + TRACE_BLOCK_SIZE) % capacity;
+            sessionTrace.written();
+        }
+        vTaskDelay(pdMS_TO_TICKS(TRACE_FLUSH_INTERVAL_MS));
+    }
+}
+
+bool traceStoreBegin() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         TRACE_PARTITION_LABEL);
+    if (!partition) return false;
+
+    capacity = partition->size - partition->size % TRACE_BLOCK_SIZE;
+    if (capacity == 0) return false;
+
+    sessionTrace.begin(scanPartition(), traceClock);
+    xTaskCreate(traceTask, "trace_flash", TRACE_TASK_STACK_SIZE, nullptr, TRACE_TASK_PRIORITY, nullptr);
+    return true;
+}
+
+size_t traceStoreCapacity() {
+    return capacity;
+}
+
+size_t traceStoreOffset() {
+    return writeOffset;
+}
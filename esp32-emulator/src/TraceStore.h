@@ -0,0 +1,30 @@
+/**
+ * Flash writer for the session trace
+ *
+ * Sealed trace blocks go to the "trace" data partition (see
+ * partitions.csv) one whole sector at a time, as a circular log: each
+ * write erases the next sector, so the partition always holds the newest
+ * blocks. At boot the sector headers are scanned and sequence numbers
+ * continue after the newest one.
+ *
+ * Read it back with `esptool.py read_flash 0x200000 0x200000 trace.bin`
+ * and replay it with the host `replay` env.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <EmulatorCore.h>
+
+#define TRACE_PARTITION_LABEL    "trace"
+#define TRACE_FLUSH_INTERVAL_MS  100
+#define TRACE_TASK_STACK_SIZE    3072
+#define TRACE_TASK_PRIORITY      (tskIDLE_PRIORITY + 1)
+
+// Find the partition, start sessionTrace and the writer task. False (trace
+// stays off) when the partition table has no trace partition.
+bool traceStoreBegin();
+
+// Bytes of partition in use as a circular log, and where the next block goes
+size_t traceStoreCapacity();
+size_t traceStoreOffset();
@@ -0,0 +1,197 @@
+#include "TxQueue.h"
+
+// Log level for this file (-DLOG_LEVEL_BLE=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_BLE
+#define LOG_LEVEL_BLE LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_BLE
+
+struct TxFrame {
+    uint16_t connHandle;
+    uint32_t generation;    // session the frame was queued for
+    uint8_t len;
+    bool last;              // final frame of a reply
+    uint32_t writeStart;
+    uint32_t dueMs;         // millis() before which it is held (injected delay)
+    uint8_t data[FRAME_MAX_SIZE];
+};
+
+TxStats txStats;
+
+static QueueHandle_t txQueues[MAX_SESSIONS];
+
+// Session each slot's queue currently serves, set by the worker (the pool's
+// only user); 0 once it is released. The transmit task compares frames
+// against it and never looks at the pool itself.
+static volatile uint32_t txGenerations[MAX_SESSIONS];
+
+// End of the latest injected delay or stall per slot (worker only); later
+// frames on the connection wait for it, other connections do not
+static uint32_t txHeldUntil[MAX_SESSIONS];
+
+static SemaphoreHandle_t txPending = nullptr;   // given per frame queued, wakes the transmit task
+static TaskHandle_t txTaskHandle = nullptr;
+static NimBLECharacteristic* txCharacteristic = nullptr;
+
+enum TxResult : uint8_t {
+    TX_SENT,
+    TX_FAILED,
+    TX_STALE     // its session is gone, maybe replaced on the same handle
+};
+
+// Hand one frame to the stack, waiting out mbuf exhaustion. The stack
+// reports the notify's status inside notify() itself, so a refusal is
+// followed by a real back-off (doubling up to TX_RETRY_MAX_MS); only a
+// tx-complete from another task can end the wait early.
+static TxResult sendFrame(const TxFrame& frame, size_t slot) {
+    uint32_t backoffMs = TX_RETRY_MIN_MS;
+    for (int attempt = 0; ; attempt++) {
+        if (txGenerations[slot] != frame.generation) return TX_STALE;
+
+        if (txCharacteristic->notify(frame.data, frame.len, frame.connHandle)) return TX_SENT;
+        if (attempt == TX_MAX_RETRIES) return TX_FAILED;
+
+        txStats.retries++;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(backoffMs));
+        backoffMs = backoffMs * 2 > TX_RETRY_MAX_MS ? TX_RETRY_MAX_MS : backoffMs * 2;
+    }
+}
+
+// Wrap-safe: whether millis() value a is later than b
+static bool after(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+// Transmit task: one frame per pass, next connection first. A connection
+// whose head frame is held for an injected delay is passed over; with
+// nothing due, the task sleeps until the earliest held frame or a new one.
+static void txTask(void* param) {
+    size_t next = 0;
+    TxFrame frame;
+    for (;;) {
+        uint32_t now = emulatorClock().millis();
+        TickType_t wait = portMAX_DELAY;
+        bool found = false;
+        size_t slot = 0;
+        for (size_t i = 0; i < MAX_SESSIONS && !found; i++) {
+            slot = (next + i) % MAX_SESSIONS;
+            if (xQueuePeek(txQueues[slot], &frame, 0) != pdTRUE) continue;
+            if (after(frame.dueMs, now) && txGenerations[slot] == frame.generation) {
+                TickType_t held = pdMS_TO_TICKS(frame.dueMs - now);
+                if (held < wait) wait = held > 0 ? held : 1;
+                continue;
+            }
+            xQueueReceive(txQueues[slot], &frame, 0);
+            next = slot + 1;
+            found = true;
+        }
+        if (!found) {
+            xSemaphoreTake(txPending, wait);
+            continue;
+        }
+
+        TxResult result = sendFrame(frame, slot);
+        if (result == TX_STALE) {
+            txStats.stale++;
+            continue;
+        }
+        if (result == TX_FAILED) {
+            txStats.failed++;
+            LOG_WARN("    Warning: notify to conn %u dropped\n", frame.connHandle);
+            continue;
+        }
+        txStats.sent++;
+        if (frame.last) {
+            uint32_t latencyUs = emulatorClock().micros() - frame.writeStart;
+            protocolStats.latency(latencyUs);
+            LOG_DEBUG("    Response sent (write to last notify: %lu us)\n", (unsigned long)latencyUs);
+        }
+    }
+}
+
+void txBegin(NimBLECharacteristic* characteristic, UBaseType_t priority, BaseType_t core) {
+    txCharacteristic = characteristic;
+    for (size_t i = 0; i < MAX_SESSIONS; i++) {
+        txQueues[i] = xQueueCreate(TX_QUEUE_DEPTH, sizeof(TxFrame));
+    }
+    txPending = xSemaphoreCreateCounting(MAX_SESSIONS * TX_QUEUE_DEPTH, 0);
+    xTaskCreatePinnedToCore(txTask, "unitree_tx", TX_TASK_STACK_SIZE, nullptr,
+                            priority, &txTaskHandle, core);
+}
+
+bool txEnqueue(const EmulatorSession& session, const Response& response, uint32_t writeStart) {
+    size_t slot = sessions.indexOf(session);
+    QueueHandle_t queue = txQueues[slot];
+
+    // A slot reused without a release: older frames still queued are stale
+    if (txGenerations[slot] != session.generation) {
+        txGenerations[slot] = session.generation;
+        txHeldUntil[slot] = 0;
+    }
+
+    // The delay holds this reply and everything after it on the connection
+    uint32_t now = emulatorClock().millis();
+    uint32_t dueMs = now + response.delayMs;
+    if (after(txHeldUntil[slot], dueMs)) dueMs = txHeldUntil[slot];
+    txHeldUntil[slot] = dueMs;
+
+    // A held connection's full queue must not hold the worker for the others
+    TickType_t enqueueWait = after(dueMs, now) ? 0 : pdMS_TO_TICKS(TX_ENQUEUE_TIMEOUT_MS);
+
+    // Frames are queued one behind, so the final one can be flagged
+    TxFrame frame;
+    frame.connHandle = session.connHandle;
+    frame.generation = session.generation;
+    frame.writeStart = writeStart;
+    frame.dueMs = dueMs;
+    frame.last = false;
+    bool pending = false;
+    bool ok = true;
+
+    auto push = [&]() {
+        // Backpressure: a full queue holds the worker, and with it the RX queue
+        if (xQueueSend(queue, &frame, enqueueWait) != pdTRUE) {
+            txStats.rejected++;
+            ok = false;
+            return;
+        }
+        txStats.queued++;
+        xSemaphoreGive(txPending);
+
+        uint32_t depth = txDepth();
+        if (depth > txStats.maxDepth) txStats.maxDepth = depth;
+    };
+
+    response.forEachFrame([&](const uint8_t* data, size_t len) {
+        if (pending) push();
+        frame.len = len;
+        memcpy(frame.data, data, len);
+        pending = true;
+    });
+    if (pending) {
+        frame.last = true;
+        push();
+    }
+    return ok;
+}
+
+void txRelease(const EmulatorSession& session) {
+    txGenerations[sessions.indexOf(session)] = 0;
+}
+
+void txComplete(int code) {
+    // Raised inside the transmit task's own notify(): notify()'s result
+    // already says how it went, and waking itself would skip the back-off
+    if (!txTaskHandle || xTaskGetCurrentTaskHandle() == txTaskHandle) return;
+
+    // From another task (the host task), buffers were freed; let a waiting retry go
+    xTaskNotifyGive(txTaskHandle);
+}
+
+size_t txDepth() {
+    size_t depth = 0;
+    for (size_t i = 0; i < MAX_SESSIONS; i++) {
+        if (txQueues[i]) depth += uxQueueMessagesWaiting(txQueues[i]);
+    }
+    return depth;
+}
@@ -0,0 +1,61 @@
+/**
+ * Outbound notification queue
+ *
+ * The worker queues reply frames per connection and moves on; a transmit
+ * task hands them to NimBLE. When notify() fails because the stack is out
+ * of mbufs, the frame is retried after a back-off that doubles from
+ * TX_RETRY_MIN_MS to TX_RETRY_MAX_MS, cut short by a tx-complete raised on
+ * another task, instead of sleeping a fixed time after every reply. Each
+ * frame is counted once, as sent, failed or stale. Connections are served round-robin so one congested
+ * client does not starve the others. An injected delay or stall holds
+ * only its own connection: frames carry a due time, and the worker never
+ * sleeps for them. Frames carry their session's
+ * generation; those left behind when a session goes are dropped, never
+ * sent to the next client on the same handle.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <EmulatorCore.h>
+
+#define TX_QUEUE_DEPTH         4     // frames per connection
+#define TX_RETRY_MIN_MS        2     // first back-off after notify() is refused
+#define TX_RETRY_MAX_MS        50
+#define TX_MAX_RETRIES         10    // about 300 ms of back-off in all
+#define TX_ENQUEUE_TIMEOUT_MS  500   // worker waits this long for queue space
+#define TX_TASK_STACK_SIZE     4096
+
+// Notification counters, in frames, written by the worker and the transmit task
+struct TxStats {
+    volatile uint32_t queued = 0;     // frames accepted from the worker
+    volatile uint32_t rejected = 0;   // not queued, the queue stayed full
+    volatile uint32_t sent = 0;       // accepted by notify()
+    volatile uint32_t failed = 0;     // dropped, out of retries
+    volatile uint32_t retries = 0;    // notify() refused, waited for buffers
+    volatile uint32_t stale = 0;      // dropped, their session was released
+    volatile uint32_t maxDepth = 0;
+};
+
+extern TxStats txStats;
+
+// Create the per-session queues and the transmit task
+void txBegin(NimBLECharacteristic* characteristic, UBaseType_t priority, BaseType_t core);
+
+// Queue the frames of response for session in transmit order, honouring
+// its drop/duplicate/reorder marks and holding them (and any later reply
+// on the connection) for its delayMs; a response with no frames is a
+// stall. Blocks while the queue is full, unless the connection is held.
+// writeStart (micros() in onWrite) feeds the latency log.
+bool txEnqueue(const EmulatorSession& session, const Response& response, uint32_t writeStart);
+
+// session is being released (worker only): its queued frames are dropped
+void txRelease(const EmulatorSession& session);
+
+// Tx-complete from the notify characteristic's onStatus; ignored when
+// raised inside the transmit task's own notify()
+void txComplete(int code);
+
+// Frames waiting across all connections
+size_t txDepth();
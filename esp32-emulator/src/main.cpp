@@ -10,520 +10,399 @@
 
 #include <Arduino.h>
 #include <NimBLEDevice.h>
-#include "mbedtls/aes.h"
-#include <vector>
-#include <string>
-
-// BLE Service and Characteristic UUIDs (from Unitree protocol)
-#define SERVICE_UUID           "0000ffe0-0000-1000-8000-00805f9b34fb"
-#define CHARACTERISTIC_NOTIFY  "0000ffe1-0000-1000-8000-00805f9b34fb"
-#define CHARACTERISTIC_WRITE   "0000ffe2-0000-1000-8000-00805f9b34fb"
-
-// AES Encryption constants (hardcoded in Unitree firmware)
-const uint8_t AES_KEY[16] = {
-    0xdf, 0x98, 0xb7, 0x15, 0xd5, 0xc6, 0xed, 0x2b,
-    0x25, 0x81, 0x7b, 0x6f, 0x25, 0x54, 0x12, 0x4a
-};
-
-const uint8_t AES_IV[16] = {
-    0x28, 0x41, 0xae, 0x97, 0x41, 0x9c, 0x29, 0x73,
-    0x29, 0x6a, 0x0d, 0x4b, 0xdf, 0xe1, 0x9a, 0x4f
-};
-
-// Packet opcodes
-#define OPCODE_REQUEST   0x52
-#define OPCODE_RESPONSE  0x51
-
-// Instructions
-#define INSTR_HANDSHAKE      0x01
-#define INSTR_GET_SERIAL     0x02
-#define INSTR_INIT_WIFI      0x03
-#define INSTR_SET_SSID       0x04
-#define INSTR_SET_PASSWORD   0x05
-#define INSTR_SET_COUNTRY    0x06
+#include <EmulatorCore.h>
+#include <EmulatorEndpoint.h>
+#include <UnitreeLog.h>
+#include <SystemTelemetry.h>
+#include "FreeRtosClock.h"
+#include "TxQueue.h"
+#include "TraceStore.h"
+
+// Log level for this file (-DLOG_LEVEL_BLE=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_BLE
+#define LOG_LEVEL_BLE LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_BLE
 
 // Device configuration
 #define DEVICE_NAME "Go2_ESP32EMU"
-#define SERIAL_NUMBER "ESP32-EMULATOR-v1.0-TESTDEVICE"
 
-// Global state
-class UnitreeEmulator {
-public:
-    bool authenticated = false;
-    String ssid = "";
-    String password = "";
-    String country = "";
-    std::vector<uint8_t> ssidBuffer;
-    std::vector<uint8_t> passwordBuffer;
-    int ssidChunksReceived = 0;
-    int passwordChunksReceived = 0;
-    int ssidTotalChunks = 0;
-    int passwordTotalChunks = 0;
-
-    void reset() {
-        authenticated = false;
-        ssid = "";
-        password = "";
-        country = "";
-        ssidBuffer.clear();
-        passwordBuffer.clear();
-        ssidChunksReceived = 0;
-        passwordChunksReceived = 0;
-        ssidTotalChunks = 0;
-        passwordTotalChunks = 0;
-    }
-};
+// Worker task: frames are decoded and answered off the NimBLE host task
+#define RX_QUEUE_LENGTH     8
+#define RX_LINK_RESERVE     (2 * MAX_SESSIONS + 2)   // queue slots frames leave free for link events
+#define RX_LINK_TIMEOUT_MS  20     // longest the host task waits to queue a link event
+#if HARDENED_PROTOCOL
+#define WORKER_STACK_SIZE   12288   // X25519 runs in mbedTLS bignum code on the worker
+#else
+#define WORKER_STACK_SIZE   8192
+#endif
+#define WORKER_PRIORITY     2
+#define TX_PRIORITY         3   // drains replies ahead of new requests
+#ifndef WORKER_CORE
+#define WORKER_CORE         1   // NimBLE host runs on core 0
+#endif
+#define STATS_INTERVAL_MS   10000
+#define ADVERTISE_RESTART_MS 100   // after a disconnect
+
+// Protocol statistics service (layout in ProtocolStats.h)
+#define STATS_SERVICE_UUID        "c0de57a7-0000-4a5e-8e11-756e6970776e"
+#define STATS_CHARACTERISTIC_UUID "c0de57a7-0001-4a5e-8e11-756e6970776e"
+#define TELEMETRY_CHARACTERISTIC_UUID "c0de57a7-0002-4a5e-8e11-756e6970776e"
+#define STATS_NOTIFY_MS           1000
 
-UnitreeEmulator emulator;
 NimBLECharacteristic* pNotifyCharacteristic = nullptr;
+NimBLECharacteristic* pStatsCharacteristic = nullptr;
+NimBLECharacteristic* pTelemetryCharacteristic = nullptr;
+
+// Work item handed from the BLE callbacks to the worker
+enum RxEventType : uint8_t {
+    RX_FRAME,
+    RX_CONNECT,
+    RX_MTU,
+    RX_DISCONNECT,
+    RX_FAULT_PROFILE,   // data holds a NUL-terminated profile from the console
+    RX_GUARD_PROFILE,   // likewise for the peer guard
+    RX_TRACE_COMMAND    // data holds "on", "off" or "flush"
+};
 
-// mbedTLS AES context
-mbedtls_aes_context aes_ctx;
-
-void initCrypto() {
-    mbedtls_aes_init(&aes_ctx);
-    // Set encryption key (same key is used for both encrypt and decrypt in CFB mode)
-    mbedtls_aes_setkey_enc(&aes_ctx, AES_KEY, 128);
-}
-
-std::vector<uint8_t> decryptData(const uint8_t* data, size_t len) {
-    std::vector<uint8_t> output(len);
-
-    // Make a copy of IV since mbedtls modifies it
-    uint8_t iv_copy[16];
-    memcpy(iv_copy, AES_IV, 16);
-
-    size_t iv_offset = 0;
-
-    // Decrypt using AES-CFB128
-    int ret = mbedtls_aes_crypt_cfb128(&aes_ctx, MBEDTLS_AES_DECRYPT, len,
-                                       &iv_offset, iv_copy, data, output.data());
-
-    if (ret != 0) {
-        Serial.printf("Error: mbedTLS decryption failed: -0x%04X\n", -ret);
-    }
+struct RxEvent {
+    RxEventType type;
+    uint16_t connHandle;
+    uint32_t generation;    // link the event belongs to (linkOpen)
+    uint16_t len;
+    uint16_t mtu;           // RX_CONNECT, RX_MTU
+    uint64_t peer;          // RX_CONNECT: peerKey() of the client's address
+    uint32_t writeStart;
+    uint8_t data[FRAME_MAX_SIZE];
+};
 
-    return output;
-}
+QueueHandle_t rxQueue = nullptr;
 
-std::vector<uint8_t> encryptData(const uint8_t* data, size_t len) {
-    std::vector<uint8_t> output(len);
+// Queue health, written by the host task and read by loop()
+struct RxStats {
+    volatile uint32_t received = 0;
+    volatile uint32_t dropped = 0;
+    volatile uint32_t oversized = 0;
+    volatile uint32_t maxDepth = 0;
+    volatile uint32_t maxCallbackUs = 0;
+    volatile uint32_t linkDropped = 0;   // link events that found no queue space
+};
 
-    // Make a copy of IV since mbedtls modifies it
-    uint8_t iv_copy[16];
-    memcpy(iv_copy, AES_IV, 16);
+RxStats rxStats;
 
-    size_t iv_offset = 0;
+// Connections as the host task sees them. Each gets a generation, so the
+// worker can tell a late event for an earlier connection from one for the
+// connection now on the same handle. Touched by the host task only.
+#define LINK_TABLE_SIZE (MAX_SESSIONS + 2)
 
-    // Encrypt using AES-CFB128
-    int ret = mbedtls_aes_crypt_cfb128(&aes_ctx, MBEDTLS_AES_ENCRYPT, len,
-                                       &iv_offset, iv_copy, data, output.data());
+struct LinkEntry {
+    uint16_t connHandle = SESSION_HANDLE_NONE;
+    uint32_t generation = 0;
+};
 
-    if (ret != 0) {
-        Serial.printf("Error: mbedTLS encryption failed: -0x%04X\n", -ret);
+LinkEntry links[LINK_TABLE_SIZE];
+uint32_t lastLinkGeneration = 0;
+
+// Generation of a new connection; 0 when the table is full
+uint32_t linkOpen(uint16_t connHandle) {
+    for (LinkEntry& link : links) {
+        if (link.connHandle == SESSION_HANDLE_NONE || link.connHandle == connHandle) {
+            if (++lastLinkGeneration == 0) lastLinkGeneration = 1;
+            link.connHandle = connHandle;
+            link.generation = lastLinkGeneration;
+            return link.generation;
+        }
     }
-
-    return output;
+    return 0;
 }
 
-// Calculate checksum (2's complement)
-uint8_t calculateChecksum(const std::vector<uint8_t>& data) {
-    uint32_t sum = 0;
-    for (size_t i = 0; i < data.size(); i++) {
-        sum += data[i];
+uint32_t linkGeneration(uint16_t connHandle) {
+    for (const LinkEntry& link : links) {
+        if (link.connHandle == connHandle) return link.generation;
     }
-    return (-sum) & 0xFF;
+    return 0;
 }
 
-// Validate packet checksum
-bool validateChecksum(const std::vector<uint8_t>& packet) {
-    if (packet.size() < 4) return false;
-
-    uint32_t sum = 0;
-    for (size_t i = 0; i < packet.size(); i++) {
-        sum += packet[i];
+void linkClose(uint16_t connHandle) {
+    for (LinkEntry& link : links) {
+        if (link.connHandle == connHandle) link = LinkEntry();
     }
-    return (sum & 0xFF) == 0;
 }
 
-// Create response packet
-std::vector<uint8_t> createResponse(uint8_t instruction, const std::vector<uint8_t>& data) {
-    std::vector<uint8_t> packet;
-
-    packet.push_back(OPCODE_RESPONSE);
-
-    // Length = instruction + data + checksum + 2
-    uint8_t length = 1 + data.size() + 1 + 2;
-    packet.push_back(length);
-
-    packet.push_back(instruction);
-
-    for (uint8_t byte : data) {
-        packet.push_back(byte);
-    }
-
-    uint8_t checksum = calculateChecksum(packet);
-    packet.push_back(checksum);
-
-    // Encrypt the packet
-    auto encrypted = encryptData(packet.data(), packet.size());
-
-    return encrypted;
+// Link events take the reserved queue space and may wait briefly for it,
+// but never hold the host task for long
+bool queueLinkEvent(RxEventType type, uint16_t connHandle, uint32_t generation, uint16_t mtu = 0,
+                    uint64_t peer = 0) {
+    RxEvent event;
+    event.type = type;
+    event.connHandle = connHandle;
+    event.generation = generation;
+    event.len = 0;
+    event.mtu = mtu;
+    event.peer = peer;
+    if (xQueueSend(rxQueue, &event, pdMS_TO_TICKS(RX_LINK_TIMEOUT_MS)) == pdTRUE) return true;
+    rxStats.linkDropped++;
+    return false;
 }
 
-// Print hex data for debugging
-void printHex(const char* label, const uint8_t* data, size_t len) {
-    Serial.printf("%s [%d bytes]: ", label, len);
-    for (size_t i = 0; i < len; i++) {
-        Serial.printf("%02X ", data[i]);
-        if ((i + 1) % 16 == 0 && i < len - 1) {
-            Serial.printf("\n                  ");
+// Replies go to the transmit task, which notifies only the requesting
+// client. token is the micros() timestamp taken on entry to onWrite.
+class NotifyTransport: public EmulatorTransport {
+public:
+    bool send(EmulatorSession& session, const Response& response, uint32_t token) {
+        if (!pNotifyCharacteristic) {
+            LOG_ERROR("    Error: notify characteristic unavailable\n");
+            return false;
         }
-    }
-    Serial.println();
-}
-
-void printHex(const char* label, const std::vector<uint8_t>& data) {
-    printHex(label, data.data(), data.size());
-}
-
-// Handle Instruction 1: Handshake/Authentication
-std::vector<uint8_t> handleHandshake(const std::vector<uint8_t>& packet) {
-    // Packet format: [0x52, len, 0x01, 0x00, 0x00, 'u','n','i','t','r','e','e', checksum]
-    if (packet.size() < 12) {
-        Serial.println("    Error: packet too short");
-        return createResponse(INSTR_HANDSHAKE, {0x00}); // Failure
-    }
-
-    // Extract the authentication string (should be "unitree")
-    String authString = "";
-    for (size_t i = 5; i < packet.size() - 1; i++) {
-        authString += (char)packet[i];
-    }
-
-    Serial.printf("    Auth string: %s\n", authString.c_str());
-
-    if (authString == "unitree") {
-        emulator.authenticated = true;
-        Serial.println("    Status: accepted");
-        return createResponse(INSTR_HANDSHAKE, {0x01}); // Success
-    } else {
-        emulator.authenticated = false;
-        Serial.println("    Status: rejected");
-        return createResponse(INSTR_HANDSHAKE, {0x00}); // Failure
-    }
-}
-
-// Handle Instruction 2: Get Serial Number
-std::vector<uint8_t> handleGetSerial(const std::vector<uint8_t>& packet) {
-    if (!emulator.authenticated) {
-        Serial.println("    Error: not authenticated");
-        return createResponse(INSTR_GET_SERIAL, {0x00}); // Not authenticated
-    }
-
-    Serial.printf("    Serial number: %s\n", SERIAL_NUMBER);
-
-    // For simplicity, send serial in one chunk
-    // Format: [chunk_index, total_chunks, data...]
-    std::vector<uint8_t> response;
-    response.push_back(0x01); // Chunk 1
-    response.push_back(0x01); // Total 1 chunk
-
-    // Add serial number bytes
-    for (char c : String(SERIAL_NUMBER)) {
-        response.push_back((uint8_t)c);
+        if (!txEnqueue(session, response, token)) {
+            LOG_ERROR("    Error: transmit queue full\n");
+            return false;
+        }
+        // An injected delay or stall is held by the transmit task, per
+        // connection, so the worker goes on serving the others
+        if (response.len == 0) return true;
+        LOG_DEBUG("    Response queued (%u chunks)\n", (unsigned)response.frames());
+        return true;
     }
 
-    return createResponse(INSTR_GET_SERIAL, response);
-}
-
-// Handle Instruction 3: Initialize WiFi
-std::vector<uint8_t> handleInitWiFi(const std::vector<uint8_t>& packet) {
-    if (packet.size() < 4) {
-        Serial.println("    Error: packet too short");
-        return createResponse(INSTR_INIT_WIFI, {0x00});
+    // Peer guard lockout; the disconnect event then frees the session as usual
+    void disconnect(EmulatorSession& session) {
+        NimBLEDevice::getServer()->disconnect(session.connHandle);
     }
+};
 
-    uint8_t mode = packet[3];
-
-    if (mode == 0x01) {
-        Serial.println("    Mode: access point");
-    } else if (mode == 0x02) {
-        Serial.println("    Mode: station");
+NotifyTransport notifyTransport;
+EmulatorEndpoint endpoint(notifyTransport);
+
+// Console "trace" commands, run on the worker (the trace's only producer)
+void handleTraceCommand(const char* command) {
+    if (strcmp(command, "off") == 0) {
+        sessionTrace.stop();
+    } else if (strcmp(command, "on") == 0) {
+        sessionTrace.resume();
+    } else if (strcmp(command, "flush") == 0) {
+        sessionTrace.seal();
     } else {
-        Serial.printf("    Mode: unknown (0x%02X)\n", mode);
+        LOG_ERROR("Error: unknown trace command: %s\n", command);
+        return;
     }
-
-    return createResponse(INSTR_INIT_WIFI, {0x01}); // Success
+    LOG_INFO("[*] Trace %s: %u records, %u dropped, %u blocks written, next offset 0x%x\n",
+             command, (unsigned)sessionTrace.records(), (unsigned)sessionTrace.dropped(),
+             (unsigned)sessionTrace.blocksWritten(), (unsigned)traceStoreOffset());
 }
 
-// Handle Instruction 4: Set SSID
-std::vector<uint8_t> handleSetSSID(const std::vector<uint8_t>& packet) {
-    if (packet.size() < 5) {
-        Serial.println("    Error: packet too short");
-        return createResponse(INSTR_SET_SSID, {0x00});
-    }
-
-    uint8_t chunkIndex = packet[3];
-    uint8_t totalChunks = packet[4];
-
-    // Extract chunk data
-    for (size_t i = 5; i < packet.size() - 1; i++) {
-        emulator.ssidBuffer.push_back(packet[i]);
-    }
-
-    emulator.ssidChunksReceived++;
-
-    if (emulator.ssidChunksReceived == 1) {
-        Serial.printf("    SSID chunks: %d\n", totalChunks);
-    }
-
-    if (emulator.ssidChunksReceived >= totalChunks) {
-        // All chunks received - send response
-        emulator.ssid = "";
-        for (uint8_t byte : emulator.ssidBuffer) {
-            emulator.ssid += (char)byte;
+// Worker task: drains the RX queue so BLE callbacks return immediately
+void workerTask(void* param) {
+    RxEvent event;
+    for (;;) {
+        if (xQueueReceive(rxQueue, &event, portMAX_DELAY) != pdTRUE) continue;
+
+        if (event.type == RX_CONNECT) {
+            if (!endpoint.connect(event.connHandle, event.mtu, event.peer, event.generation)) {
+                LOG_ERROR("    Error: session limit (%u) reached or peer locked out, disconnecting\n",
+                          (unsigned)sessions.capacity());
+                NimBLEDevice::getServer()->disconnect(event.connHandle);
+                continue;
+            }
+            LOG_DEBUG("    Sessions: %u/%u\n", (unsigned)sessions.active(), (unsigned)sessions.capacity());
+
+            // Keep advertising so further clients can connect in parallel
+            if (sessions.active() < sessions.capacity()) {
+                NimBLEDevice::getAdvertising()->start(0);
+            }
+        } else if (event.type == RX_MTU) {
+            endpoint.mtuChanged(event.connHandle, event.mtu, event.generation);
+        } else if (event.type == RX_DISCONNECT) {
+            EmulatorSession* session = sessions.find(event.connHandle);
+            if (session && session->generation == event.generation) txRelease(*session);
+            endpoint.disconnect(event.connHandle, event.generation);
+        } else if (event.type == RX_TRACE_COMMAND) {
+            handleTraceCommand((const char*)event.data);
+        } else if (event.type == RX_FAULT_PROFILE) {
+            // Applied here so the profile never changes mid-request
+            if (faults.configure((const char*)event.data)) {
+                LOG_INFO("[*] Fault profile %s: %s\n", faults.enabled() ? "on" : "off", (const char*)event.data);
+            } else {
+                LOG_ERROR("Error: bad fault profile: %s\n", (const char*)event.data);
+            }
+        } else if (event.type == RX_GUARD_PROFILE) {
+            if (peerGuard.configure((const char*)event.data)) {
+                LOG_INFO("[*] Peer guard %s: %s\n", peerGuard.enabled() ? "on" : "off", (const char*)event.data);
+            } else {
+                LOG_ERROR("Error: bad peer guard profile: %s\n", (const char*)event.data);
+            }
+        } else {
+            // A frame from an earlier connection on this handle goes nowhere
+            EmulatorSession* session = sessions.find(event.connHandle);
+            if (session && session->generation != event.generation) continue;
+            endpoint.write(event.connHandle, event.data, event.len, event.writeStart);
         }
-        Serial.printf("    SSID: %s\n", emulator.ssid.c_str());
-        emulator.ssidBuffer.clear();
-        emulator.ssidChunksReceived = 0;
-
-        // CRITICAL: Only send response for LAST chunk (matches real robot behavior)
-        return createResponse(INSTR_SET_SSID, {0x01});
-    } else {
-        // Intermediate chunk - do NOT send response (script doesn't wait for it)
-        return std::vector<uint8_t>(); // Empty = no response
     }
 }
 
-// Handle Instruction 5: Set Password
-std::vector<uint8_t> handleSetPassword(const std::vector<uint8_t>& packet) {
-    if (packet.size() < 5) {
-        Serial.println("    Error: packet too short");
-        return createResponse(INSTR_SET_PASSWORD, {0x00});
-    }
-
-    uint8_t chunkIndex = packet[3];
-    uint8_t totalChunks = packet[4];
-
-    // Extract chunk data
-    for (size_t i = 5; i < packet.size() - 1; i++) {
-        emulator.passwordBuffer.push_back(packet[i]);
-    }
-
-    emulator.passwordChunksReceived++;
-
-    if (emulator.passwordChunksReceived == 1) {
-        Serial.printf("    Password chunks: %d\n", totalChunks);
-    }
-
-    if (emulator.passwordChunksReceived >= totalChunks) {
-        // All chunks received - send response
-        emulator.password = "";
-        for (uint8_t byte : emulator.passwordBuffer) {
-            emulator.password += (char)byte;
-        }
-        Serial.printf("    Password: %s\n", emulator.password.c_str());
-
-        // Check for injection patterns
-        if (emulator.password.indexOf(";$(") >= 0 ||
-            emulator.password.indexOf("`;") >= 0 ||
-            emulator.password.indexOf("&&") >= 0 ||
-            emulator.password.indexOf("||") >= 0) {
-            Serial.println("    Warning: potential command injection detected");
-            Serial.printf("    Payload: %s\n", emulator.password.c_str());
-        }
-
-        emulator.passwordBuffer.clear();
-        emulator.passwordChunksReceived = 0;
-
-        // CRITICAL: Only send response for LAST chunk (matches real robot behavior)
-        return createResponse(INSTR_SET_PASSWORD, {0x01});
+// Restart advertising with previous configuration
+void restartAdvertising(void* context) {
+    if (NimBLEDevice::getAdvertising()->start(0)) {
+        LOG_DEBUG("    Advertising restarted\n");
     } else {
-        // Intermediate chunk - do NOT send response (script doesn't wait for it)
-        return std::vector<uint8_t>(); // Empty = no response
+        LOG_ERROR("    Error: failed to restart advertising\n");
     }
 }
 
-// Handle Instruction 6: Set Country Code (TRIGGER)
-std::vector<uint8_t> handleSetCountry(const std::vector<uint8_t>& packet) {
-    if (packet.size() < 5) {
-        Serial.println("    Error: packet too short");
-        return createResponse(INSTR_SET_COUNTRY, {0x00});
-    }
-
-    // Extract country code
-    emulator.country = "";
-    for (size_t i = 4; i < packet.size() - 1; i++) {
-        if (packet[i] != 0x00) {
-            emulator.country += (char)packet[i];
+// BLE Callbacks. Connects, MTU changes and disconnects go through the RX
+// queue like frames, so the worker sees every connection's events in order
+// and is the only task that touches the session pool and the peer guard.
+class ServerCallbacks: public NimBLEServerCallbacks {
+    void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) {
+        uint16_t connHandle = connInfo.getConnHandle();
+        LOG_INFO("\n[*] Client connected (conn %u)\n", connHandle);
+
+        NimBLEAddress address = connInfo.getIdAddress();
+        uint32_t generation = linkOpen(connHandle);
+        if (!generation || !queueLinkEvent(RX_CONNECT, connHandle, generation, connInfo.getMTU(),
+                                           peerKey(address.getVal(), address.getType()))) {
+            LOG_ERROR("    Error: worker backlogged, disconnecting\n");
+            linkClose(connHandle);
+            pServer->disconnect(connHandle);
         }
     }
 
-    Serial.printf("    Country: %s\n", emulator.country.c_str());
-    Serial.printf("    SSID: %s\n", emulator.ssid.c_str());
-    Serial.printf("    Password: %s\n", emulator.password.c_str());
-
-    // Simulate the vulnerable command execution
-    String simulatedCommand = "sudo sh /unitree/module/network_manager/upper_bluetooth/hostapd_restart.sh \""
-                            + emulator.ssid + " " + emulator.password + "\"";
-    Serial.printf("    Simulated command: %s\n", simulatedCommand.c_str());
-
-    // Parse what would actually execute if this were real
-    if (emulator.password.indexOf(";$(") >= 0) {
-        int start = emulator.password.indexOf(";$(") + 3;
-        int end = emulator.password.indexOf(");", start);
-        if (end > start) {
-            String injectedCmd = emulator.password.substring(start, end);
-            Serial.printf("    Injected command: %s\n", injectedCmd.c_str());
+    // Reply chunks follow the MTU negotiated on each connection
+    void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo) {
+        LOG_DEBUG("\n[*] MTU %u (conn %u)\n", MTU, connInfo.getConnHandle());
+        if (uint32_t generation = linkGeneration(connInfo.getConnHandle())) {
+            queueLinkEvent(RX_MTU, connInfo.getConnHandle(), generation, MTU);
         }
     }
 
-    return createResponse(INSTR_SET_COUNTRY, {0x01}); // Success
-}
-
-// Process received packet
-void processPacket(const std::vector<uint8_t>& decrypted) {
-    // Validate packet structure
-    if (decrypted.size() < 4) {
-        Serial.println("    Error: packet too short");
-        return;
-    }
-
-    uint8_t opcode = decrypted[0];
-    uint8_t length = decrypted[1];
-    uint8_t instruction = decrypted[2];
-
-    if (opcode != OPCODE_REQUEST) {
-        Serial.printf("    Error: invalid opcode 0x%02X\n", opcode);
-        return;
-    }
-
-    if (length != decrypted.size()) {
-        Serial.printf("    Warning: length mismatch (header=%d, actual=%d)\n", length, decrypted.size());
-    }
-
-    if (!validateChecksum(decrypted)) {
-        Serial.println("    Error: checksum validation failed");
-        return;
-    }
-
-    Serial.printf("    Instruction: 0x%02X\n", instruction);
-
-    // Process instruction
-    std::vector<uint8_t> response;
-
-    switch (instruction) {
-        case INSTR_HANDSHAKE:
-            response = handleHandshake(decrypted);
-            break;
-        case INSTR_GET_SERIAL:
-            response = handleGetSerial(decrypted);
-            break;
-        case INSTR_INIT_WIFI:
-            response = handleInitWiFi(decrypted);
-            break;
-        case INSTR_SET_SSID:
-            response = handleSetSSID(decrypted);
-            break;
-        case INSTR_SET_PASSWORD:
-            response = handleSetPassword(decrypted);
-            break;
-        case INSTR_SET_COUNTRY:
-            response = handleSetCountry(decrypted);
-            break;
-        default:
-            Serial.printf("    Error: unknown instruction 0x%02X\n", instruction);
-            return;
-    }
-
-    // Send response
-    if (pNotifyCharacteristic && response.size() > 0) {
-        pNotifyCharacteristic->setValue(response.data(), response.size());
-        pNotifyCharacteristic->notify();
-
-        Serial.println("    Response sent");
-
-        // Small delay to ensure notification is sent
-        delay(10);
-    } else {
-        if (!pNotifyCharacteristic) {
-            Serial.println("    Error: notify characteristic unavailable");
-        }
-        if (response.size() == 0) {
-            Serial.println("    Note: no response for this chunk");
+    void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) {
+        uint16_t connHandle = connInfo.getConnHandle();
+        LOG_INFO("\n[*] Client disconnected (conn %u, reason %d)\n", connHandle, reason);
+
+        // Release the session on the worker, after any frames still queued.
+        // Should the event not fit, the slot is reset when the handle is
+        // next connected (SessionPool::acquire).
+        uint32_t generation = linkGeneration(connHandle);
+        linkClose(connHandle);
+        if (generation && !queueLinkEvent(RX_DISCONNECT, connHandle, generation)) {
+            LOG_ERROR("    Error: disconnect of conn %u not queued\n", connHandle);
         }
-    }
-}
 
-// BLE Callbacks
-class ServerCallbacks: public NimBLEServerCallbacks {
-    void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) {
-        Serial.println("\n[*] Client connected");
+        // Let the disconnect settle; the host task does not wait for it
+        if (!emulatorClock().callAfter(ADVERTISE_RESTART_MS, restartAdvertising, nullptr)) {
+            restartAdvertising(nullptr);
+        }
     }
+};
 
-    void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) {
-        Serial.printf("\n[*] Client disconnected (reason %d)\n", reason);
-        emulator.reset();
-
-        // Small delay to ensure clean disconnect
-        delay(100);
-
-        // Restart advertising with previous configuration
-        NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
-        if (pAdvertising->start(0)) {
-            Serial.println("    Advertising restarted");
-        } else {
-            Serial.println("    Error: failed to restart advertising");
-        }
+// Notify characteristic: tx-complete drives the transmit queue
+class NotifyCallbacks: public NimBLECharacteristicCallbacks {
+public:
+    void onStatus(NimBLECharacteristic* pCharacteristic, int code) {
+        txComplete(code);
     }
 };
 
 // Characteristic Callbacks
 class CharacteristicCallbacks: public NimBLECharacteristicCallbacks {
 public:
+    // Copy the frame to the worker queue and return; never blocks
     void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) {
-        std::string value = pCharacteristic->getValue();
-        Serial.printf("\n[*] Write request (%d bytes)\n", value.length());
+        uint32_t writeStart = emulatorClock().micros();
+        NimBLEAttValue value = pCharacteristic->getValue();
+        rxStats.received++;
 
-        if (value.length() > 0) {
-            // Decrypt the data
-            auto decrypted = decryptData((const uint8_t*)value.data(), value.length());
+        // The length byte cannot describe anything longer
+        if (value.length() > FRAME_MAX_SIZE) {
+            rxStats.oversized++;
+            return;
+        }
 
-            // Process the packet
-            processPacket(decrypted);
-        } else {
-            Serial.println("    Note: empty payload");
+        RxEvent event;
+        event.type = RX_FRAME;
+        event.connHandle = connInfo.getConnHandle();
+        event.generation = linkGeneration(event.connHandle);
+        event.writeStart = writeStart;
+        event.len = value.length();
+        memcpy(event.data, value.data(), event.len);
+
+        // Frames never take the space kept for link events
+        if (uxQueueSpacesAvailable(rxQueue) <= RX_LINK_RESERVE || xQueueSend(rxQueue, &event, 0) != pdTRUE) {
+            rxStats.dropped++;
         }
+
+        uint32_t depth = uxQueueMessagesWaiting(rxQueue);
+        if (depth > rxStats.maxDepth) rxStats.maxDepth = depth;
+
+        uint32_t elapsed = emulatorClock().micros() - writeStart;
+        if (elapsed > rxStats.maxCallbackUs) rxStats.maxCallbackUs = elapsed;
     }
 
     void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) {
-        Serial.println("\n[*] Read callback (unexpected)");
+        LOG_DEBUG("\n[*] Read callback (unexpected)\n");
     }
 
-    void onStatus(NimBLECharacteristic* pCharacteristic, int code) {
-        Serial.printf("\n[*] Write status: %d\n", code);
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) {
+        LOG_DEBUG("\n[*] Subscribe change: %d\n", subValue);
     }
+};
 
-    void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) {
-        Serial.printf("\n[*] Subscribe change: %d\n", subValue);
+// Statistics characteristic: a fresh snapshot on every read
+class StatsCallbacks: public NimBLECharacteristicCallbacks {
+public:
+    void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) {
+        uint8_t snapshot[STATS_SNAPSHOT_SIZE];
+        pCharacteristic->setValue(snapshot, protocolStats.snapshot(snapshot));
     }
 };
 
+// Latest heap/stack/idle sample, from the telemetry task
+void publishTelemetry(const uint8_t* data, size_t len) {
+    pTelemetryCharacteristic->setValue(data, len);
+    pTelemetryCharacteristic->notify();
+}
+
 void setup() {
     Serial.begin(115200);
+    logBegin();
     delay(1000);
 
-    Serial.println("\n=== ESP32 Unitree Emulator ===");
-    Serial.println("Waiting for provisioning client...\n");
+    LOG_INFO("\n=== ESP32 Unitree Emulator ===\n");
+    LOG_INFO("Protocol profile: %s\n",
+             HARDENED_PROTOCOL ? "hardened (X25519, AES-CCM, challenge-response)" : "vulnerable (static AES key)");
+    LOG_INFO("Session pool: %u bytes for %u sessions\n",
+             (unsigned)(sizeof(EmulatorSession) * MAX_SESSIONS), (unsigned)MAX_SESSIONS);
+    LOG_INFO("Waiting for provisioning client...\n\n");
+
+    // The core's timestamps, delays and timeouts run on board time
+    boardClock.begin();
+    setEmulatorClock(boardClock);
 
     // Initialize crypto
     initCrypto();
-    Serial.println("AES-CFB128 ready");
+    LOG_DEBUG("AES-CFB128 ready\n");
+    if (peerGuard.enabled()) {
+        const GuardConfig& guard = peerGuard.config();
+        LOG_INFO("Peer guard: %u frames/s, burst %u, lockout after %u strikes\n",
+                 guard.ratePerSecond, guard.burst, guard.strikeLimit);
+    }
+
+    // Binary session trace to the flash partition
+    if (traceStoreBegin()) {
+        LOG_DEBUG("Session trace: %u KB circular log\n", (unsigned)(traceStoreCapacity() / 1024));
+    } else {
+        LOG_ERROR("Error: no trace partition, session trace off\n");
+    }
+
+    // Start the packet worker before any BLE callback can fire
+    rxQueue = xQueueCreate(RX_QUEUE_LENGTH + RX_LINK_RESERVE, sizeof(RxEvent));
+    xTaskCreatePinnedToCore(workerTask, "unitree_rx", WORKER_STACK_SIZE, nullptr,
+                            WORKER_PRIORITY, nullptr, WORKER_CORE);
+    LOG_DEBUG("Packet worker on core %d\n", WORKER_CORE);
 
     // Initialize BLE
     NimBLEDevice::init(DEVICE_NAME);
-    Serial.printf("BLE device name: %s\n", DEVICE_NAME);
+    LOG_DEBUG("BLE device name: %s\n", DEVICE_NAME);
 
     // Create BLE Server
     NimBLEServer* pServer = NimBLEDevice::createServer();
@@ -537,24 +416,48 @@ void setup() {
         CHARACTERISTIC_NOTIFY,
         NIMBLE_PROPERTY::NOTIFY
     );
-    Serial.printf("Notify characteristic: %s\n", CHARACTERISTIC_NOTIFY);
+    pNotifyCharacteristic->setCallbacks(new NotifyCallbacks());
+    LOG_DEBUG("Notify characteristic: %s\n", CHARACTERISTIC_NOTIFY);
+
+    // Replies go out through the transmit task, next to the worker
+    txBegin(pNotifyCharacteristic, TX_PRIORITY, WORKER_CORE);
 
     // Create Write Characteristic
     NimBLECharacteristic* pWriteCharacteristic = pService->createCharacteristic(
         CHARACTERISTIC_WRITE,
         NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR
     );
-    Serial.printf("Write characteristic: %s\n", CHARACTERISTIC_WRITE);
+    LOG_DEBUG("Write characteristic: %s\n", CHARACTERISTIC_WRITE);
 
     // Set callbacks for write characteristic
     CharacteristicCallbacks* pCallbacks = new CharacteristicCallbacks();
     pWriteCharacteristic->setCallbacks(pCallbacks);
 
-    Serial.println("Callbacks attached");
+    LOG_DEBUG("Callbacks attached\n");
 
     // Start the service
     pService->start();
-    Serial.println("BLE service started");
+    LOG_DEBUG("BLE service started\n");
+
+    // Counters and latency histogram, read on demand or notified every second
+    NimBLEService* pStatsService = pServer->createService(STATS_SERVICE_UUID);
+    pStatsCharacteristic = pStatsService->createCharacteristic(
+        STATS_CHARACTERISTIC_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY
+    );
+    pStatsCharacteristic->setCallbacks(new StatsCallbacks());
+
+    // Heap, stack and idle telemetry (layout in SystemTelemetry.h)
+    pTelemetryCharacteristic = pStatsService->createCharacteristic(
+        TELEMETRY_CHARACTERISTIC_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY,
+        TELEMETRY_MAX_SIZE
+    );
+    pStatsService->start();
+    LOG_DEBUG("Stats characteristic: %s\n", STATS_CHARACTERISTIC_UUID);
+
+    telemetryBegin(publishTelemetry);
+    LOG_DEBUG("Telemetry every %u ms: %s\n", TELEMETRY_INTERVAL_MS, TELEMETRY_CHARACTERISTIC_UUID);
 
     // Configure advertising
     NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
@@ -582,14 +485,109 @@ void setup() {
     bool success = pAdvertising->start(0);
 
     if (success) {
-        Serial.println("Advertising started");
-        Serial.println("Ready for BLE clients\n");
+        LOG_INFO("Advertising started\n");
+        LOG_INFO("Ready for BLE clients\n\n");
     } else {
-        Serial.println("Error: advertising failed");
+        LOG_ERROR("Error: advertising failed\n");
+    }
+}
+
+// Queue a console command for the worker
+void sendConsoleEvent(RxEventType type, const char* argument) {
+    RxEvent event;
+    event.type = type;
+    event.connHandle = SESSION_HANDLE_NONE;
+    event.len = strlen(argument) + 1;
+    memcpy(event.data, argument, event.len);
+    xQueueSend(rxQueue, &event, portMAX_DELAY);
+}
+
+// Console commands, one per line: "fault <profile>", "fault off",
+// "guard <profile>", "guard off", "trace on|off|flush"
+void pollConsole() {
+    static char line[FRAME_MAX_SIZE];
+    static size_t lineLen = 0;
+
+    while (Serial.available() > 0) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (lineLen < sizeof(line) - 1) line[lineLen++] = c;
+            continue;
+        }
+        if (lineLen == 0) continue;
+        line[lineLen] = '\0';
+        lineLen = 0;
+
+        // Hand commands to the worker, which owns the fault injector, the
+        // peer guard and the trace
+        if (strncmp(line, "fault", 5) == 0 && (line[5] == ' ' || line[5] == '\0')) {
+            sendConsoleEvent(RX_FAULT_PROFILE, line[5] ? line + 6 : "off");
+        } else if (strncmp(line, "guard", 5) == 0 && (line[5] == ' ' || line[5] == '\0')) {
+            sendConsoleEvent(RX_GUARD_PROFILE, line[5] ? line + 6 : "off");
+        } else if (strncmp(line, "trace ", 6) == 0) {
+            sendConsoleEvent(RX_TRACE_COMMAND, line + 6);
+        } else {
+            LOG_ERROR("Error: unknown command: %s\n", line);
+        }
     }
 }
 
 void loop() {
-    // Nothing to do here, BLE callbacks handle everything
-    delay(1000);
+    // BLE callbacks, the worker and the transmit task handle everything;
+    // report queue health and take console commands
+    static uint32_t lastReceived = 0;
+    static uint32_t lastReport = 0;
+    static uint32_t lastStatsNotify = 0;
+
+    // Push the counters to subscribers (NimBLE skips unsubscribed peers);
+    // clients whose MTU is too small for the whole snapshot get it
+    // truncated and should read the value instead
+    if (millis() - lastStatsNotify >= STATS_NOTIFY_MS) {
+        lastStatsNotify = millis();
+        uint8_t snapshot[STATS_SNAPSHOT_SIZE];
+        pStatsCharacteristic->setValue(snapshot, protocolStats.snapshot(snapshot));
+        pStatsCharacteristic->notify();
+    }
+
+    if (millis() - lastReport >= STATS_INTERVAL_MS && rxStats.received != lastReceived) {
+        lastReport = millis();
+        lastReceived = rxStats.received;
+        LOG_INFO("\n[*] RX queue: depth %u (max %u/%u), frames %u, dropped %u, oversized %u, worst onWrite %u us, "
+                 "link events dropped %u\n",
+                      (unsigned)uxQueueMessagesWaiting(rxQueue), (unsigned)rxStats.maxDepth,
+                      RX_QUEUE_LENGTH + RX_LINK_RESERVE, (unsigned)rxStats.received, (unsigned)rxStats.dropped,
+                      (unsigned)rxStats.oversized, (unsigned)rxStats.maxCallbackUs,
+                      (unsigned)rxStats.linkDropped);
+        LOG_INFO("[*] TX queue: depth %u (max %u), queued %u, rejected %u, sent %u, failed %u, retries %u, "
+                 "stale %u\n",
+                 (unsigned)txDepth(), (unsigned)txStats.maxDepth, (unsigned)txStats.queued,
+                 (unsigned)txStats.rejected, (unsigned)txStats.sent, (unsigned)txStats.failed, (unsigned)txStats.retries,
+                 (unsigned)txStats.stale);
+        uint32_t handshakes, handshakeTotalUs, handshakeMaxUs;
+        protocolStats.handshakeTimes(handshakes, handshakeTotalUs, handshakeMaxUs);
+        if (handshakes > 0) {
+            LOG_INFO("[*] Handshakes: %u, average %u us, worst %u us\n", (unsigned)handshakes,
+                     (unsigned)(handshakeTotalUs / handshakes), (unsigned)handshakeMaxUs);
+        }
+        if (sessionTrace.enabled()) {
+            LOG_INFO("[*] Trace: %u records, %u dropped, %u blocks written\n",
+                     (unsigned)sessionTrace.records(), (unsigned)sessionTrace.dropped(),
+                     (unsigned)sessionTrace.blocksWritten());
+        }
+        if (peerGuard.enabled()) {
+            const GuardStats& guarded = peerGuard.stats();
+            LOG_INFO("[*] Peer guard: %u peers, throttled %u, offenses %u, lockouts %u, refused %u, evicted %u\n",
+                     (unsigned)peerGuard.tracked(), (unsigned)guarded.throttled, (unsigned)guarded.offenses,
+                     (unsigned)guarded.disconnects, (unsigned)guarded.refused, (unsigned)guarded.evictions);
+        }
+        if (faults.enabled()) {
+            const FaultStats& injected = faults.stats();
+            LOG_INFO("[*] Faults: delayed %u, stalled %u, dropped %u, duplicated %u, reordered %u, corrupted %u\n",
+                     (unsigned)injected.delayed, (unsigned)injected.stalled, (unsigned)injected.dropped,
+                     (unsigned)injected.duplicated, (unsigned)injected.reordered, (unsigned)injected.corrupted);
+        }
+    }
+
+    pollConsole();
+    delay(50);
 }
@@ -14,46 +14,34 @@
 #include <BLEScan.h>
 #include <BLEAdvertisedDevice.h>
 #include <Preferences.h>
-#include "mbedtls/aes.h"
+#include <HardenedChannel.h>
+#include <UnitreeCodec.h>
+#include <UnitreeLog.h>
+#include <SystemTelemetry.h>
 #include <map>
 #include <vector>
 #include "nvs_flash.h"
 #include "nvs.h"
 
-// BLE Service and Characteristic UUIDs (from Unitree protocol)
-#define SERVICE_UUID           "0000ffe0-0000-1000-8000-00805f9b34fb"
-#define CHARACTERISTIC_NOTIFY  "0000ffe1-0000-1000-8000-00805f9b34fb"
-#define CHARACTERISTIC_WRITE   "0000ffe2-0000-1000-8000-00805f9b34fb"
+// Log level for this file (-DLOG_LEVEL_SCANNER=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_SCANNER
+#define LOG_LEVEL_SCANNER LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_SCANNER
 
 // Web Dashboard Service UUIDs
 #define DASHBOARD_SERVICE_UUID      "0000fff0-0000-1000-8000-00805f9b34fb"
 #define DEVICE_LIST_CHAR_UUID       "0000fff1-0000-1000-8000-00805f9b34fb"
 #define DEVICE_COUNT_CHAR_UUID      "0000fff2-0000-1000-8000-00805f9b34fb"
-
-// AES Encryption constants (hardcoded in Unitree firmware)
-const uint8_t AES_KEY[16] = {
-    0xdf, 0x98, 0xb7, 0x15, 0xd5, 0xc6, 0xed, 0x2b,
-    0x25, 0x81, 0x7b, 0x6f, 0x25, 0x54, 0x12, 0x4a
-};
-
-const uint8_t AES_IV[16] = {
-    0x28, 0x41, 0xae, 0x97, 0x41, 0x9c, 0x29, 0x73,
-    0x29, 0x6a, 0x0d, 0x4b, 0xdf, 0xe1, 0x9a, 0x4f
-};
-
-// Packet opcodes
-#define OPCODE_REQUEST   0x52
-#define OPCODE_RESPONSE  0x51
-
-// Instructions
-#define INSTR_HANDSHAKE      0x01
-#define INSTR_GET_SERIAL     0x02
+#define TELEMETRY_CHAR_UUID         "0000fff3-0000-1000-8000-00805f9b34fb"
 
 // Configuration
 #define HANDSHAKE_CONTENT "unitree"
 #define SCAN_DURATION_SECS 5
 #define CONNECTION_TIMEOUT 30000
 #define NOTIFICATION_TIMEOUT 10000
+#define HARDENED_CLIENT_MTU 247      // hello and sealed frames need more than 23
+#define HARDENED_REPLY_TIMEOUT 3000
 
 // NVS storage
 Preferences preferences;
@@ -64,8 +52,8 @@ struct DeviceData {
     String serialNumber;
 };
 
-// AES context
-mbedtls_aes_context aes_ctx;
+// Shared frame codec (AES-CFB128 + checksum)
+UnitreeCodec codec;
 
 // Scan state
 bool isConnecting = false;
@@ -74,6 +62,20 @@ BLEAddress* pServerAddress = nullptr;
 bool doConnect = false;
 BLEClient* pClient = nullptr;
 
+// Handshake reply arrival, for the per-device timing line
+volatile bool handshakeAcked = false;
+volatile uint32_t handshakeAckUs = 0;
+
+#if HARDENED_PROTOCOL
+// Per-connection key; the peer's hello is parked here by the notify
+// callback and processed on the scan task
+HardenedChannel channel;
+uint8_t peerHello[HARDENED_HELLO_SIZE];
+volatile bool peerHelloReceived = false;
+uint8_t handshakeReply[1 + HARDENED_PROOF_SIZE];
+volatile size_t handshakeReplyLen = 0;
+#endif
+
 // Serial number reassembly
 std::map<uint8_t, std::vector<uint8_t>> serialChunks;
 uint8_t serialTotalChunks = 0;
@@ -84,6 +86,7 @@ String serialNumber = "";
 BLEServer* pDashboardServer = nullptr;
 BLECharacteristic* pDeviceListChar = nullptr;
 BLECharacteristic* pDeviceCountChar = nullptr;
+BLECharacteristic* pTelemetryChar = nullptr;
 
 // Forward declarations
 bool connectAndFetchSerial(BLEAddress address, String deviceName);
@@ -93,67 +96,7 @@ uint8_t getDeviceCountFromNVS();
 
 // Initialize AES
 void initCrypto() {
-    mbedtls_aes_init(&aes_ctx);
-    mbedtls_aes_setkey_enc(&aes_ctx, AES_KEY, 128);
-}
-
-// Encrypt data
-std::vector<uint8_t> encryptData(const uint8_t* data, size_t len) {
-    std::vector<uint8_t> output(len);
-    uint8_t iv_copy[16];
-    memcpy(iv_copy, AES_IV, 16);
-    size_t iv_offset = 0;
-    mbedtls_aes_crypt_cfb128(&aes_ctx, MBEDTLS_AES_ENCRYPT, len,
-                             &iv_offset, iv_copy, data, output.data());
-    return output;
-}
-
-// Decrypt data
-std::vector<uint8_t> decryptData(const uint8_t* data, size_t len) {
-    std::vector<uint8_t> output(len);
-    uint8_t iv_copy[16];
-    memcpy(iv_copy, AES_IV, 16);
-    size_t iv_offset = 0;
-    mbedtls_aes_crypt_cfb128(&aes_ctx, MBEDTLS_AES_DECRYPT, len,
-                             &iv_offset, iv_copy, data, output.data());
-    return output;
-}
-
-// Calculate checksum
-uint8_t calculateChecksum(const std::vector<uint8_t>& data) {
-    uint32_t sum = 0;
-    for (uint8_t byte : data) {
-        sum += byte;
-    }
-    return (-sum) & 0xFF;
-}
-
-// Validate checksum
-bool validateChecksum(const std::vector<uint8_t>& packet) {
-    if (packet.size() < 4) return false;
-    uint32_t sum = 0;
-    for (uint8_t byte : packet) {
-        sum += byte;
-    }
-    return (sum & 0xFF) == 0;
-}
-
-// Create packet
-std::vector<uint8_t> createPacket(uint8_t instruction, const std::vector<uint8_t>& data_bytes) {
-    std::vector<uint8_t> instruction_data;
-    instruction_data.push_back(instruction);
-    instruction_data.insert(instruction_data.end(), data_bytes.begin(), data_bytes.end());
-
-    uint8_t length = instruction_data.size() + 3;
-    std::vector<uint8_t> full_data;
-    full_data.push_back(OPCODE_REQUEST);
-    full_data.push_back(length);
-    full_data.insert(full_data.end(), instruction_data.begin(), instruction_data.end());
-
-    uint8_t checksum = calculateChecksum(full_data);
-    full_data.push_back(checksum);
-
-    return encryptData(full_data.data(), full_data.size());
+    codec.begin();
 }
 
 // Sanitize MAC address for use as NVS key
@@ -180,7 +123,7 @@ void saveDeviceData(const DeviceData& data) {
     preferences.end();
     devicesScanned++;
 
-    Serial.println("    Saved to NVS");
+    LOG_INFO("    Saved to NVS\n");
 
     // Update BLE characteristics for web dashboard
     if (pDeviceListChar && pDeviceCountChar) {
@@ -267,25 +210,54 @@ uint8_t getDeviceCountFromNVS() {
     return count;
 }
 
+// Latest heap/stack/idle sample, from the telemetry task
+void publishTelemetry(const uint8_t* data, size_t len) {
+    pTelemetryChar->setValue((uint8_t*)data, len);
+    pTelemetryChar->notify();
+}
+
 // Notification callback
 static void notifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
-    auto decrypted = decryptData(pData, length);
+    uint8_t decrypted[FRAME_MAX_SIZE];
+    bool checksumOk = false;
+#if HARDENED_PROTOCOL
+    if (HardenedChannel::isHello(pData, length)) {
+        memcpy(peerHello, pData, length);
+        peerHelloReceived = true;
+        return;
+    }
+    size_t len = channel.open(pData, length, decrypted, sizeof(decrypted));
+    checksumOk = len > 0;
+#else
+    size_t len = codec.decodeFrame(pData, length, decrypted, sizeof(decrypted), &checksumOk);
+#endif
 
-    if (decrypted.size() < 5 || decrypted[0] != OPCODE_RESPONSE) {
+    if (len < 5 || decrypted[0] != OPCODE_RESPONSE) {
         return;
     }
 
-    if (!validateChecksum(decrypted)) {
+    if (!checksumOk) {
         return;
     }
 
     uint8_t instruction = decrypted[2];
 
+    if (instruction == INSTR_HANDSHAKE && !handshakeAcked) {
+        handshakeAckUs = micros();
+#if HARDENED_PROTOCOL
+        size_t replyLen = len - FRAME_OVERHEAD;
+        if (replyLen > sizeof(handshakeReply)) replyLen = sizeof(handshakeReply);
+        memcpy(handshakeReply, decrypted + FRAME_HEADER_SIZE, replyLen);
+        handshakeReplyLen = replyLen;
+#endif
+        handshakeAcked = true;
+    }
+
     if (instruction == INSTR_GET_SERIAL) {
         uint8_t chunkIndex = decrypted[3];
         uint8_t totalChunks = decrypted[4];
 
-        std::vector<uint8_t> chunkData(decrypted.begin() + 5, decrypted.end() - 1);
+        std::vector<uint8_t> chunkData(decrypted + 5, decrypted + len - 1);
         serialChunks[chunkIndex] = chunkData;
         serialTotalChunks = totalChunks;
 
@@ -305,15 +277,58 @@ static void notifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_
     }
 }
 
+#if HARDENED_PROTOCOL
+// Wait for flag to be set by the notify callback
+static bool waitFor(volatile bool& flag, uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (!flag && millis() - start < timeoutMs) {
+        delay(5);
+    }
+    return flag;
+}
+
+// Hello exchange, then prove the pairing secret and check the robot's proof
+static bool hardenedHandshake(BLERemoteCharacteristic* pWriteChar) {
+    if (pClient->getMTU() < HARDENED_MIN_MTU) {
+        LOG_ERROR("    MTU %u too small for the hardened profile\n", pClient->getMTU());
+        return false;
+    }
+
+    peerHelloReceived = false;
+    handshakeReplyLen = 0;
+    uint8_t frame[FRAME_MAX_SIZE];
+    if (!channel.begin(HardenedChannel::CLIENT)) {
+        LOG_ERROR("    Key generation failed\n");
+        return false;
+    }
+    pWriteChar->writeValue(frame, channel.encodeHello(frame, sizeof(frame)), true);
+    if (!waitFor(peerHelloReceived, HARDENED_REPLY_TIMEOUT) || !channel.acceptHello(peerHello, sizeof(peerHello))) {
+        LOG_ERROR("    No usable hello from the robot\n");
+        return false;
+    }
+
+    uint8_t proof[HARDENED_PROOF_SIZE];
+    channel.proof(HardenedChannel::CLIENT, proof);
+    pWriteChar->writeValue(frame, channel.seal(OPCODE_REQUEST, INSTR_HANDSHAKE, proof, sizeof(proof),
+                                               frame, sizeof(frame)), true);
+    if (!waitFor(handshakeAcked, HARDENED_REPLY_TIMEOUT) || handshakeReplyLen != sizeof(handshakeReply) ||
+        handshakeReply[0] != 0x01 || !channel.checkPeerProof(handshakeReply + 1, HARDENED_PROOF_SIZE)) {
+        LOG_ERROR("    Handshake rejected or robot proof invalid\n");
+        return false;
+    }
+    return true;
+}
+#endif
+
 // Connect and fetch serial
 bool connectAndFetchSerial(BLEAddress address, String deviceName) {
     String macAddress = address.toString().c_str();
 
-    Serial.printf("\n[*] %s (%s)\n", deviceName.c_str(), macAddress.c_str());
+    LOG_INFO("\n[*] %s (%s)\n", deviceName.c_str(), macAddress.c_str());
 
     // Check if already scanned
     if (isDeviceScanned(macAddress)) {
-        Serial.println("    Already scanned - skipping");
+        LOG_INFO("    Already scanned - skipping\n");
         return false;
     }
 
@@ -330,9 +345,12 @@ bool connectAndFetchSerial(BLEAddress address, String deviceName) {
 
     // Connect
     if (!pClient->connect(address)) {
-        Serial.println("    Connection failed");
+        LOG_ERROR("    Connection failed\n");
         return false;
     }
+#if HARDENED_PROTOCOL
+    pClient->setMTU(HARDENED_CLIENT_MTU);
+#endif
 
     // Get service and characteristics
     BLERemoteService* pService = pClient->getService(SERVICE_UUID);
@@ -355,20 +373,39 @@ bool connectAndFetchSerial(BLEAddress address, String deviceName) {
     }
 
     delay(100);
+    handshakeAcked = false;
+    uint32_t handshakeStart = micros();
 
-    // Send handshake
-    std::vector<uint8_t> handshakeData = {0x00, 0x00};
-    for (char c : String(HANDSHAKE_CONTENT)) {
-        handshakeData.push_back((uint8_t)c);
+#if HARDENED_PROTOCOL
+    if (!hardenedHandshake(pWriteChar)) {
+        pClient->disconnect();
+        channel.end();
+        return false;
     }
-    auto handshakePacket = createPacket(INSTR_HANDSHAKE, handshakeData);
-    pWriteChar->writeValue(handshakePacket.data(), handshakePacket.size(), true);
+
+    // Request serial number, sealed under the session key
+    uint8_t serialData[] = {0x00};
+    uint8_t serialPacket[FRAME_MAX_SIZE];
+    size_t serialLen = channel.seal(OPCODE_REQUEST, INSTR_GET_SERIAL, serialData, sizeof(serialData),
+                                    serialPacket, sizeof(serialPacket));
+#else
+    // Send handshake
+    uint8_t handshakeData[2 + sizeof(HANDSHAKE_CONTENT) - 1] = {0x00, 0x00};
+    memcpy(handshakeData + 2, HANDSHAKE_CONTENT, sizeof(HANDSHAKE_CONTENT) - 1);
+    uint8_t handshakePacket[FRAME_MAX_SIZE];
+    size_t handshakeLen = codec.encodeRequest(INSTR_HANDSHAKE, handshakeData, sizeof(handshakeData),
+                                              handshakePacket, sizeof(handshakePacket));
+    pWriteChar->writeValue(handshakePacket, handshakeLen, true);
     delay(1000);
 
     // Request serial number
-    std::vector<uint8_t> serialData = {0x00};
-    auto serialPacket = createPacket(INSTR_GET_SERIAL, serialData);
-    pWriteChar->writeValue(serialPacket.data(), serialPacket.size(), true);
+    uint8_t serialData[] = {0x00};
+    uint8_t serialPacket[FRAME_MAX_SIZE];
+    size_t serialLen = codec.encodeRequest(INSTR_GET_SERIAL, serialData, sizeof(serialData),
+                                           serialPacket, sizeof(serialPacket));
+#endif
+    uint32_t serialStart = micros();
+    pWriteChar->writeValue(serialPacket, serialLen, true);
 
     // Wait for serial chunks
     uint32_t waitStart = millis();
@@ -377,12 +414,19 @@ bool connectAndFetchSerial(BLEAddress address, String deviceName) {
     }
 
     if (!serialComplete) {
-        Serial.println("    Failed to receive serial");
+        LOG_ERROR("    Failed to receive serial\n");
         pClient->disconnect();
+#if HARDENED_PROTOCOL
+        channel.end();
+#endif
         return false;
     }
 
-    Serial.printf("    Serial: %s\n", serialNumber.c_str());
+    LOG_INFO("    Serial: %s\n", serialNumber.c_str());
+    if (handshakeAcked) {
+        LOG_INFO("    Timing (%s): handshake %u us, serial %u ms\n", HARDENED_PROTOCOL ? "hardened" : "vulnerable",
+                 (unsigned)(handshakeAckUs - handshakeStart), (unsigned)((micros() - serialStart) / 1000));
+    }
 
     // Save to NVS
     DeviceData deviceData;
@@ -392,6 +436,9 @@ bool connectAndFetchSerial(BLEAddress address, String deviceName) {
 
     // Disconnect
     pClient->disconnect();
+#if HARDENED_PROTOCOL
+    channel.end();
+#endif
     return true;
 }
 
@@ -420,10 +467,11 @@ class MyAdvertisedDeviceCallbacks: public BLEAdvertisedDeviceCallbacks {
 
 void setup() {
     Serial.begin(115200);
+    logBegin();
     delay(2000);
 
-    Serial.println("\n=== ESP32 Unitree Scanner ===");
-    Serial.println("Scanning for Unitree devices...\n");
+    LOG_INFO("\n=== ESP32 Unitree Scanner ===\n");
+    LOG_INFO("Scanning for Unitree devices...\n\n");
 
     // Initialize crypto
     initCrypto();
@@ -451,12 +499,18 @@ void setup() {
         BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
     );
 
+    // Create telemetry characteristic (read + notify, layout in SystemTelemetry.h)
+    pTelemetryChar = pDashboardService->createCharacteristic(
+        TELEMETRY_CHAR_UUID,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+    );
+
     // Initialize characteristics with loaded data from NVS
     String deviceList = getAllDevicesFromNVS();
     uint8_t deviceCount = getDeviceCountFromNVS();
     pDeviceListChar->setValue(deviceList.c_str());
     pDeviceCountChar->setValue(&deviceCount, 1);
-    Serial.printf("Initialized BLE characteristics with %d devices\n", deviceCount);
+    LOG_INFO("Initialized BLE characteristics with %d devices\n", deviceCount);
 
     // Start service
     pDashboardService->start();
@@ -467,7 +521,10 @@ void setup() {
     pAdvertising->setScanResponse(true);
     pAdvertising->start();
 
-    Serial.println("Web dashboard BLE server started");
+    LOG_INFO("Web dashboard BLE server started\n");
+
+    // Heap fragmentation and stack use over long scanning runs
+    telemetryBegin(publishTelemetry);
 
     // Start scanning for Unitree devices
     BLEScan* pBLEScan = BLEDevice::getScan();
@@ -0,0 +1,13 @@
+/**
+ * Global heap allocation counter for host builds
+ *
+ * Linking common/AllocCounter.cpp replaces operator new/delete so tools
+ * can prove the codec paths stay off the heap.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// Number of operator new calls since process start
+size_t allocationCount();
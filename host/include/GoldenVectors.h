@@ -0,0 +1,30 @@
+/**
+ * Golden Unitree frames
+ *
+ * Plaintext and ciphertext pairs produced independently with
+ * `openssl enc -aes-128-cfb` using the Unitree key and IV. The codec must
+ * reproduce them byte for byte.
+ */
+
+#pragma once
+
+struct GoldenVector {
+    const char* name;
+    const char* plaintext;   // full frame, checksum included
+    const char* ciphertext;
+};
+
+static const GoldenVector GOLDEN_VECTORS[] = {
+    {"handshake request",
+     "520d010000756e6974726565a4",
+     "6fed5f3a138185abaf89cdd5f1"},
+    {"handshake ack",
+     "51050101a8",
+     "6ce55f3bbb"},
+    {"serial response, single chunk",
+     "512402010145535033322d454d554c41544f522d76312e302d5445535444455649434555",
+     "6cc45c3b12b1b892e8c985f5188c0bc7c8b8b33e969f274a1110e19fe738417d5ad8a82a"},
+    {"password chunk with injection",
+     "522a050101706173733b2428746f756368202f746d702f70776e6564293b236162636465666768696ab1",
+     "6fca5b3b12848ab1a8c08c9821b632e5b6ce7b3f15e0465a992640256e7abad155358306390c973e2aa4"},
+};
@@ -0,0 +1,41 @@
+/**
+ * Hex helpers shared by the host tools
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Parse a hex string (spaces allowed) into out. Returns bytes written,
+// or -1 on a malformed string or overflow.
+inline int parseHex(const char* hex, uint8_t* out, size_t outCap) {
+    size_t n = 0;
+    int high = -1;
+    for (const char* p = hex; *p; p++) {
+        char c = *p;
+        int v;
+        if (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+        else if (c == ' ' || c == ':') continue;
+        else return -1;
+
+        if (high < 0) {
+            high = v;
+        } else {
+            if (n >= outCap) return -1;
+            out[n++] = (uint8_t)((high << 4) | v);
+            high = -1;
+        }
+    }
+    return high < 0 ? (int)n : -1;
+}
+
+inline void printHex(FILE* f, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        fprintf(f, "%02x", data[i]);
+    }
+    fputc('\n', f);
+}
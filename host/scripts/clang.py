@@ -0,0 +1,4 @@
+# libFuzzer ships with clang only; the native platform defaults to gcc
+Import("env")
+
+env.Replace(CC="clang", CXX="clang++", LINK="clang++")
@@ -0,0 +1,76 @@
+/**
+ * Single-pass fused framing vs. separate build, checksum and cipher passes
+ */
+
+#include <benchmark/benchmark.h>
+#include <UnitreeCodec.h>
+#include <string.h>
+
+static void sweepPayloads(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(2)->Range(1, 244);
+}
+
+// Three passes: copy into a frame, checksum it, then encrypt it
+static void BM_EncodeSeparatePasses(benchmark::State& state) {
+    size_t len = state.range(0);
+    UnitreeCodec codec;
+    codec.begin();
+
+    uint8_t payload[FRAME_MAX_SIZE] = {0};
+    uint8_t frame[FRAME_MAX_SIZE];
+    uint8_t out[FRAME_MAX_SIZE];
+    for (auto _ : state) {
+        size_t frameLen = len + FRAME_OVERHEAD;
+        frame[0] = OPCODE_RESPONSE;
+        frame[1] = (uint8_t)frameLen;
+        frame[2] = INSTR_GET_SERIAL;
+        memcpy(frame + FRAME_HEADER_SIZE, payload, len);
+        frame[frameLen - 1] = UnitreeCodec::checksum(frame, frameLen - 1);
+        codec.encrypt(frame, frameLen, out);
+        benchmark::DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_EncodeSeparatePasses)->Apply(sweepPayloads);
+
+static void BM_EncodeFused(benchmark::State& state) {
+    size_t len = state.range(0);
+    UnitreeCodec codec;
+    codec.begin();
+
+    uint8_t payload[FRAME_MAX_SIZE] = {0};
+    uint8_t out[FRAME_MAX_SIZE];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(codec.encodeResponse(INSTR_GET_SERIAL, payload, len, out, sizeof(out)));
+    }
+}
+BENCHMARK(BM_EncodeFused)->Apply(sweepPayloads);
+
+// Two passes: decrypt, then sum the plaintext
+static void BM_DecodeSeparatePasses(benchmark::State& state) {
+    size_t len = state.range(0) + FRAME_OVERHEAD;
+    UnitreeCodec codec;
+    codec.begin();
+
+    uint8_t in[FRAME_MAX_SIZE] = {0};
+    uint8_t out[FRAME_MAX_SIZE];
+    for (auto _ : state) {
+        codec.decrypt(in, len, out);
+        benchmark::DoNotOptimize(UnitreeCodec::validateChecksum(out, len));
+    }
+}
+BENCHMARK(BM_DecodeSeparatePasses)->Apply(sweepPayloads);
+
+static void BM_DecodeFused(benchmark::State& state) {
+    size_t len = state.range(0) + FRAME_OVERHEAD;
+    UnitreeCodec codec;
+    codec.begin();
+
+    uint8_t in[FRAME_MAX_SIZE] = {0};
+    uint8_t out[FRAME_MAX_SIZE];
+    for (auto _ : state) {
+        bool checksumOk = false;
+        codec.decodeFrame(in, len, out, sizeof(out), &checksumOk);
+        benchmark::DoNotOptimize(checksumOk);
+    }
+}
+BENCHMARK(BM_DecodeFused)->Apply(sweepPayloads);
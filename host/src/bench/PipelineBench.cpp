@@ -0,0 +1,228 @@
+/**
+ * Packet pipeline benchmarks
+ *
+ * Sweeps payload sizes from 1 to 244 bytes (the largest ATT payload at a
+ * 247-byte MTU) through each stage of the emulator pipeline. Time is per
+ * frame; allocs/frame counts operator new calls inside the timed loop.
+ */
+
+#include <benchmark/benchmark.h>
+#include <EmulatorCore.h>
+#include <string.h>
+#include "AllocCounter.h"
+
+#define BENCH_MAX_PAYLOAD 244
+
+static void sweepPayloads(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(2)->Range(1, BENCH_MAX_PAYLOAD);
+}
+
+static void reportAllocations(benchmark::State& state, size_t before) {
+    state.counters["allocs/frame"] = benchmark::Counter(
+        (double)(allocationCount() - before), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void fillPayload(uint8_t* payload, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        payload[i] = 'a' + (i % 26);
+    }
+}
+
+static void BM_Encrypt(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t in[FRAME_MAX_SIZE];
+    uint8_t out[FRAME_MAX_SIZE];
+    fillPayload(in, len);
+    codec.begin();
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        codec.encrypt(in, len, out);
+        benchmark::DoNotOptimize(out);
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_Encrypt)->Apply(sweepPayloads);
+
+static void BM_Decrypt(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t in[FRAME_MAX_SIZE];
+    uint8_t out[FRAME_MAX_SIZE];
+    fillPayload(in, len);
+    codec.begin();
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        codec.decodeFrame(in, len, out, sizeof(out));
+        benchmark::DoNotOptimize(out);
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_Decrypt)->Apply(sweepPayloads);
+
+static void BM_Checksum(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t in[FRAME_MAX_SIZE];
+    fillPayload(in, len);
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(UnitreeCodec::checksum(in, len));
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_Checksum)->Apply(sweepPayloads);
+
+static void BM_RequestFraming(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t payload[FRAME_MAX_SIZE];
+    uint8_t out[FRAME_MAX_SIZE];
+    fillPayload(payload, len);
+    codec.begin();
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(codec.encodeRequest(INSTR_SET_PASSWORD, payload, len, out, sizeof(out)));
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_RequestFraming)->Apply(sweepPayloads);
+
+static void BM_ResponseFraming(benchmark::State& state) {
+    size_t len = state.range(0);
+    uint8_t payload[FRAME_MAX_SIZE];
+    uint8_t out[FRAME_MAX_SIZE];
+    fillPayload(payload, len);
+    codec.begin();
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(codec.encodeResponse(INSTR_GET_SERIAL, payload, len, out, sizeof(out)));
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_ResponseFraming)->Apply(sweepPayloads);
+
+// Ciphertext in, encrypted reply out: decode + validate + handler + reply
+static void BM_ProcessPacket(benchmark::State& state) {
+    uint8_t instruction = (uint8_t)state.range(0);
+    size_t len = state.range(1);
+
+    uint8_t payload[FRAME_MAX_SIZE];
+    fillPayload(payload, len);
+    if (instructionInfo(instruction)->chunked) {
+        // Single chunk: [chunk_index, total_chunks, data...]
+        payload[0] = 0x01;
+        if (len > 1) payload[1] = 0x01;
+    }
+
+    initCrypto();
+    uint8_t request[FRAME_MAX_SIZE];
+    size_t requestLen = codec.encodeRequest(instruction, payload, len, request, sizeof(request));
+
+    EmulatorSession session;
+    session.authenticated = true;
+
+    uint8_t decrypted[FRAME_MAX_SIZE];
+    uint8_t scratch[REPLY_MAX_SIZE];
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        bool checksumOk = false;
+        size_t decryptedLen = codec.decodeFrame(request, requestLen, decrypted, sizeof(decrypted), &checksumOk);
+        benchmark::DoNotOptimize(processPacket(session, decrypted, decryptedLen, checksumOk, scratch));
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_ProcessPacket)
+    ->ArgNames({"instr", "payload"})
+    ->ArgsProduct({
+        {INSTR_HANDSHAKE, INSTR_GET_SERIAL, INSTR_INIT_WIFI,
+         INSTR_SET_SSID, INSTR_SET_PASSWORD, INSTR_SET_COUNTRY},
+        benchmark::CreateRange(1, BENCH_MAX_PAYLOAD, 2)});
+
+// Status reply rebuilt and re-encrypted per frame (CANNED_RESPONSES=0)
+static void BM_StatusReplyBuilt(benchmark::State& state) {
+    initCrypto();
+    uint8_t scratch[FRAME_MAX_SIZE];
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(createResponse(INSTR_INIT_WIFI, 0x01, scratch));
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_StatusReplyBuilt);
+
+static void BM_StatusReplyCanned(benchmark::State& state) {
+    initCrypto();
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(canned.status(INSTR_INIT_WIFI, 0x01));
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_StatusReplyCanned);
+
+static void BM_SerialReplyBuilt(benchmark::State& state) {
+    initCrypto();
+    uint8_t payload[CANNED_SERIAL_PAYLOAD];
+    uint8_t scratch[FRAME_MAX_SIZE];
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        CannedResponses::serialPayload(payload);
+        benchmark::DoNotOptimize(createResponse(INSTR_GET_SERIAL, payload, sizeof(payload), scratch));
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_SerialReplyBuilt);
+
+static void BM_SerialReplyCanned(benchmark::State& state) {
+    initCrypto();
+
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(canned.serial());
+    }
+    reportAllocations(state, before);
+}
+BENCHMARK(BM_SerialReplyCanned);
+
+// Get-serial request to encrypted reply chunks at a given ATT MTU
+static void BM_SerialReplyMtu(benchmark::State& state) {
+    initCrypto();
+    uint8_t request[FRAME_MAX_SIZE];
+    size_t requestLen = codec.encodeRequest(INSTR_GET_SERIAL, nullptr, 0, request, sizeof(request));
+
+    EmulatorSession session;
+    session.authenticated = true;
+    session.mtu = (uint16_t)state.range(0);
+
+    uint8_t decrypted[FRAME_MAX_SIZE];
+    uint8_t scratch[REPLY_MAX_SIZE];
+    size_t frames = 0;
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        bool checksumOk = false;
+        size_t decryptedLen = codec.decodeFrame(request, requestLen, decrypted, sizeof(decrypted), &checksumOk);
+        Response response = processPacket(session, decrypted, decryptedLen, checksumOk, scratch);
+        frames = response.frames();
+        benchmark::DoNotOptimize(response);
+    }
+    reportAllocations(state, before);
+    state.counters["chunks"] = (double)frames;
+}
+BENCHMARK(BM_SerialReplyMtu)->ArgName("mtu")->Arg(ATT_MTU_DEFAULT)->Arg(27)->Arg(33)->Arg(185)->Arg(247);
+
+// Statistics characteristic payload, built on every read and notify
+static void BM_StatsSnapshot(benchmark::State& state) {
+    uint8_t snapshot[STATS_SNAPSHOT_SIZE];
+    for (auto _ : state) {
+        size_t len = protocolStats.snapshot(snapshot);
+        benchmark::DoNotOptimize(len);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_StatsSnapshot);
@@ -0,0 +1,9 @@
+/**
+ * Native micro-benchmarks for the Unitree packet pipeline
+ *
+ *   pio run -e bench && .pio/build/bench/program
+ */
+
+#include <benchmark/benchmark.h>
+
+BENCHMARK_MAIN();
@@ -0,0 +1,285 @@
+#include "AttStream.h"
+#include <string.h>
+
+// HCI events
+#define EVT_DISCONNECTION_COMPLETE  0x05
+#define EVT_LE_META                 0x3E
+#define LE_CONNECTION_COMPLETE      0x01
+#define LE_ENHANCED_CONNECTION      0x0A
+#define LE_ENHANCED_CONNECTION_V2   0x29
+
+// ACL packet boundary flag for a continuation fragment
+#define ACL_CONTINUATION  0x01
+
+#define L2CAP_HEADER_SIZE  4
+#define L2CAP_CID_ATT      0x0004
+
+// ATT opcodes
+#define ATT_EXCHANGE_MTU_REQ     0x02
+#define ATT_EXCHANGE_MTU_RSP     0x03
+#define ATT_READ_BY_TYPE_RSP     0x09
+#define ATT_READ_BY_GROUP_RSP    0x11
+#define ATT_WRITE_REQ            0x12
+#define ATT_PREPARE_WRITE_REQ    0x16
+#define ATT_EXECUTE_WRITE_REQ    0x18
+#define ATT_NOTIFICATION         0x1B
+#define ATT_INDICATION           0x1D
+#define ATT_WRITE_CMD            0x52
+
+#define UUID_UNITREE_SERVICE  0xffe0
+#define UUID_UNITREE_NOTIFY   0xffe1
+#define UUID_UNITREE_WRITE    0xffe2
+
+// Bluetooth base UUID, little-endian, with the 16-bit UUID at bytes 12-13
+static const uint8_t BASE_UUID[16] = {
+    0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static uint16_t readLe16(const uint8_t* p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+// 16-bit form of a UUID as ATT sends it (2 or 16 bytes), -1 if it has none
+static int uuid16(const uint8_t* uuid, size_t len) {
+    if (len == 2) return readLe16(uuid);
+    if (len == 16 && memcmp(uuid, BASE_UUID, 12) == 0 && uuid[14] == 0 && uuid[15] == 0) {
+        return readLe16(uuid + 12);
+    }
+    return -1;
+}
+
+void AttStream::feed(const HciPacket& packet) {
+    counts.packets++;
+    if (packet.type == HCI_EVENT) {
+        event(packet);
+    } else if (packet.type == HCI_ACL) {
+        counts.aclPackets++;
+        acl(packet);
+    }
+}
+
+void AttStream::finish(uint64_t timestampUs) {
+    for (AttLink& link : links) {
+        if (link.inUse) close(link, timestampUs, ATT_LINK_LOST);
+    }
+}
+
+void AttStream::event(const HciPacket& packet) {
+    if (packet.len < 2 || packet.len - 2 < packet.data[1]) return;
+    const uint8_t* params = packet.data + 2;
+    size_t len = packet.data[1];
+
+    if (packet.data[0] == EVT_DISCONNECTION_COMPLETE && len >= 4 && params[0] == 0) {
+        if (AttLink* link = find(packet.adapter, readLe16(params + 1) & 0x0FFF)) {
+            close(*link, packet.timestampUs, params[3]);
+        }
+        return;
+    }
+
+    // The three LE connection events share their first fields: subevent,
+    // status, handle, role, peer address type, peer address
+    if (packet.data[0] != EVT_LE_META || len < 12) return;
+    uint8_t subevent = params[0];
+    if (subevent != LE_CONNECTION_COMPLETE && subevent != LE_ENHANCED_CONNECTION &&
+        subevent != LE_ENHANCED_CONNECTION_V2) {
+        return;
+    }
+    if (params[1] != 0) return;   // connection failed
+
+    uint16_t handle = readLe16(params + 2) & 0x0FFF;
+    if (AttLink* stale = find(packet.adapter, handle)) {
+        close(*stale, packet.timestampUs, ATT_LINK_LOST);   // missed its disconnect
+    }
+    AttLink& link = open(packet.adapter, handle, packet.timestampUs);
+    link.peerType = params[5];
+    memcpy(link.peer, params + 6, sizeof(link.peer));
+    link.peerKnown = true;
+    listener.onOpen(link);
+}
+
+void AttStream::acl(const HciPacket& packet) {
+    if (packet.len < 4) return;
+    uint16_t header = readLe16(packet.data);
+    uint16_t handle = header & 0x0FFF;
+    bool start = ((header >> 12) & 0x03) != ACL_CONTINUATION;
+    size_t len = readLe16(packet.data + 2);
+    if (len > packet.len - 4) len = packet.len - 4;   // snapped record
+
+    // Traffic on a connection opened before the capture started
+    AttLink* link = find(packet.adapter, handle);
+    if (!link) {
+        if (!start) {
+            counts.l2capDropped++;
+            return;
+        }
+        link = &open(packet.adapter, handle, packet.timestampUs);
+        listener.onOpen(*link);
+    }
+    link->lastUs = packet.timestampUs;
+
+    L2capBuffer& buffer = packet.received ? link->fromController : link->fromHost;
+    l2cap(*link, buffer, start, packet.timestampUs, packet.data + 4, len);
+}
+
+void AttStream::l2cap(AttLink& link, L2capBuffer& buffer, bool start, uint64_t timestampUs,
+                      const uint8_t* data, size_t len) {
+    if (start) {
+        if (buffer.state == L2CAP_FILLING) counts.l2capDropped++;   // previous PDU never completed
+        buffer.state = L2CAP_FILLING;
+        buffer.expected = 0;
+        buffer.have = 0;
+    } else if (buffer.state != L2CAP_FILLING) {
+        if (buffer.state == L2CAP_IDLE) counts.l2capDropped++;
+        return;
+    }
+
+    // Until the length is known the fragment may be as short as one byte
+    size_t room = (buffer.expected ? buffer.expected : L2CAP_HEADER_SIZE) - buffer.have;
+    size_t take = len < room ? len : room;
+    memcpy(buffer.data + buffer.have, data, take);
+    buffer.have += take;
+    data += take;
+    len -= take;
+
+    if (!buffer.expected) {
+        if (buffer.have < L2CAP_HEADER_SIZE) return;
+        buffer.expected = L2CAP_HEADER_SIZE + readLe16(buffer.data);
+        if (buffer.expected > L2CAP_MAX_PDU) {
+            counts.l2capDropped++;
+            buffer.state = L2CAP_SKIPPING;
+            return;
+        }
+        take = len < buffer.expected - buffer.have ? len : buffer.expected - buffer.have;
+        memcpy(buffer.data + buffer.have, data, take);
+        buffer.have += take;
+    }
+    if (buffer.have < buffer.expected) return;
+
+    buffer.state = L2CAP_IDLE;
+    if (readLe16(buffer.data + 2) == L2CAP_CID_ATT && buffer.expected > L2CAP_HEADER_SIZE) {
+        counts.attPdus++;
+        att(link, timestampUs, buffer.data + L2CAP_HEADER_SIZE, buffer.expected - L2CAP_HEADER_SIZE);
+    }
+}
+
+void AttStream::att(AttLink& link, uint64_t timestampUs, const uint8_t* pdu, size_t len) {
+    switch (pdu[0]) {
+        case ATT_EXCHANGE_MTU_REQ:
+        case ATT_EXCHANGE_MTU_RSP:
+            if (len >= 3) (pdu[0] == ATT_EXCHANGE_MTU_REQ ? link.clientMtu : link.serverMtu) = readLe16(pdu + 1);
+            break;
+
+        case ATT_READ_BY_TYPE_RSP:
+        case ATT_READ_BY_GROUP_RSP:
+            discovered(link, pdu[0], pdu, len);
+            break;
+
+        case ATT_WRITE_REQ:
+        case ATT_WRITE_CMD:
+            if (len >= 3) listener.onValue(link, timestampUs, ATT_VALUE_WRITE, readLe16(pdu + 1), pdu + 3, len - 3);
+            break;
+
+        case ATT_NOTIFICATION:
+        case ATT_INDICATION:
+            if (len >= 3) listener.onValue(link, timestampUs, ATT_VALUE_NOTIFY, readLe16(pdu + 1), pdu + 3, len - 3);
+            break;
+
+        case ATT_PREPARE_WRITE_REQ: {
+            if (len < 5) break;
+            uint16_t handle = readLe16(pdu + 1);
+            size_t offset = readLe16(pdu + 3);
+            if (handle != link.prepareHandle) {
+                // One attribute per queue; a new one restarts it
+                link.prepareHandle = handle;
+                link.prepareLen = 0;
+                link.prepareOverflow = false;
+            }
+            if (link.prepareOverflow || offset + (len - 5) > ATT_PREPARE_MAX) {
+                link.prepareOverflow = true;
+                break;
+            }
+            memcpy(link.prepare + offset, pdu + 5, len - 5);
+            if (offset + (len - 5) > link.prepareLen) link.prepareLen = offset + (len - 5);
+            break;
+        }
+
+        case ATT_EXECUTE_WRITE_REQ:
+            if (len >= 2 && pdu[1] == 0x01 && link.prepareHandle) {
+                if (link.prepareOverflow) {
+                    counts.prepareDropped++;
+                } else {
+                    listener.onValue(link, timestampUs, ATT_VALUE_WRITE, link.prepareHandle, link.prepare,
+                                     link.prepareLen);
+                }
+            }
+            link.prepareHandle = 0;
+            link.prepareLen = 0;
+            link.prepareOverflow = false;
+            break;
+    }
+}
+
+// Service discovery (Read By Group Type) gives the Unitree service's
+// handle range, characteristic discovery (Read By Type on 0x2803) the
+// value handles of its two characteristics
+void AttStream::discovered(AttLink& link, uint8_t opcode, const uint8_t* pdu, size_t len) {
+    if (len < 2 || pdu[1] == 0) return;
+    size_t entryLen = pdu[1];
+
+    for (size_t at = 2; at + entryLen <= len; at += entryLen) {
+        const uint8_t* entry = pdu + at;
+        if (opcode == ATT_READ_BY_GROUP_RSP) {
+            if (entryLen < 6 || uuid16(entry + 4, entryLen - 4) != UUID_UNITREE_SERVICE) continue;
+            link.serviceStart = readLe16(entry);
+            link.serviceEnd = readLe16(entry + 2);
+        } else {
+            // Declaration: handle, then properties, value handle, UUID
+            if (entryLen != 2 + 5 && entryLen != 2 + 19) continue;
+            uint16_t declaration = readLe16(entry);
+            if (link.serviceEnd && (declaration < link.serviceStart || declaration > link.serviceEnd)) continue;
+            int uuid = uuid16(entry + 5, entryLen - 5);
+            if (uuid == UUID_UNITREE_WRITE) link.writeHandle = readLe16(entry + 3);
+            if (uuid == UUID_UNITREE_NOTIFY) link.notifyHandle = readLe16(entry + 3);
+        }
+    }
+}
+
+AttLink* AttStream::find(uint16_t adapter, uint16_t handle) {
+    for (AttLink& link : links) {
+        if (link.inUse && link.handle == handle && link.adapter == adapter) return &link;
+    }
+    return nullptr;
+}
+
+AttLink& AttStream::open(uint16_t adapter, uint16_t handle, uint64_t timestampUs) {
+    AttLink* slot = nullptr;
+    for (AttLink& link : links) {
+        if (!link.inUse) {
+            slot = &link;
+            break;
+        }
+    }
+    if (!slot) {
+        // Table full: close the link that has been quiet longest
+        slot = links;
+        for (AttLink& link : links) {
+            if (link.lastUs < slot->lastUs) slot = &link;
+        }
+        counts.linksEvicted++;
+        close(*slot, timestampUs, ATT_LINK_LOST);
+    }
+
+    *slot = AttLink();
+    slot->inUse = true;
+    slot->adapter = adapter;
+    slot->handle = handle;
+    slot->openedUs = slot->lastUs = timestampUs;
+    if (++active > counts.peakLinks) counts.peakLinks = active;
+    return *slot;
+}
+
+void AttStream::close(AttLink& link, uint64_t timestampUs, uint8_t reason) {
+    listener.onClose(link, timestampUs, reason);
+    link.inUse = false;
+    active--;
+}
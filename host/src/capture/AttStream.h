@@ -0,0 +1,122 @@
+/**
+ * HCI to ATT, for offline captures
+ *
+ * Follows LE connections through HCI events, reassembles L2CAP PDUs from
+ * ACL fragments on the ATT channel and hands the listener every attribute
+ * write (request, command, or an executed prepared write) and every
+ * notification/indication. GATT discovery responses are watched for the
+ * Unitree service (0xffe0) and its characteristics, so the listener knows
+ * which attribute handles carry frames; captures that start after
+ * discovery leave them 0 for the listener to settle.
+ *
+ * State is fixed-size: at most ATT_MAX_LINKS connections (the quietest
+ * one is closed to make room), one L2CAP buffer per direction each, so
+ * memory does not grow with the capture.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Btsnoop.h"
+
+#define ATT_MAX_LINKS        64
+#define L2CAP_MAX_PDU        (4 + 517)   // header plus the largest ATT MTU
+#define ATT_PREPARE_MAX      512         // queued prepared-write bytes per link
+#define ATT_LINK_LOST        0xFF        // close reason without a disconnect event
+
+enum AttValueKind : uint8_t {
+    ATT_VALUE_WRITE,    // client to server
+    ATT_VALUE_NOTIFY    // server to client
+};
+
+enum L2capState : uint8_t {
+    L2CAP_IDLE,
+    L2CAP_FILLING,
+    L2CAP_SKIPPING    // oversized PDU, its continuations are ignored
+};
+
+struct L2capBuffer {
+    uint8_t data[L2CAP_MAX_PDU];
+    L2capState state = L2CAP_IDLE;
+    size_t expected = 0;   // whole PDU, header included; 0 until the header is in
+    size_t have = 0;
+};
+
+struct AttLink {
+    bool inUse = false;
+    uint16_t adapter = 0;
+    uint16_t handle = 0;          // HCI connection handle
+    uint8_t peer[6] = {};         // as HCI reports it, least significant byte first
+    uint8_t peerType = 0;
+    bool peerKnown = false;       // connection event seen
+    uint64_t openedUs = 0;
+    uint64_t lastUs = 0;
+    uint16_t clientMtu = 0;
+    uint16_t serverMtu = 0;
+    uint16_t serviceStart = 0;    // Unitree service range from discovery
+    uint16_t serviceEnd = 0;
+    uint16_t writeHandle = 0;     // 0xffe2 value handle
+    uint16_t notifyHandle = 0;    // 0xffe1 value handle
+    L2capBuffer fromHost;
+    L2capBuffer fromController;
+    uint16_t prepareHandle = 0;
+    size_t prepareLen = 0;
+    bool prepareOverflow = false;
+    uint8_t prepare[ATT_PREPARE_MAX];
+
+    uint16_t mtu() const {
+        return clientMtu && serverMtu ? (clientMtu < serverMtu ? clientMtu : serverMtu) : 23;
+    }
+};
+
+class AttListener {
+public:
+    virtual ~AttListener() {}
+    virtual void onOpen(AttLink& link) {}
+    virtual void onClose(AttLink& link, uint64_t timestampUs, uint8_t reason) {}
+    virtual void onValue(AttLink& link, uint64_t timestampUs, AttValueKind kind, uint16_t attHandle,
+                         const uint8_t* value, size_t len) {}
+};
+
+struct AttStreamStats {
+    uint64_t packets = 0;
+    uint64_t aclPackets = 0;
+    uint64_t attPdus = 0;
+    uint64_t l2capDropped = 0;   // oversized PDUs and fragments without a start
+    uint64_t prepareDropped = 0; // prepared writes past ATT_PREPARE_MAX
+    uint64_t linksEvicted = 0;
+    size_t peakLinks = 0;
+};
+
+class AttStream {
+public:
+    explicit AttStream(AttListener& listener) : listener(listener) {}
+
+    void feed(const HciPacket& packet);
+
+    // Close every open link, as at the end of the capture
+    void finish(uint64_t timestampUs);
+
+    const AttStreamStats& stats() const { return counts; }
+
+    // Stable slot of a link, for per-link side tables
+    size_t indexOf(const AttLink& link) const { return &link - links; }
+
+private:
+    void event(const HciPacket& packet);
+    void acl(const HciPacket& packet);
+    void l2cap(AttLink& link, L2capBuffer& buffer, bool start, uint64_t timestampUs,
+               const uint8_t* data, size_t len);
+    void att(AttLink& link, uint64_t timestampUs, const uint8_t* pdu, size_t len);
+    void discovered(AttLink& link, uint8_t opcode, const uint8_t* pdu, size_t len);
+
+    AttLink* find(uint16_t adapter, uint16_t handle);
+    AttLink& open(uint16_t adapter, uint16_t handle, uint64_t timestampUs);
+    void close(AttLink& link, uint64_t timestampUs, uint8_t reason);
+
+    AttListener& listener;
+    AttLink links[ATT_MAX_LINKS];
+    size_t active = 0;
+    AttStreamStats counts;
+};
@@ -0,0 +1,191 @@
+#include "Btsnoop.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint8_t MAGIC[8] = {'b', 't', 's', 'n', 'o', 'o', 'p', 0};
+
+// Monitor (btmon) record opcodes, low 16 bits of the flags
+#define MONITOR_COMMAND  2
+#define MONITOR_EVENT    3
+#define MONITOR_ACL_TX   4
+#define MONITOR_ACL_RX   5
+#define MONITOR_SCO_TX   6
+#define MONITOR_SCO_RX   7
+
+static uint32_t readBe32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint64_t readBe64(const uint8_t* p) {
+    return (uint64_t)readBe32(p) << 32 | readBe32(p + 4);
+}
+
+static void putBe32(uint8_t* p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void putBe64(uint8_t* p, uint64_t v) {
+    putBe32(p, (uint32_t)(v >> 32));
+    putBe32(p + 4, (uint32_t)v);
+}
+
+bool BtsnoopReader::open(const char* path, std::string& error) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        error = std::string(path) + ": " + strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    fileSize = st.st_size;
+    if (fileSize < BTSNOOP_HEADER_SIZE) {
+        ::close(fd);
+        error = std::string(path) + ": too short for a btsnoop header";
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = std::string(path) + ": mmap: " + strerror(errno);
+        return false;
+    }
+    base = (const uint8_t*)mapped;
+    madvise(mapped, fileSize, MADV_SEQUENTIAL);
+
+    link = readBe32(base + 12);
+    if (memcmp(base, MAGIC, sizeof(MAGIC)) != 0 || readBe32(base + 8) != 1) {
+        error = std::string(path) + ": not a btsnoop v1 file";
+        close();
+        return false;
+    }
+    if (link != BTSNOOP_DATALINK_H1 && link != BTSNOOP_DATALINK_H4 && link != BTSNOOP_DATALINK_MONITOR) {
+        error = std::string(path) + ": unsupported datalink " + std::to_string(link);
+        close();
+        return false;
+    }
+    cursor = BTSNOOP_HEADER_SIZE;
+    return true;
+}
+
+void BtsnoopReader::close() {
+    if (base) munmap((void*)base, fileSize);
+    base = nullptr;
+    fileSize = cursor = released = recordCount = 0;
+    link = 0;
+    cut = false;
+}
+
+bool BtsnoopReader::next(HciPacket& packet) {
+    for (;;) {
+        // Drop the pages already read; MAP_PRIVATE read-only pages are
+        // clean, so this only shrinks the resident set
+        if (cursor - released >= 2 * BTSNOOP_RELEASE_BYTES) {
+            uint64_t upTo = (cursor - BTSNOOP_RELEASE_BYTES) & ~(uint64_t)(sysconf(_SC_PAGESIZE) - 1);
+            madvise((void*)(base + released), upTo - released, MADV_DONTNEED);
+            released = upTo;
+        }
+
+        if (cursor + BTSNOOP_RECORD_SIZE > fileSize) {
+            cut = cursor != fileSize;
+            return false;
+        }
+        const uint8_t* header = base + cursor;
+        uint32_t included = readBe32(header + 4);
+        uint32_t flags = readBe32(header + 8);
+        int64_t timestamp = (int64_t)readBe64(header + 16);
+        if (included > fileSize - cursor - BTSNOOP_RECORD_SIZE) {
+            cut = true;
+            return false;
+        }
+        const uint8_t* data = header + BTSNOOP_RECORD_SIZE;
+        cursor += BTSNOOP_RECORD_SIZE + included;
+        recordCount++;
+
+        packet.timestampUs = (uint64_t)timestamp - BTSNOOP_EPOCH_OFFSET_US;
+        packet.adapter = 0;
+        packet.data = data;
+        packet.len = included;
+
+        if (link == BTSNOOP_DATALINK_H4) {
+            if (included == 0) continue;
+            packet.type = data[0] >= HCI_COMMAND && data[0] <= HCI_EVENT ? (HciPacketType)data[0] : HCI_OTHER;
+            packet.received = flags & 1;
+            packet.data = data + 1;
+            packet.len = included - 1;
+        } else if (link == BTSNOOP_DATALINK_H1) {
+            packet.received = flags & 1;
+            packet.type = (flags & 2) ? (packet.received ? HCI_EVENT : HCI_COMMAND) : HCI_ACL;
+        } else {
+            packet.adapter = flags >> 16;
+            switch (flags & 0xFFFF) {
+                case MONITOR_COMMAND: packet.type = HCI_COMMAND; packet.received = false; break;
+                case MONITOR_EVENT:   packet.type = HCI_EVENT;   packet.received = true;  break;
+                case MONITOR_ACL_TX:  packet.type = HCI_ACL;     packet.received = false; break;
+                case MONITOR_ACL_RX:  packet.type = HCI_ACL;     packet.received = true;  break;
+                case MONITOR_SCO_TX:  packet.type = HCI_SCO;     packet.received = false; break;
+                case MONITOR_SCO_RX:  packet.type = HCI_SCO;     packet.received = true;  break;
+                default:              packet.type = HCI_OTHER;   packet.received = false; break;
+            }
+        }
+        return true;
+    }
+}
+
+bool BtsnoopWriter::open(const char* path, uint32_t datalink) {
+    close();
+    file = fopen(path, "wb");
+    if (!file) return false;
+    link = datalink;
+
+    uint8_t header[BTSNOOP_HEADER_SIZE];
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    putBe32(header + 8, 1);
+    putBe32(header + 12, datalink);
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool BtsnoopWriter::close() {
+    if (!file) return true;
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+void BtsnoopWriter::write(uint64_t timestampUs, HciPacketType type, bool received, const uint8_t* data,
+                          size_t len, uint16_t adapter) {
+    uint8_t typeByte = (uint8_t)type;
+    uint32_t flags;
+    size_t included = len;
+    if (link == BTSNOOP_DATALINK_H4) {
+        flags = (received ? 1 : 0) | (type == HCI_COMMAND || type == HCI_EVENT ? 2 : 0);
+        included++;
+    } else if (link == BTSNOOP_DATALINK_H1) {
+        flags = (received ? 1 : 0) | (type == HCI_COMMAND || type == HCI_EVENT ? 2 : 0);
+    } else {
+        uint32_t opcode = type == HCI_COMMAND ? MONITOR_COMMAND
+                        : type == HCI_EVENT   ? MONITOR_EVENT
+                        : type == HCI_ACL     ? (received ? MONITOR_ACL_RX : MONITOR_ACL_TX)
+                                              : (received ? MONITOR_SCO_RX : MONITOR_SCO_TX);
+        flags = (uint32_t)adapter << 16 | opcode;
+    }
+
+    uint8_t header[BTSNOOP_RECORD_SIZE];
+    putBe32(header, included);
+    putBe32(header + 4, included);
+    putBe32(header + 8, flags);
+    putBe32(header + 12, 0);
+    putBe64(header + 16, timestampUs + BTSNOOP_EPOCH_OFFSET_US);
+    fwrite(header, 1, sizeof(header), file);
+    if (link == BTSNOOP_DATALINK_H4) fwrite(&typeByte, 1, 1, file);
+    fwrite(data, 1, len, file);
+}
@@ -0,0 +1,98 @@
+/**
+ * btsnoop capture files
+ *
+ * The format Android writes for its HCI snoop log (datalink 1002, H4
+ * packets with a type byte) and BlueZ's btmon writes with -w (datalink
+ * 2001, monitor opcodes per record); datalink 1001 (H1, no type byte) is
+ * read too. Everything is big-endian:
+ *
+ *   header  "btsnoop\0", u32 version (1), u32 datalink
+ *   record  u32 original length, u32 included length, u32 flags,
+ *           u32 cumulative drops, i64 timestamp (us since year 0), data
+ *
+ * BtsnoopReader maps the file and walks it front to back. Pages behind
+ * the cursor are handed back to the kernel as it goes, so a capture of
+ * any size is read with at most 2 * BTSNOOP_RELEASE_BYTES of it resident.
+ * BtsnoopWriter produces the same format for the selftest and samples.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#define BTSNOOP_HEADER_SIZE  16
+#define BTSNOOP_RECORD_SIZE  24   // record header, data follows
+
+#define BTSNOOP_DATALINK_H1       1001
+#define BTSNOOP_DATALINK_H4       1002
+#define BTSNOOP_DATALINK_MONITOR  2001
+
+// Mapped bytes the reader keeps behind its cursor before releasing them
+#define BTSNOOP_RELEASE_BYTES (32u << 20)
+
+// btsnoop timestamps count from 0000-01-01; this is 1970-01-01
+#define BTSNOOP_EPOCH_OFFSET_US 0x00dcddb30f2f8000ULL
+
+enum HciPacketType : uint8_t {
+    HCI_COMMAND = 1,
+    HCI_ACL     = 2,
+    HCI_SCO     = 3,
+    HCI_EVENT   = 4,
+    HCI_OTHER   = 0xFF   // monitor notes, index changes, vendor records
+};
+
+struct HciPacket {
+    uint64_t timestampUs;   // Unix time
+    uint16_t adapter;       // controller index (monitor captures), else 0
+    HciPacketType type;
+    bool received;          // controller to host
+    const uint8_t* data;    // after the H4 type byte, valid until the next call
+    size_t len;
+};
+
+class BtsnoopReader {
+public:
+    ~BtsnoopReader() { close(); }
+
+    // Map path and check the header; false with error set on failure
+    bool open(const char* path, std::string& error);
+    void close();
+
+    uint32_t datalink() const { return link; }
+    uint64_t size() const { return fileSize; }
+    uint64_t offset() const { return cursor; }
+    uint64_t records() const { return recordCount; }
+
+    // Next HCI packet. False at the end of the file, or at a record that
+    // runs past it (truncated() then says so).
+    bool next(HciPacket& packet);
+    bool truncated() const { return cut; }
+
+private:
+    const uint8_t* base = nullptr;
+    uint64_t fileSize = 0;
+    uint64_t cursor = 0;
+    uint64_t released = 0;
+    uint64_t recordCount = 0;
+    uint32_t link = 0;
+    bool cut = false;
+};
+
+class BtsnoopWriter {
+public:
+    ~BtsnoopWriter() { close(); }
+
+    bool open(const char* path, uint32_t datalink);
+    bool close();
+
+    // One HCI packet in the file's datalink framing
+    void write(uint64_t timestampUs, HciPacketType type, bool received, const uint8_t* data, size_t len,
+               uint16_t adapter = 0);
+
+private:
+    FILE* file = nullptr;
+    uint32_t link = 0;
+};
@@ -0,0 +1,946 @@
+/**
+ * unitree-capture — decode Unitree provisioning sessions from BLE captures
+ *
+ *   unitree-capture analyze <capture> [--json] [--quiet]
+ *   unitree-capture sample <capture> [--sessions n] [--datalink h4|monitor]
+ *   unitree-capture selftest
+ *
+ * analyze reads a btsnoop file (an Android HCI snoop log, or btmon -w
+ * output) front to back through a mapping it releases as it goes, follows
+ * every LE connection down to ATT, picks out the writes and notifications
+ * of the Unitree service (0xffe0; by GATT discovery when the capture has
+ * it, otherwise by the first value that decodes as a valid frame) and
+ * decrypts them with the shared codec. Each session is printed as it
+ * happens: requests and replies with their time since the connection and
+ * the reply latency, reassembled serial/SSID/password/country fields, and
+ * the injection rules any field trips. A summary of the whole capture
+ * (throughput and peak RSS included) follows. --json prints one JSON
+ * object per line instead; --quiet only the summary.
+ *
+ * Memory does not depend on the capture size: links, L2CAP buffers and
+ * field assemblers are fixed tables, and the mapping is read once.
+ *
+ * sample writes a synthetic capture of n sessions (scripted clients
+ * against the emulator core, with discovery, MTU exchanges, fragmented
+ * ACL, prepared writes and unrelated traffic mixed in), for trying the
+ * analyzer on multi-GB files. selftest analyzes small samples in both
+ * datalinks and checks every field comes back.
+ */
+
+#include <EmulatorEndpoint.h>
+#include <HardenedChannel.h>
+#include <InjectionDetector.h>
+#include <chrono>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "AttStream.h"
+#include "Btsnoop.h"
+
+static int usage() {
+    fprintf(stderr,
+            "usage: unitree-capture analyze <capture> [--json] [--quiet]\n"
+            "       unitree-capture sample <capture> [--sessions n] [--datalink h4|monitor]\n"
+            "       unitree-capture selftest\n");
+    return 2;
+}
+
+static void discardLog(const char* text, size_t len) {}
+
+static const char* INSTRUCTION_NAMES[INSTR_MAX + 1] = {
+    nullptr, "handshake", "get serial", "init wifi", "ssid", "password", "country"
+};
+
+static const char* PEER_TYPES[] = {"public", "random", "public identity", "random identity"};
+
+// --- formatting ---
+
+// Field text in quotes: printable ASCII as is, everything else escaped
+// (\xNN, or \u00NN for JSON, bytes taken as Latin-1)
+static std::string quoted(const uint8_t* data, size_t len, bool json) {
+    std::string out = "\"";
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c >= 0x20 && c < 0x7f) {
+            out += (char)c;
+        } else {
+            char escape[8];
+            snprintf(escape, sizeof(escape), json ? "\\u%04x" : "\\x%02x", c);
+            out += escape;
+        }
+    }
+    return out + "\"";
+}
+
+static std::string quoted(const std::string& text, bool json) {
+    return quoted((const uint8_t*)text.data(), text.size(), json);
+}
+
+static std::string hex(const uint8_t* data, size_t len) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < len; i++) {
+        out += DIGITS[data[i] >> 4];
+        out += DIGITS[data[i] & 0x0F];
+    }
+    return out;
+}
+
+static std::string utcTime(uint64_t timestampUs) {
+    time_t seconds = (time_t)(timestampUs / 1000000);
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    char text[48];
+    size_t len = strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(text + len, sizeof(text) - len, ".%06u UTC", (unsigned)(timestampUs % 1000000));
+    return text;
+}
+
+// HCI gives addresses least significant byte first
+static std::string peerAddress(const AttLink& link) {
+    char text[18];
+    snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x", link.peer[5], link.peer[4], link.peer[3],
+             link.peer[2], link.peer[1], link.peer[0]);
+    return text;
+}
+
+static std::string injectionRules(uint32_t hits, bool json) {
+    std::string out;
+    for (size_t rule = 0; rule < INJECTION_RULE_COUNT; rule++) {
+        if (!(hits & (1UL << rule))) continue;
+        if (!out.empty()) out += json ? "," : ", ";
+        out += json ? quoted(std::string(INJECTION_RULES[rule].name), true) : INJECTION_RULES[rule].name;
+    }
+    return out;
+}
+
+// --- analysis ---
+
+enum HandshakeState : uint8_t {
+    HANDSHAKE_NONE,
+    HANDSHAKE_SENT,
+    HANDSHAKE_ACCEPTED,
+    HANDSHAKE_REJECTED
+};
+
+static const char* HANDSHAKE_NAMES[] = {"not seen", "unanswered", "accepted", "rejected"};
+
+// What one connection carried, rebuilt from its frames
+struct CaptureSession {
+    bool unitree = false;         // a Unitree frame was seen
+    bool hardened = false;        // hardened-profile frames, not decodable offline
+    uint64_t requestUs = 0;       // latest request, for reply latency
+    size_t requests = 0;
+    size_t replies = 0;
+    size_t badFrames = 0;
+    uint8_t handshake = HANDSHAKE_NONE;
+    ChunkAssembler ssidChunks;
+    ChunkAssembler passwordChunks;
+    ChunkAssembler serialChunks;
+    std::string auth, ssid, password, country, serial;
+    size_t flagged = 0;           // fields that tripped an injection rule
+};
+
+struct CaptureTotals {
+    uint64_t sessions = 0;
+    uint64_t frames = 0;
+    uint64_t requests = 0;
+    uint64_t replies = 0;
+    uint64_t badFrames = 0;
+    uint64_t hardenedFrames = 0;
+    uint64_t flaggedSessions = 0;
+};
+
+// Decode the frame at the start of data; a value may hold several back to
+// back, the first one's length byte says where it ends
+static size_t decodeNext(const uint8_t* data, size_t len, uint8_t* plain, bool* checksumOk) {
+    size_t n = codec.decodeFrame(data, len < FRAME_MAX_SIZE ? len : FRAME_MAX_SIZE, plain, FRAME_MAX_SIZE,
+                                 checksumOk);
+    if (n > FRAME_OVERHEAD && plain[1] >= FRAME_OVERHEAD && plain[1] < n) {
+        n = codec.decodeFrame(data, plain[1], plain, FRAME_MAX_SIZE, checksumOk);
+    }
+    return n;
+}
+
+class CaptureAnalyzer: public AttListener {
+public:
+    // out nullptr: count only
+    CaptureAnalyzer(FILE* out, bool json) : out(out), json(json) {}
+
+    AttStream stream{*this};
+    CaptureTotals totals;
+    std::vector<CaptureSession>* finished = nullptr;   // closed sessions, for the selftest
+
+    void onOpen(AttLink& link) override {
+        slots[stream.indexOf(link)] = CaptureSession();
+    }
+
+    void onClose(AttLink& link, uint64_t timestampUs, uint8_t reason) override;
+    void onValue(AttLink& link, uint64_t timestampUs, AttValueKind kind, uint16_t attHandle,
+                 const uint8_t* value, size_t len) override;
+
+private:
+    void begin(AttLink& link, CaptureSession& session);
+    void frame(AttLink& link, CaptureSession& session, uint64_t timestampUs, bool request, const uint8_t* plain,
+               size_t len, bool checksumOk);
+    bool chunk(ChunkAssembler& chunks, std::string& value, const uint8_t* payload, size_t len,
+               std::string& detail);
+    void field(AttLink& link, CaptureSession& session, uint64_t timestampUs, const char* name,
+               const std::string& value);
+    void emit(AttLink& link, uint64_t timestampUs, bool request, uint8_t instruction, const std::string& detail,
+              int64_t latencyUs, const uint8_t* payload, size_t payloadLen);
+    std::string tag(const AttLink& link) const;
+
+    FILE* out;
+    bool json;
+    CaptureSession slots[ATT_MAX_LINKS];
+};
+
+std::string CaptureAnalyzer::tag(const AttLink& link) const {
+    char text[24];
+    snprintf(text, sizeof(text), json ? "hci%u/0x%04x" : "[hci%u 0x%04x]", link.adapter, link.handle);
+    return text;
+}
+
+void CaptureAnalyzer::onValue(AttLink& link, uint64_t timestampUs, AttValueKind kind, uint16_t attHandle,
+                              const uint8_t* value, size_t len) {
+    bool request = kind == ATT_VALUE_WRITE;
+    uint16_t& handle = request ? link.writeHandle : link.notifyHandle;
+    if ((handle && attHandle != handle) || len == 0) return;
+    CaptureSession& session = slots[stream.indexOf(link)];
+    uint8_t opcode = request ? OPCODE_REQUEST : OPCODE_RESPONSE;
+
+    // Hardened frames keep a plaintext header; the rest needs the session key
+    bool hello = HardenedChannel::isHello(value, len);
+    if (value[0] == opcode && (hello || HardenedChannel::isSealed(value, len))) {
+        handle = attHandle;
+        begin(link, session);
+        session.hardened = true;
+        totals.frames++;
+        totals.hardenedFrames++;
+        char detail[80];
+        snprintf(detail, sizeof(detail), hello ? "hardened hello" : "hardened sealed frame, %zu bytes", len);
+        emit(link, timestampUs, request, 0, detail, -1, nullptr, 0);
+        return;
+    }
+
+    for (size_t at = 0; at < len;) {
+        uint8_t plain[FRAME_MAX_SIZE];
+        bool checksumOk = false;
+        size_t n = decodeNext(value + at, len - at, plain, &checksumOk);
+        if (!handle) {
+            // Nothing says this attribute carries frames: only one that
+            // checks out settles it
+            if (n < FRAME_OVERHEAD || plain[0] != opcode || plain[1] != n || !checksumOk) return;
+            handle = attHandle;
+        }
+        frame(link, session, timestampUs, request, plain, n, checksumOk);
+        at += n;
+    }
+}
+
+void CaptureAnalyzer::begin(AttLink& link, CaptureSession& session) {
+    if (session.unitree) return;
+    session.unitree = true;
+    totals.sessions++;
+    if (!out) return;
+
+    std::string peer = link.peerKnown ? peerAddress(link) : "unknown";
+    const char* peerType = link.peerKnown && link.peerType < 4 ? PEER_TYPES[link.peerType] : "unknown";
+    if (json) {
+        fprintf(out, "{\"event\":\"begin\",\"conn\":\"%s\",\"time_us\":%llu,\"peer\":\"%s\",\"peer_type\":\"%s\"}\n",
+                tag(link).c_str(), (unsigned long long)link.openedUs, peer.c_str(), peerType);
+    } else {
+        fprintf(out, "%s Unitree session, peer %s (%s), %s %s\n", tag(link).c_str(), peer.c_str(), peerType,
+                link.peerKnown ? "connected" : "first seen", utcTime(link.openedUs).c_str());
+    }
+}
+
+void CaptureAnalyzer::frame(AttLink& link, CaptureSession& session, uint64_t timestampUs, bool request,
+                            const uint8_t* plain, size_t len, bool checksumOk) {
+    begin(link, session);
+    totals.frames++;
+
+    if (len < FRAME_OVERHEAD || plain[1] != len || !checksumOk ||
+        plain[0] != (request ? OPCODE_REQUEST : OPCODE_RESPONSE)) {
+        session.badFrames++;
+        totals.badFrames++;
+        emit(link, timestampUs, request, 0, checksumOk ? "malformed frame" : "bad checksum", -1, plain, len);
+        return;
+    }
+
+    uint8_t instruction = plain[2];
+    const uint8_t* payload = plain + FRAME_HEADER_SIZE;
+    size_t payloadLen = len - FRAME_OVERHEAD;
+    const char* name = instruction <= INSTR_MAX ? INSTRUCTION_NAMES[instruction] : nullptr;
+    std::string detail = name ? name : "instruction";
+    if (!name) {
+        char number[8];
+        snprintf(number, sizeof(number), " 0x%02x", instruction);
+        detail += number;
+    }
+
+    // Fields completed by this frame, reported after it
+    const char* completed = nullptr;
+    std::string* completedValue = nullptr;
+    int64_t latencyUs = -1;
+
+    if (request) {
+        session.requests++;
+        totals.requests++;
+        session.requestUs = timestampUs;
+        switch (instruction) {
+            case INSTR_HANDSHAKE:
+                // [0x00, 0x00, auth string]
+                session.auth.assign((const char*)payload + (payloadLen > 2 ? 2 : payloadLen),
+                                    payloadLen > 2 ? payloadLen - 2 : 0);
+                session.handshake = HANDSHAKE_SENT;
+                detail += " " + quoted(session.auth, json);
+                break;
+            case INSTR_INIT_WIFI:
+                if (payloadLen >= 1) {
+                    detail += payload[0] == 0x01 ? ", access point" : payload[0] == 0x02 ? ", station" : ", unknown mode";
+                }
+                break;
+            case INSTR_SET_SSID:
+                if (chunk(session.ssidChunks, session.ssid, payload, payloadLen, detail)) {
+                    completed = "ssid";
+                    completedValue = &session.ssid;
+                }
+                break;
+            case INSTR_SET_PASSWORD:
+                if (chunk(session.passwordChunks, session.password, payload, payloadLen, detail)) {
+                    completed = "password";
+                    completedValue = &session.password;
+                }
+                break;
+            case INSTR_SET_COUNTRY:
+                // Code after the first byte, zero padding dropped, as the robot reads it
+                session.country.clear();
+                for (size_t i = 1; i < payloadLen; i++) {
+                    if (payload[i] != 0x00) session.country += (char)payload[i];
+                }
+                detail += " " + quoted(session.country, json);
+                completed = "country";
+                completedValue = &session.country;
+                break;
+        }
+    } else {
+        session.replies++;
+        totals.replies++;
+        if (session.requestUs) latencyUs = (int64_t)(timestampUs - session.requestUs);
+        if (instruction == INSTR_GET_SERIAL && payloadLen >= 2) {
+            detail = "serial";
+            if (chunk(session.serialChunks, session.serial, payload, payloadLen, detail)) {
+                completed = "serial";
+                completedValue = &session.serial;
+            }
+        } else if (payloadLen >= 1) {
+            bool ok = payload[0] == 0x01;
+            if (instruction == INSTR_HANDSHAKE) {
+                session.handshake = ok ? HANDSHAKE_ACCEPTED : HANDSHAKE_REJECTED;
+                detail += ok ? " accepted" : " rejected";
+            } else {
+                detail += ok ? " ok" : " failed";
+            }
+        }
+    }
+
+    emit(link, timestampUs, request, instruction, detail, latencyUs, payload, payloadLen);
+    if (completed) field(link, session, timestampUs, completed, *completedValue);
+}
+
+// One [index, total, data] chunk; true when it completes value
+bool CaptureAnalyzer::chunk(ChunkAssembler& chunks, std::string& value, const uint8_t* payload, size_t len,
+                            std::string& detail) {
+    if (len < 2) {
+        detail += " (short chunk)";
+        return false;
+    }
+    char position[24];
+    snprintf(position, sizeof(position), " %u/%u ", payload[0], payload[1]);
+    detail += position + quoted(payload + 2, len - 2, json);
+
+    switch (chunks.add(payload[0], payload[1], payload + 2, len - 2)) {
+        case CHUNK_COMPLETE:
+            value.assign((const char*)chunks.data(), chunks.size());
+            return true;
+        case CHUNK_DUPLICATE:
+            detail += " (duplicate)";
+            return false;
+        case CHUNK_REJECTED:
+            detail += " (rejected)";
+            return false;
+        default:
+            return false;
+    }
+}
+
+void CaptureAnalyzer::field(AttLink& link, CaptureSession& session, uint64_t timestampUs, const char* name,
+                            const std::string& value) {
+    uint32_t hits = scanInjection((const uint8_t*)value.data(), value.size());
+    if (hits) session.flagged++;
+    if (!out) return;
+
+    if (json) {
+        fprintf(out, "{\"event\":\"field\",\"conn\":\"%s\",\"time_us\":%llu,\"name\":\"%s\",\"value\":%s,"
+                "\"injection\":[%s]}\n",
+                tag(link).c_str(), (unsigned long long)timestampUs, name, quoted(value, true).c_str(),
+                injectionRules(hits, true).c_str());
+    } else {
+        fprintf(out, "%s %*s = %s %s%s%s\n", tag(link).c_str(), 11, "", name, quoted(value, false).c_str(),
+                hits ? "  INJECTION: " : "", injectionRules(hits, false).c_str());
+    }
+}
+
+void CaptureAnalyzer::emit(AttLink& link, uint64_t timestampUs, bool request, uint8_t instruction,
+                           const std::string& detail, int64_t latencyUs, const uint8_t* payload, size_t payloadLen) {
+    if (!out) return;
+    double sinceOpen = (double)(timestampUs - link.openedUs) / 1e6;
+
+    if (json) {
+        fprintf(out, "{\"event\":\"frame\",\"conn\":\"%s\",\"time_us\":%llu,\"dir\":\"%s\",\"instruction\":%u,"
+                "\"detail\":%s,\"latency_us\":%lld,\"payload\":\"%s\"}\n",
+                tag(link).c_str(), (unsigned long long)timestampUs, request ? "request" : "reply", instruction,
+                quoted(detail, true).c_str(), (long long)latencyUs, hex(payload, payloadLen).c_str());
+        return;
+    }
+
+    char latency[32] = "";
+    if (latencyUs >= 0) snprintf(latency, sizeof(latency), "  (%.3f ms)", latencyUs / 1000.0);
+    fprintf(out, "%s +%10.6f %c %s%s\n", tag(link).c_str(), sinceOpen, request ? '>' : '<', detail.c_str(), latency);
+}
+
+void CaptureAnalyzer::onClose(AttLink& link, uint64_t timestampUs, uint8_t reason) {
+    CaptureSession& session = slots[stream.indexOf(link)];
+    if (!session.unitree) return;
+    if (session.flagged) totals.flaggedSessions++;
+    if (finished) finished->push_back(session);
+    if (!out) return;
+
+    double duration = (double)(timestampUs - link.openedUs) / 1e6;
+    char why[32];
+    snprintf(why, sizeof(why), reason == ATT_LINK_LOST ? "no disconnect seen" : "reason 0x%02x", reason);
+
+    if (json) {
+        fprintf(out, "{\"event\":\"session\",\"conn\":\"%s\",\"start_us\":%llu,\"duration_us\":%llu,\"close\":\"%s\","
+                "\"mtu\":%u,\"hardened\":%s,\"handshake\":\"%s\",\"auth\":%s,\"requests\":%zu,\"replies\":%zu,"
+                "\"bad_frames\":%zu,\"serial\":%s,\"ssid\":%s,\"password\":%s,\"country\":%s,\"flagged_fields\":%zu}\n",
+                tag(link).c_str(), (unsigned long long)link.openedUs,
+                (unsigned long long)(timestampUs - link.openedUs), why, link.mtu(),
+                session.hardened ? "true" : "false", HANDSHAKE_NAMES[session.handshake],
+                quoted(session.auth, true).c_str(), session.requests, session.replies, session.badFrames,
+                quoted(session.serial, true).c_str(), quoted(session.ssid, true).c_str(),
+                quoted(session.password, true).c_str(), quoted(session.country, true).c_str(), session.flagged);
+        return;
+    }
+
+    fprintf(out, "%s closed after %.3f s (%s), MTU %u: handshake %s, %zu requests, %zu replies", tag(link).c_str(),
+            duration, why, link.mtu(), HANDSHAKE_NAMES[session.handshake], session.requests, session.replies);
+    if (session.badFrames) fprintf(out, ", %zu bad frames", session.badFrames);
+    if (session.hardened) fprintf(out, ", hardened profile");
+    if (!session.serial.empty()) fprintf(out, ", serial %s", quoted(session.serial, false).c_str());
+    if (!session.ssid.empty()) fprintf(out, ", ssid %s", quoted(session.ssid, false).c_str());
+    if (!session.password.empty()) fprintf(out, ", password %s", quoted(session.password, false).c_str());
+    if (!session.country.empty()) fprintf(out, ", country %s", quoted(session.country, false).c_str());
+    if (session.flagged) fprintf(out, ", %zu field%s flagged", session.flagged, session.flagged == 1 ? "" : "s");
+    fprintf(out, "\n");
+}
+
+struct CaptureRun {
+    uint32_t datalink = 0;
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    bool truncated = false;
+    double seconds = 0;
+};
+
+static bool analyzeFile(const char* path, CaptureAnalyzer& analyzer, CaptureRun& run, std::string& error) {
+    auto start = std::chrono::steady_clock::now();
+    BtsnoopReader reader;
+    if (!reader.open(path, error)) return false;
+
+    HciPacket packet;
+    uint64_t lastUs = 0;
+    while (reader.next(packet)) {
+        analyzer.stream.feed(packet);
+        lastUs = packet.timestampUs;
+    }
+    analyzer.stream.finish(lastUs);
+
+    run.datalink = reader.datalink();
+    run.bytes = reader.offset();
+    run.records = reader.records();
+    run.truncated = reader.truncated();
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+static int analyze(const char* path, bool json, bool quiet) {
+    static char buffer[1 << 16];
+    setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+
+    CaptureAnalyzer analyzer(quiet ? nullptr : stdout, json);
+    CaptureRun run;
+    std::string error;
+    if (!analyzeFile(path, analyzer, run, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const AttStreamStats& stream = analyzer.stream.stats();
+    const CaptureTotals& totals = analyzer.totals;
+    double mbPerSecond = run.seconds > 0 ? run.bytes / run.seconds / 1e6 : 0;
+    const char* datalink = run.datalink == BTSNOOP_DATALINK_H4 ? "H4"
+                         : run.datalink == BTSNOOP_DATALINK_H1 ? "H1" : "monitor";
+
+    if (json) {
+        printf("{\"event\":\"summary\",\"datalink\":\"%s\",\"bytes\":%llu,\"records\":%llu,\"truncated\":%s,"
+               "\"seconds\":%.3f,\"mb_per_s\":%.1f,\"peak_rss_kb\":%ld,\"acl_packets\":%llu,\"att_pdus\":%llu,"
+               "\"l2cap_dropped\":%llu,\"prepare_dropped\":%llu,\"peak_links\":%zu,\"links_evicted\":%llu,"
+               "\"sessions\":%llu,\"frames\":%llu,\"requests\":%llu,\"replies\":%llu,\"bad_frames\":%llu,"
+               "\"hardened_frames\":%llu,\"flagged_sessions\":%llu}\n",
+               datalink, (unsigned long long)run.bytes, (unsigned long long)run.records,
+               run.truncated ? "true" : "false", run.seconds, mbPerSecond, usage.ru_maxrss,
+               (unsigned long long)stream.aclPackets, (unsigned long long)stream.attPdus,
+               (unsigned long long)stream.l2capDropped, (unsigned long long)stream.prepareDropped,
+               stream.peakLinks, (unsigned long long)stream.linksEvicted, (unsigned long long)totals.sessions,
+               (unsigned long long)totals.frames, (unsigned long long)totals.requests,
+               (unsigned long long)totals.replies, (unsigned long long)totals.badFrames,
+               (unsigned long long)totals.hardenedFrames, (unsigned long long)totals.flaggedSessions);
+    } else {
+        printf("\n%s: %s, %.1f MB, %llu records in %.2f s (%.0f MB/s), peak RSS %.1f MB\n", path, datalink,
+               run.bytes / 1e6, (unsigned long long)run.records, run.seconds, mbPerSecond, usage.ru_maxrss / 1024.0);
+        if (run.truncated) printf("  capture ends mid-record after %llu bytes\n", (unsigned long long)run.bytes);
+        printf("  %llu ACL packets, %llu ATT PDUs, %llu L2CAP PDUs dropped, %llu prepared writes dropped, "
+               "%zu links open at most, %llu evicted\n",
+               (unsigned long long)stream.aclPackets, (unsigned long long)stream.attPdus,
+               (unsigned long long)stream.l2capDropped, (unsigned long long)stream.prepareDropped,
+               stream.peakLinks, (unsigned long long)stream.linksEvicted);
+        printf("  %llu Unitree sessions: %llu frames (%llu requests, %llu replies), %llu bad, %llu hardened, "
+               "%llu sessions with injection attempts\n",
+               (unsigned long long)totals.sessions, (unsigned long long)totals.frames,
+               (unsigned long long)totals.requests, (unsigned long long)totals.replies,
+               (unsigned long long)totals.badFrames, (unsigned long long)totals.hardenedFrames,
+               (unsigned long long)totals.flaggedSessions);
+    }
+    fflush(stdout);
+    return 0;
+}
+
+// --- sample captures ---
+
+// The sample GATT table: Unitree service with notify and write values
+#define SAMPLE_SERVICE_START  0x0028
+#define SAMPLE_NOTIFY_HANDLE  0x002a
+#define SAMPLE_CCCD_HANDLE    0x002b
+#define SAMPLE_WRITE_HANDLE   0x002d
+#define SAMPLE_SERVICE_END    0x002e
+#define SAMPLE_NOISE_HANDLE   0x0012   // a heart-rate style sensor on another link
+#define SAMPLE_ACL_DATA       27       // LE default data length, so longer PDUs fragment
+#define SAMPLE_START_US       1767225600000000ULL   // 2026-01-01 00:00:00 UTC
+
+#define SAMPLE_INJECTED_PASSWORD "pass;$(touch /tmp/unipwn);#"
+
+// What session i of a sample carries
+struct SampleSession {
+    std::string ssid;
+    std::string password;
+    bool injected;
+    bool discovery;   // GATT discovery in the capture, else the analyzer probes
+    bool prepared;    // handshake sent as prepared writes
+    uint16_t mtu;
+};
+
+static SampleSession sampleSession(size_t i) {
+    SampleSession session;
+    session.ssid = "UnitreeLab-" + std::to_string(i);
+    session.injected = i % 3 == 1;
+    session.password = session.injected ? SAMPLE_INJECTED_PASSWORD : "hunter2-" + std::to_string(i);
+    session.discovery = i % 4 != 3;
+    session.prepared = i % 5 == 4;
+    session.mtu = i % 2 ? 185 : ATT_MTU_DEFAULT;
+    return session;
+}
+
+// Scripted clients against the emulator core, written out as the HCI
+// traffic of a phone provisioning the robot
+class SampleWriter: public EmulatorTransport {
+public:
+    bool open(const char* path, uint32_t datalink) {
+        monitor = datalink == BTSNOOP_DATALINK_MONITOR;
+        setEmulatorClock(clock);
+        sessions.releaseAll();
+        return file.open(path, datalink);
+    }
+
+    bool close() {
+        setEmulatorClock(previousClock);
+        return file.close();
+    }
+
+    void session(size_t i);
+    void finish();
+
+    bool send(EmulatorSession& session, const Response& response, uint32_t token) override {
+        response.forEachFrame([&](const uint8_t* frame, size_t len) {
+            advance(2000, 9000);
+            notify(0, conn, SAMPLE_NOTIFY_HANDLE, frame, len);
+        });
+        return true;
+    }
+
+private:
+    void advance(uint32_t lowUs, uint32_t highUs);
+    void event(uint16_t adapter, uint8_t code, const uint8_t* params, size_t len);
+    void att(uint16_t adapter, uint16_t handle, bool received, const uint8_t* pdu, size_t len);
+    void notify(uint16_t adapter, uint16_t handle, uint16_t attHandle, const uint8_t* value, size_t len);
+    void write(const uint8_t* frame, size_t len, bool prepared);
+    void connect(uint16_t adapter, uint16_t handle, uint64_t peer, bool enhanced);
+    void discovery();
+
+    BtsnoopWriter file;
+    bool monitor = false;
+    VirtualClock clock;
+    EmulatorClock& previousClock = emulatorClock();
+    EmulatorEndpoint endpoint{*this};
+    uint64_t nowUs = SAMPLE_START_US;
+    uint32_t random = 1;
+    uint16_t conn = 0;
+    bool noiseOpen = false;
+};
+
+void SampleWriter::advance(uint32_t lowUs, uint32_t highUs) {
+    random = random * 1103515245 + 12345;
+    nowUs += lowUs + (random >> 8) % (highUs - lowUs);
+    clock.advanceTo(nowUs - SAMPLE_START_US);
+}
+
+void SampleWriter::event(uint16_t adapter, uint8_t code, const uint8_t* params, size_t len) {
+    uint8_t packet[64] = {code, (uint8_t)len};
+    memcpy(packet + 2, params, len);
+    file.write(nowUs, HCI_EVENT, true, packet, 2 + len, adapter);
+}
+
+// One ATT PDU as L2CAP over ACL, cut into SAMPLE_ACL_DATA fragments
+void SampleWriter::att(uint16_t adapter, uint16_t handle, bool received, const uint8_t* pdu, size_t len) {
+    uint8_t l2cap[L2CAP_MAX_PDU] = {(uint8_t)len, (uint8_t)(len >> 8), 0x04, 0x00};
+    memcpy(l2cap + 4, pdu, len);
+    size_t total = 4 + len;
+
+    for (size_t at = 0; at < total; at += SAMPLE_ACL_DATA) {
+        size_t count = total - at < SAMPLE_ACL_DATA ? total - at : SAMPLE_ACL_DATA;
+        uint16_t header = handle | (at == 0 ? 0x0000 : 0x1000);
+        uint8_t acl[4 + SAMPLE_ACL_DATA] = {(uint8_t)header, (uint8_t)(header >> 8), (uint8_t)count, 0};
+        memcpy(acl + 4, l2cap + at, count);
+        file.write(nowUs, HCI_ACL, received, acl, 4 + count, adapter);
+    }
+}
+
+void SampleWriter::notify(uint16_t adapter, uint16_t handle, uint16_t attHandle, const uint8_t* value, size_t len) {
+    uint8_t pdu[3 + FRAME_MAX_SIZE] = {0x1B, (uint8_t)attHandle, (uint8_t)(attHandle >> 8)};
+    memcpy(pdu + 3, value, len);
+    att(adapter, handle, true, pdu, 3 + len);
+}
+
+// A request frame to the write characteristic: a write command, or
+// prepared writes of 8 bytes and an execute
+void SampleWriter::write(const uint8_t* frame, size_t len, bool prepared) {
+    advance(5000, 40000);
+    if (!prepared) {
+        uint8_t pdu[3 + FRAME_MAX_SIZE] = {0x52, SAMPLE_WRITE_HANDLE, 0x00};
+        memcpy(pdu + 3, frame, len);
+        att(0, conn, false, pdu, 3 + len);
+    } else {
+        for (size_t offset = 0; offset < len; offset += 8) {
+            size_t count = len - offset < 8 ? len - offset : 8;
+            uint8_t pdu[5 + 8] = {0x16, SAMPLE_WRITE_HANDLE, 0x00, (uint8_t)offset, (uint8_t)(offset >> 8)};
+            memcpy(pdu + 5, frame + offset, count);
+            att(0, conn, false, pdu, 5 + count);
+            pdu[0] = 0x17;   // the server echoes each one
+            att(0, conn, true, pdu, 5 + count);
+        }
+        static const uint8_t EXECUTE[] = {0x18, 0x01};
+        att(0, conn, false, EXECUTE, sizeof(EXECUTE));
+    }
+
+    // Unrelated traffic in between
+    static const uint8_t READING[] = {0x16, 0x48, 0x00, 0x03, 0x00};
+    notify(monitor ? 1 : 0, monitor ? conn : 0x0080, SAMPLE_NOISE_HANDLE, READING, sizeof(READING));
+
+    endpoint.write(conn, frame, len);
+}
+
+void SampleWriter::connect(uint16_t adapter, uint16_t handle, uint64_t peer, bool enhanced) {
+    // LE (Enhanced) Connection Complete: subevent, status, handle, role
+    // (peripheral from the phone's controller), peer address type and address
+    uint8_t params[31] = {(uint8_t)(enhanced ? 0x0A : 0x01), 0x00, (uint8_t)handle, (uint8_t)(handle >> 8), 0x00,
+                          0x01};
+    for (size_t i = 0; i < 6; i++) params[6 + i] = (uint8_t)(peer >> (8 * i));
+    event(adapter, 0x3E, params, enhanced ? 31 : 19);
+}
+
+// Primary services by group type, then the Unitree characteristics, then
+// notifications switched on
+void SampleWriter::discovery() {
+    static const uint8_t GROUP_REQ[] = {0x10, 0x01, 0x00, 0xff, 0xff, 0x00, 0x28};
+    static const uint8_t GROUP_RSP16[] = {0x11, 0x06, 0x01, 0x00, 0x07, 0x00, 0x00, 0x18,
+                                          0x08, 0x00, 0x0b, 0x00, 0x01, 0x18};
+    static const uint8_t GROUP_RSP128[] = {0x11, 0x14, SAMPLE_SERVICE_START, 0x00, SAMPLE_SERVICE_END, 0x00,
+                                           0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+                                           0x00, 0x10, 0x00, 0x00, 0xe0, 0xff, 0x00, 0x00};
+    static const uint8_t TYPE_REQ[] = {0x08, SAMPLE_SERVICE_START, 0x00, SAMPLE_SERVICE_END, 0x00, 0x03, 0x28};
+    static const uint8_t TYPE_RSP[] = {0x09, 0x07,
+                                       0x29, 0x00, 0x10, SAMPLE_NOTIFY_HANDLE, 0x00, 0xe1, 0xff,
+                                       0x2c, 0x00, 0x0c, SAMPLE_WRITE_HANDLE, 0x00, 0xe2, 0xff};
+
+    advance(20000, 60000);
+    att(0, conn, false, GROUP_REQ, sizeof(GROUP_REQ));
+    advance(5000, 15000);
+    att(0, conn, true, GROUP_RSP16, sizeof(GROUP_RSP16));
+    advance(5000, 15000);
+    att(0, conn, true, GROUP_RSP128, sizeof(GROUP_RSP128));
+    advance(5000, 15000);
+    att(0, conn, false, TYPE_REQ, sizeof(TYPE_REQ));
+    advance(5000, 15000);
+    att(0, conn, true, TYPE_RSP, sizeof(TYPE_RSP));
+}
+
+// Chunk text as the client does: [index, total, up to 14 bytes]
+static void addChunked(std::vector<std::vector<uint8_t>>& script, uint8_t instruction, const std::string& text) {
+    uint8_t total = (uint8_t)((text.size() + 13) / 14);
+    for (uint8_t index = 1; index <= total; index++) {
+        size_t offset = (size_t)(index - 1) * 14;
+        size_t count = text.size() - offset < 14 ? text.size() - offset : 14;
+        uint8_t payload[16] = {index, total};
+        memcpy(payload + 2, text.data() + offset, count);
+        uint8_t frame[FRAME_MAX_SIZE];
+        size_t len = codec.encodeRequest(instruction, payload, 2 + count, frame, sizeof(frame));
+        script.emplace_back(frame, frame + len);
+    }
+}
+
+void SampleWriter::session(size_t i) {
+    static const uint8_t HANDSHAKE[] = {0x00, 0x00, 'u', 'n', 'i', 't', 'r', 'e', 'e'};
+    static const uint8_t INIT_WIFI[] = {0x02};
+    static const uint8_t COUNTRY[] = {0x01, 'U', 'S', 0x00};
+    static const uint8_t CCCD_WRITE[] = {0x12, SAMPLE_CCCD_HANDLE, 0x00, 0x01, 0x00};
+    static const uint8_t WRITE_RSP[] = {0x13};
+    SampleSession sample = sampleSession(i);
+
+    if (!noiseOpen) {
+        connect(monitor ? 1 : 0, monitor ? 0x0040 : 0x0080, 0xA4C13800BEEFULL, false);
+        noiseOpen = true;
+    }
+
+    advance(200000, 2000000);
+    conn = 0x0040 + (uint16_t)(i % 16);
+    connect(0, conn, 0xC0FFEE000000ULL | (i & 0xFFFFFF), i % 2);
+    endpoint.connect(conn, ATT_MTU_DEFAULT);
+
+    if (sample.mtu != ATT_MTU_DEFAULT) {
+        const uint8_t request[] = {0x02, 247, 0x00};
+        const uint8_t response[] = {0x03, (uint8_t)sample.mtu, (uint8_t)(sample.mtu >> 8)};
+        advance(1000, 5000);
+        att(0, conn, false, request, sizeof(request));
+        advance(1000, 5000);
+        att(0, conn, true, response, sizeof(response));
+        endpoint.mtuChanged(conn, sample.mtu);
+    }
+    if (sample.discovery) discovery();
+    advance(5000, 15000);
+    att(0, conn, false, CCCD_WRITE, sizeof(CCCD_WRITE));
+    att(0, conn, true, WRITE_RSP, sizeof(WRITE_RSP));
+
+    std::vector<std::vector<uint8_t>> script;
+    uint8_t frame[FRAME_MAX_SIZE];
+    size_t len = codec.encodeRequest(INSTR_GET_SERIAL, nullptr, 0, frame, sizeof(frame));   // before the handshake
+    script.emplace_back(frame, frame + len);
+    len = codec.encodeRequest(INSTR_HANDSHAKE, HANDSHAKE, sizeof(HANDSHAKE), frame, sizeof(frame));
+    script.emplace_back(frame, frame + len);
+    len = codec.encodeRequest(INSTR_GET_SERIAL, nullptr, 0, frame, sizeof(frame));
+    script.emplace_back(frame, frame + len);
+    len = codec.encodeRequest(INSTR_INIT_WIFI, INIT_WIFI, sizeof(INIT_WIFI), frame, sizeof(frame));
+    script.emplace_back(frame, frame + len);
+    addChunked(script, INSTR_SET_SSID, sample.ssid);
+    addChunked(script, INSTR_SET_PASSWORD, sample.password);
+    len = codec.encodeRequest(INSTR_SET_COUNTRY, COUNTRY, sizeof(COUNTRY), frame, sizeof(frame));
+    script.emplace_back(frame, frame + len);
+
+    for (size_t step = 0; step < script.size(); step++) {
+        write(script[step].data(), script[step].size(), sample.prepared && step == 1);
+    }
+
+    // Disconnection Complete: status, handle, remote user terminated
+    advance(50000, 300000);
+    const uint8_t params[] = {0x00, (uint8_t)conn, (uint8_t)(conn >> 8), 0x13};
+    event(0, 0x05, params, sizeof(params));
+    endpoint.disconnect(conn);
+    logDrain(discardLog);
+}
+
+static bool writeSample(const char* path, uint32_t datalink, size_t count) {
+    SampleWriter writer;
+    if (!writer.open(path, datalink)) {
+        writer.close();
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) writer.session(i);
+    return writer.close();
+}
+
+static int sample(const char* path, uint32_t datalink, size_t count) {
+    auto start = std::chrono::steady_clock::now();
+    if (!writeSample(path, datalink, count)) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    FILE* file = fopen(path, "rb");
+    long size = 0;
+    if (file && fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    if (file) fclose(file);
+    printf("%s: %zu sessions, %.1f MB in %.2f s\n", path, count, size / 1e6,
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
+
+// --- selftest ---
+
+#define SELFTEST_SESSIONS 24
+
+static bool sameFields(const CaptureSession& a, const CaptureSession& b) {
+    return a.ssid == b.ssid && a.password == b.password && a.country == b.country && a.serial == b.serial &&
+           a.auth == b.auth && a.handshake == b.handshake && a.requests == b.requests && a.replies == b.replies &&
+           a.flagged == b.flagged;
+}
+
+static int selftest() {
+    int failures = 0;
+    std::vector<CaptureSession> found[2];
+    const uint32_t DATALINKS[] = {BTSNOOP_DATALINK_H4, BTSNOOP_DATALINK_MONITOR};
+
+    for (size_t d = 0; d < 2; d++) {
+        char path[] = "/tmp/unitree-capture-XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) return 1;
+        ::close(fd);
+        if (!writeSample(path, DATALINKS[d], SELFTEST_SESSIONS)) {
+            fprintf(stderr, "%s: cannot write sample\n", path);
+            unlink(path);
+            return 1;
+        }
+
+        CaptureAnalyzer analyzer(nullptr, false);
+        analyzer.finished = &found[d];
+        CaptureRun run;
+        std::string error;
+        if (!analyzeFile(path, analyzer, run, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            unlink(path);
+            return 1;
+        }
+
+        size_t wrong = 0;
+        for (size_t i = 0; i < found[d].size(); i++) {
+            const CaptureSession& session = found[d][i];
+            SampleSession expected = sampleSession(i);
+            if (session.ssid != expected.ssid || session.password != expected.password ||
+                session.country != "US" || session.serial != SERIAL_NUMBER || session.auth != "unitree" ||
+                session.handshake != HANDSHAKE_ACCEPTED || session.badFrames ||
+                (session.flagged != 0) != expected.injected) {
+                wrong++;
+            }
+        }
+        const AttStreamStats& stream = analyzer.stream.stats();
+        printf("%s: %llu records, %zu sessions, %llu frames, %zu wrong, %llu bad, %llu flagged, "
+               "%llu L2CAP drops\n",
+               DATALINKS[d] == BTSNOOP_DATALINK_H4 ? "H4" : "monitor", (unsigned long long)run.records,
+               found[d].size(), (unsigned long long)analyzer.totals.frames, wrong,
+               (unsigned long long)analyzer.totals.badFrames, (unsigned long long)analyzer.totals.flaggedSessions,
+               (unsigned long long)stream.l2capDropped);
+        if (found[d].size() != SELFTEST_SESSIONS || wrong || analyzer.totals.badFrames || stream.l2capDropped ||
+            run.truncated) {
+            failures++;
+        }
+
+        // Cut mid-record: everything before the cut still decodes
+        if (truncate(path, (off_t)run.bytes - 5) == 0) {
+            std::vector<CaptureSession> cut;
+            CaptureAnalyzer partial(nullptr, false);
+            partial.finished = &cut;
+            CaptureRun cutRun;
+            bool ok = analyzeFile(path, partial, cutRun, error);
+            printf("  cut 5 bytes short: %s, %zu sessions\n", cutRun.truncated ? "truncation seen" : "not seen",
+                   cut.size());
+            if (!ok || !cutRun.truncated || cut.size() != SELFTEST_SESSIONS) failures++;
+        } else {
+            failures++;
+        }
+        unlink(path);
+    }
+
+    size_t differ = 0;
+    for (size_t i = 0; i < found[0].size() && i < found[1].size(); i++) {
+        if (!sameFields(found[0][i], found[1][i])) differ++;
+    }
+    printf("H4 and monitor: %zu sessions differ\n", differ);
+    if (differ || found[0].size() != found[1].size()) failures++;
+
+    printf("%s\n", failures == 0 ? "selftest ok" : "selftest FAILED");
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    initCrypto();
+    logDrain(discardLog);
+
+    const char* command = argv[1];
+    const char* path = nullptr;
+    bool json = false;
+    bool quiet = false;
+    size_t count = 1000;
+    uint32_t datalink = BTSNOOP_DATALINK_H4;
+
+    int arg = 2;
+    if (strcmp(command, "analyze") == 0 || strcmp(command, "sample") == 0) {
+        if (argc < 3) return usage();
+        path = argv[arg++];
+    }
+    for (; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[arg], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[arg], "--sessions") == 0 && arg + 1 < argc) {
+            count = strtoul(argv[++arg], nullptr, 0);
+        } else if (strcmp(argv[arg], "--datalink") == 0 && arg + 1 < argc) {
+            arg++;
+            if (strcmp(argv[arg], "h4") == 0) {
+                datalink = BTSNOOP_DATALINK_H4;
+            } else if (strcmp(argv[arg], "monitor") == 0) {
+                datalink = BTSNOOP_DATALINK_MONITOR;
+            } else {
+                return usage();
+            }
+        } else {
+            return usage();
+        }
+    }
+
+    if (strcmp(command, "analyze") == 0) return analyze(path, json, quiet);
+    if (strcmp(command, "sample") == 0) return sample(path, datalink, count);
+    if (strcmp(command, "selftest") == 0) return selftest();
+    return usage();
+}
@@ -0,0 +1,109 @@
+/**
+ * unitree-codec — encode and decode Unitree frames from the command line
+ *
+ *   unitree-codec encode <req|resp> <instruction> <payload hex>
+ *   unitree-codec decode <ciphertext hex>
+ *   unitree-codec selftest
+ *
+ * Reports the number of heap allocations made inside the codec, which
+ * must stay at zero.
+ */
+
+#include <UnitreeCodec.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AllocCounter.h"
+#include "GoldenVectors.h"
+#include "HexUtil.h"
+
+static int usage() {
+    fprintf(stderr,
+            "usage: unitree-codec encode <req|resp> <instruction> <payload hex>\n"
+            "       unitree-codec decode <ciphertext hex>\n"
+            "       unitree-codec selftest\n");
+    return 2;
+}
+
+// Check encode and decode against the golden frames
+static int selftest(UnitreeCodec& codec) {
+    int failures = 0;
+    for (const GoldenVector& v : GOLDEN_VECTORS) {
+        uint8_t plain[FRAME_MAX_SIZE];
+        uint8_t cipher[FRAME_MAX_SIZE];
+        uint8_t out[FRAME_MAX_SIZE];
+        int plainLen = parseHex(v.plaintext, plain, sizeof(plain));
+        int cipherLen = parseHex(v.ciphertext, cipher, sizeof(cipher));
+
+        size_t len = codec.encodeFrame(plain[0], plain[2], plain + FRAME_HEADER_SIZE,
+                                       plainLen - FRAME_OVERHEAD, out, sizeof(out));
+        bool encodeOk = (int)len == cipherLen && memcmp(out, cipher, len) == 0;
+
+        bool checksumOk = false;
+        len = codec.decodeFrame(cipher, cipherLen, out, sizeof(out), &checksumOk);
+        bool decodeOk = checksumOk && (int)len == plainLen && memcmp(out, plain, len) == 0;
+
+        printf("%-32s encode %s, decode %s\n", v.name,
+               encodeOk ? "ok" : "FAIL", decodeOk ? "ok" : "FAIL");
+        if (!encodeOk || !decodeOk) failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+
+    UnitreeCodec codec;
+    codec.begin();
+
+    uint8_t in[FRAME_MAX_SIZE];
+    uint8_t out[FRAME_MAX_SIZE];
+
+    if (strcmp(argv[1], "selftest") == 0) {
+        return selftest(codec);
+    }
+
+    if (strcmp(argv[1], "encode") == 0 && argc >= 4) {
+        uint8_t opcode = strcmp(argv[2], "resp") == 0 ? OPCODE_RESPONSE : OPCODE_REQUEST;
+        uint8_t instruction = (uint8_t)strtoul(argv[3], nullptr, 0);
+        int payloadLen = argc >= 5 ? parseHex(argv[4], in, FRAME_MAX_PAYLOAD) : 0;
+        if (payloadLen < 0) {
+            fprintf(stderr, "Error: bad payload hex\n");
+            return 1;
+        }
+
+        size_t before = allocationCount();
+        size_t len = codec.encodeFrame(opcode, instruction, in, payloadLen, out, sizeof(out));
+        size_t allocs = allocationCount() - before;
+
+        if (len == 0) {
+            fprintf(stderr, "Error: payload too long\n");
+            return 1;
+        }
+        printHex(stdout, out, len);
+        fprintf(stderr, "heap allocations: %zu\n", allocs);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "decode") == 0 && argc >= 3) {
+        int cipherLen = parseHex(argv[2], in, sizeof(in));
+        if (cipherLen <= 0) {
+            fprintf(stderr, "Error: bad ciphertext hex\n");
+            return 1;
+        }
+
+        size_t before = allocationCount();
+        bool valid = false;
+        size_t len = codec.decodeFrame(in, cipherLen, out, sizeof(out), &valid);
+        size_t allocs = allocationCount() - before;
+
+        printHex(stdout, out, len);
+        if (len >= FRAME_HEADER_SIZE) {
+            fprintf(stderr, "opcode 0x%02X, length %u, instruction 0x%02X, checksum %s\n",
+                    out[0], out[1], out[2], valid ? "ok" : "bad");
+        }
+        fprintf(stderr, "heap allocations: %zu\n", allocs);
+        return valid ? 0 : 1;
+    }
+
+    return usage();
+}
@@ -0,0 +1,708 @@
+/**
+ * unitree-emulator — the emulator's protocol core as a Linux process
+ *
+ *   unitree-emulator serve <socket> [--mtu n] [--faults "<profile>"] [--guard "<profile>"] [--quiet]
+ *   unitree-emulator bench [--seconds n] [--clients n] [--mtu n] [--socket]
+ *   unitree-emulator soak [--hours n] [--clients n] [--hostile n] [--seed n] [--abandon pct]
+ *                         [--faults "<profile>"] [--guard "<profile>"]
+ *   unitree-emulator selftest
+ *
+ * The firmware's EmulatorEndpoint (sessions, decode, dispatch, faults,
+ * trace) runs behind a host transport instead of NimBLE. serve listens on
+ * a Unix SOCK_SEQPACKET socket: every accepted connection is a BLE
+ * connection, every message a client sends is a write to the request
+ * characteristic and every message it receives is a notification. bench
+ * drives scripted provisioning sessions through an in-process loopback
+ * (or socket pairs with --socket) and reports frames per second. soak
+ * simulates clients with think times, reconnects and abandoned fields on
+ * a VirtualClock, so hours of traffic (timeouts included) run in seconds;
+ * --hostile adds clients that fail handshakes and send garbage, to show
+ * the peer guard (--guard) locking them out while the others carry on.
+ * selftest checks that both transports produce identical, valid replies.
+ */
+
+#include <EmulatorEndpoint.h>
+#include <chrono>
+#include <errno.h>
+#include <map>
+#include <set>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Log level for this file (-DLOG_LEVEL_BLE=n, defaults to LOG_LEVEL); it
+// stands in for the firmware's BLE layer
+#ifndef LOG_LEVEL_BLE
+#define LOG_LEVEL_BLE LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_BLE
+
+typedef std::vector<uint8_t> Frame;
+
+static int usage() {
+    fprintf(stderr,
+            "usage: unitree-emulator serve <socket> [--mtu n] [--faults \"<profile>\"] [--guard \"<profile>\"] [--quiet]\n"
+            "       unitree-emulator bench [--seconds n] [--clients n] [--mtu n] [--socket]\n"
+            "       unitree-emulator soak [--hours n] [--clients n] [--hostile n] [--seed n] [--abandon pct]\n"
+            "                             [--faults \"<profile>\"] [--guard \"<profile>\"]\n"
+            "       unitree-emulator selftest\n");
+    return 2;
+}
+
+static void discardLog(const char* text, size_t len) {}
+
+static void printLog(const char* text, size_t len) {
+    fwrite(text, 1, len, stdout);
+    fflush(stdout);
+}
+
+// --- clocks ---
+
+// Virtual time pinned to the steady clock, for serving real clients:
+// sleeps really sleep and timers fire once sync() sees them due
+class WallClock: public VirtualClock {
+public:
+    uint32_t micros() override { sync(); return VirtualClock::micros(); }
+    uint32_t millis() override { sync(); return VirtualClock::millis(); }
+
+    void sleep(uint32_t ms) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        sync();
+    }
+
+    void sync() {
+        advanceTo(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+// --- transports ---
+
+// Replies appended to a per-connection inbox, as a client would receive them
+class LoopbackTransport: public EmulatorTransport {
+public:
+    std::map<uint16_t, std::vector<Frame>> inbox;
+    std::set<uint16_t> dropped;   // connections the peer guard cut
+    size_t frames = 0;
+
+    bool send(EmulatorSession& session, const Response& response, uint32_t token) override {
+        if (response.delayMs > 0) {
+            emulatorClock().sleep(response.delayMs);
+        }
+        std::vector<Frame>& out = inbox[session.connHandle];
+        response.forEachFrame([&](const uint8_t* frame, size_t len) {
+            out.emplace_back(frame, frame + len);
+            frames++;
+        });
+        return true;
+    }
+
+    void disconnect(EmulatorSession& session) override {
+        dropped.insert(session.connHandle);
+    }
+};
+
+// Sessions bound to Unix seqpacket sockets: one message per frame
+class SocketTransport: public EmulatorTransport {
+public:
+    explicit SocketTransport(uint16_t mtu) : endpoint(*this), mtu(mtu) {}
+
+    ~SocketTransport() {
+        for (auto& entry : fds) close(entry.second);
+    }
+
+    bool send(EmulatorSession& session, const Response& response, uint32_t token) override {
+        if (response.delayMs > 0) {
+            emulatorClock().sleep(response.delayMs);
+        }
+        auto it = fds.find(session.connHandle);
+        if (it == fds.end()) return false;
+
+        bool ok = true;
+        response.forEachFrame([&](const uint8_t* frame, size_t len) {
+            if (::send(it->second, frame, len, MSG_NOSIGNAL) != (ssize_t)len) ok = false;
+            frames++;
+        });
+        return ok;
+    }
+
+    // Peer guard lockout: the next pump sees the hang-up and frees the session
+    void disconnect(EmulatorSession& session) override {
+        auto it = fds.find(session.connHandle);
+        if (it != fds.end()) shutdown(it->second, SHUT_RDWR);
+    }
+
+    // New connection on fd; closes it when the session pool is full or the
+    // peer is locked out. The client's pid stands in for its address, so a
+    // lockout outlives reconnects.
+    bool add(int fd) {
+        uint16_t connHandle = nextHandle++;
+        ucred cred = {};
+        socklen_t credLen = sizeof(cred);
+        uint64_t peer = getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &credLen) == 0 ? (uint64_t)cred.pid : 0;
+        if (!endpoint.connect(connHandle, mtu, peer)) {
+            LOG_ERROR("Error: session limit (%u) reached or peer locked out, closing\n",
+                      (unsigned)sessions.capacity());
+            close(fd);
+            return false;
+        }
+        fds[connHandle] = fd;
+        LOG_INFO("\n[*] Client connected (conn %u)\n", connHandle);
+        return true;
+    }
+
+    // Serve every readable connection (and listener, if any) once;
+    // waits up to timeoutMs for the first event
+    void pump(int listener, int timeoutMs) {
+        std::vector<pollfd> polled;
+        std::vector<uint16_t> handles;
+        if (listener >= 0) {
+            polled.push_back({listener, POLLIN, 0});
+            handles.push_back(SESSION_HANDLE_NONE);
+        }
+        for (auto& entry : fds) {
+            polled.push_back({entry.second, POLLIN, 0});
+            handles.push_back(entry.first);
+        }
+        if (poll(polled.data(), polled.size(), timeoutMs) <= 0) return;
+
+        for (size_t i = 0; i < polled.size(); i++) {
+            if (!polled[i].revents) continue;
+            if (handles[i] == SESSION_HANDLE_NONE) {
+                int fd = accept(listener, nullptr, nullptr);
+                if (fd >= 0) add(fd);
+                continue;
+            }
+
+            uint8_t data[FRAME_MAX_SIZE + 1];
+            ssize_t n = recv(polled[i].fd, data, sizeof(data), MSG_DONTWAIT);
+            if (n > 0) {
+                // Longer than the length byte can describe: dropped, as on the board
+                if (n <= FRAME_MAX_SIZE) endpoint.write(handles[i], data, n);
+                writes++;
+            } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                LOG_INFO("\n[*] Client disconnected (conn %u)\n", handles[i]);
+                endpoint.disconnect(handles[i]);
+                close(polled[i].fd);
+                fds.erase(handles[i]);
+            }
+        }
+    }
+
+    EmulatorEndpoint endpoint;
+    size_t writes = 0;
+    size_t frames = 0;
+
+private:
+    std::map<uint16_t, int> fds;
+    uint16_t mtu;
+    uint16_t nextHandle = 1;
+};
+
+// --- scripted client ---
+
+static void addRequest(std::vector<Frame>& script, uint8_t instruction, const uint8_t* payload, size_t len) {
+    uint8_t request[FRAME_MAX_SIZE];
+    size_t requestLen = codec.encodeRequest(instruction, payload, len, request, sizeof(request));
+    script.emplace_back(request, request + requestLen);
+}
+
+// Chunk text as the client does: [index, total, up to 14 bytes]
+static void addChunked(std::vector<Frame>& script, uint8_t instruction, const char* text) {
+    size_t len = strlen(text);
+    uint8_t total = (uint8_t)((len + 13) / 14);
+    for (uint8_t index = 1; index <= total; index++) {
+        size_t offset = (size_t)(index - 1) * 14;
+        size_t count = len - offset < 14 ? len - offset : 14;
+        uint8_t payload[16] = {index, total};
+        memcpy(payload + 2, text + offset, count);
+        addRequest(script, instruction, payload, 2 + count);
+    }
+}
+
+// One provisioning session, as unitree-replay's selftest plays it
+static std::vector<Frame> provisioningScript() {
+    static const uint8_t HANDSHAKE[] = {0x00, 0x00, 'u', 'n', 'i', 't', 'r', 'e', 'e'};
+    static const uint8_t INIT_WIFI[] = {0x02};
+    static const uint8_t COUNTRY[] = {0x01, 'U', 'S', 0x00};
+
+    std::vector<Frame> script;
+    addRequest(script, INSTR_GET_SERIAL, nullptr, 0);   // not yet authenticated
+    addRequest(script, INSTR_HANDSHAKE, HANDSHAKE, sizeof(HANDSHAKE));
+    addRequest(script, INSTR_GET_SERIAL, nullptr, 0);
+    addRequest(script, INSTR_INIT_WIFI, INIT_WIFI, sizeof(INIT_WIFI));
+    addChunked(script, INSTR_SET_SSID, "UnitreeLab-5G-Guest");
+    addChunked(script, INSTR_SET_PASSWORD, "pass;$(touch /tmp/unipwn);#");
+    addRequest(script, INSTR_SET_COUNTRY, COUNTRY, sizeof(COUNTRY));
+    return script;
+}
+
+// Client end of a socket pair: send one frame, collect what came back
+static std::vector<Frame> exchange(SocketTransport& server, int client, const Frame& request) {
+    std::vector<Frame> replies;
+    send(client, request.data(), request.size(), MSG_NOSIGNAL);
+    server.pump(-1, 0);
+
+    uint8_t data[FRAME_MAX_SIZE];
+    ssize_t n;
+    while ((n = recv(client, data, sizeof(data), MSG_DONTWAIT)) > 0) {
+        replies.emplace_back(data, data + n);
+    }
+    return replies;
+}
+
+static bool socketPair(SocketTransport& server, int& client) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) != 0) {
+        perror("socketpair");
+        return false;
+    }
+    client = pair[0];
+    return server.add(pair[1]);
+}
+
+// --- serve ---
+
+static int serve(const char* path, uint16_t mtu, bool quiet) {
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (listener < 0 || bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 8) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    printf("Serving on %s (MTU %u, %u sessions%s%s)\n", path, mtu, (unsigned)sessions.capacity(),
+           faults.enabled() ? ", faults on" : "", peerGuard.enabled() ? ", peer guard on" : "");
+    fflush(stdout);
+
+    WallClock clock;
+    setEmulatorClock(clock);
+    SocketTransport server(mtu);
+    for (;;) {
+        server.pump(listener, 100);
+        clock.sync();
+        logDrain(quiet ? discardLog : printLog);
+    }
+}
+
+// --- bench ---
+
+static int bench(double seconds, size_t clients, uint16_t mtu, bool useSocket) {
+    std::vector<Frame> script = provisioningScript();
+    LoopbackTransport loopback;
+    EmulatorEndpoint endpoint(loopback);
+    SocketTransport server(mtu);
+    std::vector<int> clientFds(clients, -1);
+
+    if (clients > sessions.capacity()) {
+        fprintf(stderr, "at most %u clients\n", (unsigned)sessions.capacity());
+        return 1;
+    }
+    for (size_t c = 0; c < clients; c++) {
+        if (useSocket ? !socketPair(server, clientFds[c]) : !endpoint.connect((uint16_t)(c + 1), mtu)) return 1;
+    }
+
+    uint8_t reply[FRAME_MAX_SIZE];
+    size_t writes = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < deadline) {
+        // Clients take turns, one script step at a time
+        for (size_t step = 0; step < script.size(); step++) {
+            for (size_t c = 0; c < clients; c++) {
+                const Frame& request = script[step];
+                if (useSocket) {
+                    send(clientFds[c], request.data(), request.size(), MSG_NOSIGNAL);
+                    server.pump(-1, 0);
+                    while (recv(clientFds[c], reply, sizeof(reply), MSG_DONTWAIT) > 0) {}
+                } else {
+                    endpoint.write((uint16_t)(c + 1), request.data(), request.size());
+                }
+                writes++;
+            }
+            loopback.inbox.clear();
+        }
+        logDrain(discardLog);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t frames = useSocket ? server.frames : loopback.frames;
+    printf("%s transport, %zu clients, MTU %u: %zu writes, %zu notifications in %.2f s\n",
+           useSocket ? "socket" : "loopback", clients, mtu, writes, frames, elapsed);
+    printf("%.0f frames/s in, %.0f frames/s out, %.2f us per write\n",
+           writes / elapsed, frames / elapsed, elapsed * 1e6 / writes);
+
+    for (int fd : clientFds) {
+        if (fd >= 0) close(fd);
+    }
+    return 0;
+}
+
+// --- soak: simulated clients on virtual time ---
+
+// One client write; pauseMs is extra silence before it
+struct SoakStep {
+    Frame frame;
+    uint32_t pauseMs;
+};
+
+struct SoakClient {
+    uint16_t connHandle;
+    uint64_t address;
+    uint32_t rng;
+    bool hostile = false;
+    bool connected = false;
+    std::vector<SoakStep> script;
+    size_t step = 0;
+    std::string ssid;
+    std::string password;
+};
+
+struct SoakRun {
+    VirtualClock clock;
+    LoopbackTransport transport;
+    EmulatorEndpoint endpoint{transport};
+    uint64_t endUs = 0;
+    uint32_t abandonPercent = 0;
+    size_t writes = 0;
+    size_t completed = 0;
+    size_t abandoned = 0;
+    size_t mismatched = 0;
+    size_t refused = 0;           // connects the peer guard turned away
+    size_t hostileWrites = 0;
+    size_t hostileAnswered = 0;   // hostile writes that got a reply
+    size_t honestThrottled = 0;   // must stay 0: the guard only hits offenders
+    size_t honestCut = 0;
+};
+
+static SoakRun* soakRun = nullptr;
+
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static uint32_t randomBetween(uint32_t& state, uint32_t low, uint32_t high) {
+    return low + nextRandom(state) % (high - low + 1);
+}
+
+static std::string randomText(uint32_t& state, size_t len) {
+    static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_";
+    std::string text(len, ' ');
+    for (char& c : text) c = ALPHABET[nextRandom(state) % (sizeof(ALPHABET) - 1)];
+    return text;
+}
+
+static void addSteps(std::vector<SoakStep>& steps, const std::vector<Frame>& frames) {
+    for (const Frame& frame : frames) steps.push_back({frame, 0});
+}
+
+// A provisioning session with fresh credentials. Some clients start a
+// password, go quiet past the reassembly timeout and send a different one
+// of the same length: the emulator must discard the stale chunks.
+static void buildSoakSession(SoakClient& client) {
+    static const uint8_t HANDSHAKE[] = {0x00, 0x00, 'u', 'n', 'i', 't', 'r', 'e', 'e'};
+    static const uint8_t INIT_WIFI[] = {0x02};
+    static const uint8_t COUNTRY[] = {0x01, 'U', 'S', 0x00};
+
+    client.ssid = randomText(client.rng, randomBetween(client.rng, 8, 32));
+    client.password = randomText(client.rng, randomBetween(client.rng, 15, 63));   // two chunks or more
+    client.script.clear();
+    client.step = 0;
+
+    std::vector<Frame> frames;
+    addRequest(frames, INSTR_GET_SERIAL, nullptr, 0);
+    addRequest(frames, INSTR_HANDSHAKE, HANDSHAKE, sizeof(HANDSHAKE));
+    addRequest(frames, INSTR_GET_SERIAL, nullptr, 0);
+    addRequest(frames, INSTR_INIT_WIFI, INIT_WIFI, sizeof(INIT_WIFI));
+    addChunked(frames, INSTR_SET_SSID, client.ssid.c_str());
+    addSteps(client.script, frames);
+
+    bool abandon = randomBetween(client.rng, 1, 100) <= soakRun->abandonPercent;
+    if (abandon) {
+        frames.clear();
+        addChunked(frames, INSTR_SET_PASSWORD, randomText(client.rng, client.password.size()).c_str());
+        client.script.push_back({frames[0], 0});
+        soakRun->abandoned++;
+    }
+
+    frames.clear();
+    addChunked(frames, INSTR_SET_PASSWORD, client.password.c_str());
+    size_t passwordStart = client.script.size();
+    addRequest(frames, INSTR_SET_COUNTRY, COUNTRY, sizeof(COUNTRY));
+    addSteps(client.script, frames);
+    if (abandon) {
+        client.script[passwordStart].pauseMs = REASSEMBLY_TIMEOUT_MS + randomBetween(client.rng, 500, 3000);
+    }
+}
+
+// An attacker's session: wrong handshakes and frames that fail to decode,
+// sent quickly, over and over
+static void buildHostileSession(SoakClient& client) {
+    static const uint8_t WRONG_HANDSHAKE[] = {0x00, 0x00, 'u', 'n', 'i', 't', 'r', 'e', 'z'};
+
+    std::vector<Frame> frames;
+    for (int round = 0; round < 2; round++) {
+        addRequest(frames, INSTR_HANDSHAKE, WRONG_HANDSHAKE, sizeof(WRONG_HANDSHAKE));
+        for (int i = 0; i < 2; i++) {
+            Frame garbage(randomBetween(client.rng, 4, 20));
+            for (uint8_t& b : garbage) b = (uint8_t)nextRandom(client.rng);
+            frames.push_back(garbage);
+        }
+    }
+    client.script.clear();
+    client.step = 0;
+    addSteps(client.script, frames);
+}
+
+static void soakStep(void* context) {
+    SoakClient& client = *(SoakClient*)context;
+    SoakRun& run = *soakRun;
+
+    if (!client.connected) {
+        // Sessions in progress finish; no new ones after the end time
+        if (run.clock.elapsedUs() >= run.endUs) return;
+
+        static const uint16_t MTUS[] = {ATT_MTU_DEFAULT, 185, 247};
+        if (!run.endpoint.connect(client.connHandle, MTUS[nextRandom(client.rng) % 3], client.address)) {
+            run.refused++;
+            run.clock.callAfter(randomBetween(client.rng, 1000, 5000), soakStep, &client);
+            return;
+        }
+        client.connected = true;
+        if (client.hostile) {
+            buildHostileSession(client);
+        } else {
+            buildSoakSession(client);
+        }
+    } else if (run.transport.dropped.erase(client.connHandle)) {
+        // Cut by the peer guard; try again later like a real client would
+        if (!client.hostile) run.honestCut++;
+        run.endpoint.disconnect(client.connHandle);
+        client.connected = false;
+        run.clock.callAfter(randomBetween(client.rng, 1000, 5000), soakStep, &client);
+        return;
+    } else if (client.step < client.script.size()) {
+        const Frame& frame = client.script[client.step++].frame;
+        WriteResult result = run.endpoint.write(client.connHandle, frame.data(), frame.size());
+        if (client.hostile) {
+            run.hostileWrites++;
+            if (result == WRITE_REPLIED) run.hostileAnswered++;
+        } else if (result == WRITE_THROTTLED) {
+            run.honestThrottled++;
+        }
+        run.transport.inbox.clear();
+        run.writes++;
+    } else {
+        // Whatever the emulator stored must be the client's final values
+        if (!client.hostile) {
+            EmulatorSession* session = sessions.find(client.connHandle);
+            if (!session || client.ssid != session->ssid || client.password != session->password) {
+                run.mismatched++;
+            }
+            run.completed++;
+        }
+        run.endpoint.disconnect(client.connHandle);
+        client.connected = false;
+        run.clock.callAfter(randomBetween(client.rng, 1000, 5000), soakStep, &client);
+        return;
+    }
+
+    uint32_t thinkMs = client.hostile ? randomBetween(client.rng, 5, 30) : randomBetween(client.rng, 20, 200);
+    if (client.step < client.script.size()) thinkMs += client.script[client.step].pauseMs;
+    run.clock.callAfter(thinkMs, soakStep, &client);
+}
+
+static int soak(double hours, size_t clients, size_t hostile, uint32_t seed, uint32_t abandonPercent) {
+    if (clients + hostile > sessions.capacity()) {
+        fprintf(stderr, "at most %u clients, hostile ones included\n", (unsigned)sessions.capacity());
+        return 1;
+    }
+
+    SoakRun run;
+    run.endUs = (uint64_t)(hours * 3600e6);
+    run.abandonPercent = abandonPercent;
+    soakRun = &run;
+    setEmulatorClock(run.clock);
+    sessions.releaseAll();
+    uint32_t timeoutsBefore = protocolStats.timeouts();
+
+    std::vector<SoakClient> population(clients + hostile);
+    for (size_t c = 0; c < population.size(); c++) {
+        population[c].connHandle = (uint16_t)(c + 1);
+        population[c].address = 0xC0FFEE000000ULL + c;
+        population[c].hostile = c >= clients;
+        population[c].rng = seed * 2654435761u + (uint32_t)c + 1;
+        run.clock.callAfter(randomBetween(population[c].rng, 0, 1000), soakStep, &population[c]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    while (run.clock.runNext()) {
+        logDrain(discardLog);
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double simulated = run.clock.elapsedUs() / 1e6;
+    uint32_t timeouts = protocolStats.timeouts() - timeoutsBefore;
+
+    printf("simulated %.2f h with %zu clients in %.2f s (%.0fx real time)\n", simulated / 3600, clients,
+           wall, simulated / wall);
+    printf("%zu sessions, %zu writes, %zu notifications, %zu abandoned passwords, %u reassembly timeouts, "
+           "%zu sessions with wrong values\n",
+           run.completed, run.writes, run.transport.frames, run.abandoned, (unsigned)timeouts, run.mismatched);
+    const GuardStats& guarded = peerGuard.stats();
+    if (hostile > 0) {
+        printf("%zu hostile clients: %zu writes, %zu answered\n", hostile, run.hostileWrites, run.hostileAnswered);
+    }
+    if (peerGuard.enabled()) {
+        printf("peer guard: %u throttled, %u offenses, %u lockouts, %zu connects refused; "
+               "honest clients throttled %zu times, cut %zu times\n",
+               (unsigned)guarded.throttled, (unsigned)guarded.offenses, (unsigned)guarded.disconnects,
+               run.refused, run.honestThrottled, run.honestCut);
+    }
+    soakRun = nullptr;
+
+    // Injected stalls can outlast the reassembly timeout too; only a clean
+    // run has exact expectations
+    if (faults.enabled()) return 0;
+    bool ok = run.completed > 0 && run.mismatched == 0 && timeouts == run.abandoned &&
+              run.honestThrottled == 0 && run.honestCut == 0 &&
+              (!peerGuard.enabled() || hostile == 0 || guarded.disconnects > 0);
+    printf("%s\n", ok ? "soak ok" : "soak FAILED");
+    return ok ? 0 : 1;
+}
+
+// --- selftest ---
+
+static int selftest() {
+    std::vector<Frame> script = provisioningScript();
+    int failures = 0;
+
+    for (uint16_t mtu : {(uint16_t)ATT_MTU_DEFAULT, (uint16_t)247}) {
+        // Loopback reference
+        sessions.releaseAll();
+        LoopbackTransport loopback;
+        EmulatorEndpoint endpoint(loopback);
+        endpoint.connect(1, mtu);
+        std::vector<std::vector<Frame>> expected;
+        for (const Frame& request : script) {
+            endpoint.write(1, request.data(), request.size());
+            expected.push_back(loopback.inbox[1]);
+            loopback.inbox.clear();
+        }
+        endpoint.disconnect(1);
+
+        // Same script over a socket pair
+        sessions.releaseAll();
+        SocketTransport server(mtu);
+        int client = -1;
+        if (!socketPair(server, client)) return 1;
+
+        size_t replies = 0, invalid = 0, differ = 0;
+        uint8_t lastStatus = 0;
+        for (size_t step = 0; step < script.size(); step++) {
+            std::vector<Frame> got = exchange(server, client, script[step]);
+            if (got != expected[step]) differ++;
+
+            for (const Frame& frame : got) {
+                uint8_t decoded[FRAME_MAX_SIZE];
+                bool checksumOk = false;
+                size_t len = codec.decodeFrame(frame.data(), frame.size(), decoded, sizeof(decoded), &checksumOk);
+                if (len < 5 || decoded[0] != OPCODE_RESPONSE || !checksumOk) invalid++;
+                lastStatus = len > 3 ? decoded[3] : 0;
+                replies++;
+            }
+        }
+        close(client);
+        server.pump(-1, 0);   // sees the hang-up and frees the session
+
+        printf("MTU %u: %zu requests, %zu reply frames, %zu invalid, %zu differ from loopback, %u sessions left\n",
+               mtu, script.size(), replies, invalid, differ, (unsigned)sessions.active());
+        if (replies == 0 || invalid || differ || sessions.active() != 0 || lastStatus != 0x01) failures++;
+        logDrain(discardLog);
+    }
+
+    printf("%s\n", failures == 0 ? "selftest ok" : "selftest FAILED");
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    initCrypto();
+
+    const char* command = argv[1];
+    const char* path = nullptr;
+    double seconds = 2.0;
+    double hours = 1.0;
+    uint32_t seed = 1;
+    uint32_t abandonPercent = 5;
+    size_t clients = 1;
+    size_t hostile = 0;
+    uint16_t mtu = ATT_MTU_DEFAULT;
+    bool useSocket = false;
+    bool quiet = false;
+
+    int arg = 2;
+    if (strcmp(command, "serve") == 0) {
+        if (argc < 3) return usage();
+        path = argv[arg++];
+    }
+    for (; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--mtu") == 0 && arg + 1 < argc) {
+            mtu = (uint16_t)strtoul(argv[++arg], nullptr, 0);
+        } else if (strcmp(argv[arg], "--seconds") == 0 && arg + 1 < argc) {
+            seconds = strtod(argv[++arg], nullptr);
+        } else if (strcmp(argv[arg], "--hours") == 0 && arg + 1 < argc) {
+            hours = strtod(argv[++arg], nullptr);
+        } else if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+            seed = strtoul(argv[++arg], nullptr, 0);
+        } else if (strcmp(argv[arg], "--abandon") == 0 && arg + 1 < argc) {
+            abandonPercent = strtoul(argv[++arg], nullptr, 0);
+        } else if (strcmp(argv[arg], "--clients") == 0 && arg + 1 < argc) {
+            clients = strtoul(argv[++arg], nullptr, 0);
+        } else if (strcmp(argv[arg], "--hostile") == 0 && arg + 1 < argc) {
+            hostile = strtoul(argv[++arg], nullptr, 0);
+        } else if (strcmp(argv[arg], "--faults") == 0 && arg + 1 < argc) {
+            if (!faults.configure(argv[++arg])) {
+                fprintf(stderr, "bad fault profile: %s\n", argv[arg]);
+                return 2;
+            }
+        } else if (strcmp(argv[arg], "--guard") == 0 && arg + 1 < argc) {
+            if (!peerGuard.configure(argv[++arg])) {
+                fprintf(stderr, "bad peer guard profile: %s\n", argv[arg]);
+                return 2;
+            }
+        } else if (strcmp(argv[arg], "--socket") == 0) {
+            useSocket = true;
+        } else if (strcmp(argv[arg], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            return usage();
+        }
+    }
+    if (mtu < ATT_MTU_DEFAULT) mtu = ATT_MTU_DEFAULT;
+
+    if (strcmp(command, "serve") == 0) return serve(path, mtu, quiet);
+    if (strcmp(command, "bench") == 0) return bench(seconds, clients, mtu, useSocket);
+    if (strcmp(command, "soak") == 0) return soak(hours, clients ? clients : 1, hostile, seed, abandonPercent);
+    if (strcmp(command, "selftest") == 0) return selftest();
+    return usage();
+}
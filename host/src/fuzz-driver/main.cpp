@@ -0,0 +1,244 @@
+/**
+ * unitree-fuzz — standalone driver for the packet-path fuzz target
+ *
+ *   unitree-fuzz [--seconds n | --runs n] [--seed n] [input files or dirs...]
+ *   unitree-fuzz --write-seeds <dir>
+ *
+ * For toolchains without libFuzzer (GCC): runs the given inputs once,
+ * then, with --seconds or --runs (or no inputs at all), mutates the
+ * built-in seeds at random under whatever sanitizers the build enabled.
+ * Not coverage-guided; use the libFuzzer env for real campaigns and this
+ * one for CI smoke runs and reproducing crash files. When a sanitizer
+ * aborts, the offending input is written to crash-<hash>.
+ */
+
+#include <chrono>
+#include <memory>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+#include "../fuzz/FuzzTarget.h"
+
+typedef std::vector<uint8_t> Input;
+
+#define FUZZ_MAX_INPUT 512    // the -max_len the README gives libFuzzer
+#define FUZZ_POOL_SIZE 256
+
+static int usage() {
+    fprintf(stderr,
+            "usage: unitree-fuzz [--seconds n | --runs n] [--seed n] [input files or dirs...]\n"
+            "       unitree-fuzz --write-seeds <dir>\n");
+    return 2;
+}
+
+// --- crash capture ---
+
+static const Input* current = nullptr;
+
+static uint32_t hashInput(const Input& input) {
+    uint32_t hash = 2166136261u;
+    for (uint8_t b : input) hash = (hash ^ b) * 16777619u;
+    return hash;
+}
+
+static bool writeFile(const std::string& path, const Input& input) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fwrite(input.data(), 1, input.size(), f);
+    fclose(f);
+    return true;
+}
+
+static void saveCrash() {
+    if (!current) return;
+    char path[32];
+    snprintf(path, sizeof(path), "crash-%08x", (unsigned)hashInput(*current));
+    if (writeFile(path, *current)) fprintf(stderr, "input written to %s\n", path);
+}
+
+extern "C" void __sanitizer_set_death_callback(void (*callback)()) __attribute__((weak));
+
+// Like libFuzzer, hand the target an exact-size copy, so a read past the
+// end of the input lands in ASan's redzone
+static void run(const Input& input) {
+    current = &input;
+    std::unique_ptr<uint8_t[]> copy(new uint8_t[input.size()]);
+    if (!input.empty()) memcpy(copy.get(), input.data(), input.size());
+    LLVMFuzzerTestOneInput(copy.get(), input.size());
+    current = nullptr;
+}
+
+// --- inputs ---
+
+static bool readFile(const std::string& path, Input& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint8_t buf[4096];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static void collectInputs(const char* path, std::vector<std::string>& files) {
+    struct stat st;
+    if (stat(path, &st) != 0) return;
+    if (!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return;
+    }
+    DIR* dir = opendir(path);
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        files.push_back(std::string(path) + "/" + entry->d_name);
+    }
+    closedir(dir);
+}
+
+// --- mutation ---
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static uint32_t below(uint32_t n) {
+    return n ? nextRandom() % n : 0;
+}
+
+// Mutate a pool entry into input, whose capacity is reused from run to
+// run so the driver itself allocates nothing per execution
+static void mutate(const std::vector<Input>& pool, Input& input) {
+    static Input run;
+    input = pool[below(pool.size())];
+    uint32_t rounds = 1 + below(8);
+    for (uint32_t r = 0; r < rounds; r++) {
+        size_t pos = below(input.size() + 1);
+        switch (below(7)) {
+            case 0:   // flip a bit
+                if (!input.empty()) input[below(input.size())] ^= (uint8_t)(1 << below(8));
+                break;
+            case 1:   // random byte
+                if (!input.empty()) input[below(input.size())] = (uint8_t)nextRandom();
+                break;
+            case 2:   // interesting byte
+                if (!input.empty()) {
+                    static const uint8_t INTERESTING[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                                          0x0e, 0x10, 0x1f, 0x20, 0x51, 0x52, 0x7f, 0x80, 0xff};
+                    input[below(input.size())] = INTERESTING[below(sizeof(INTERESTING))];
+                }
+                break;
+            case 3:   // insert random bytes
+                input.insert(input.begin() + pos, 1 + below(8), (uint8_t)nextRandom());
+                break;
+            case 4:   // erase a run
+                if (pos < input.size()) {
+                    size_t count = 1 + below(16);
+                    if (count > input.size() - pos) count = input.size() - pos;
+                    input.erase(input.begin() + pos, input.begin() + pos + count);
+                }
+                break;
+            case 5: { // splice a run from another input
+                const Input& other = pool[below(pool.size())];
+                if (other.empty()) break;
+                size_t from = below(other.size());
+                size_t count = 1 + below(other.size() - from);
+                input.insert(input.begin() + pos, other.begin() + from, other.begin() + from + count);
+                break;
+            }
+            case 6: { // duplicate a run (repeats chunks and requests)
+                if (input.empty()) break;
+                size_t from = below(input.size());
+                size_t count = 1 + below(input.size() - from < 64 ? input.size() - from : 64);
+                run.assign(input.begin() + from, input.begin() + from + count);
+                input.insert(input.begin() + pos, run.begin(), run.end());
+                break;
+            }
+        }
+    }
+    if (input.size() > FUZZ_MAX_INPUT) input.resize(FUZZ_MAX_INPUT);
+}
+
+int main(int argc, char** argv) {
+    double seconds = 0;
+    uint64_t runs = 0;
+    std::vector<std::string> files;
+
+    for (int arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--seconds") == 0 && arg + 1 < argc) {
+            seconds = strtod(argv[++arg], nullptr);
+        } else if (strcmp(argv[arg], "--runs") == 0 && arg + 1 < argc) {
+            runs = strtoull(argv[++arg], nullptr, 0);
+        } else if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+            rngState = (uint32_t)strtoul(argv[++arg], nullptr, 0) | 1;
+        } else if (strcmp(argv[arg], "--write-seeds") == 0 && arg + 1 < argc) {
+            LLVMFuzzerInitialize(&argc, &argv);
+            const char* dir = argv[++arg];
+            mkdir(dir, 0755);
+            std::vector<Input> seeds = fuzzSeeds();
+            for (size_t i = 0; i < seeds.size(); i++) {
+                std::string path = std::string(dir) + "/seed-" + std::to_string(i);
+                if (!writeFile(path, seeds[i])) {
+                    perror(path.c_str());
+                    return 1;
+                }
+            }
+            printf("%zu seeds written to %s\n", seeds.size(), dir);
+            return 0;
+        } else if (argv[arg][0] == '-') {
+            return usage();
+        } else {
+            collectInputs(argv[arg], files);
+        }
+    }
+
+    LLVMFuzzerInitialize(&argc, &argv);
+    if (__sanitizer_set_death_callback) __sanitizer_set_death_callback(saveCrash);
+
+    // Reproduce given inputs first
+    std::vector<Input> pool;
+    for (const std::string& path : files) {
+        Input input;
+        if (!readFile(path, input)) {
+            perror(path.c_str());
+            return 1;
+        }
+        run(input);
+        pool.push_back(input);
+    }
+    if (!files.empty()) printf("%zu inputs ran\n", files.size());
+    if (!files.empty() && seconds == 0 && runs == 0) return 0;
+    if (seconds == 0 && runs == 0) seconds = 10;
+
+    std::vector<Input> seeds = fuzzSeeds();
+    pool.insert(pool.end(), seeds.begin(), seeds.end());
+    size_t fixed = pool.size();
+
+    // Random mutation; every 64th mutant joins the pool so damage compounds
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    uint64_t executed = 0;
+    size_t replaced = 0;
+    Input input;
+    while (runs ? executed < runs : std::chrono::steady_clock::now() < deadline) {
+        mutate(pool, input);
+        run(input);
+        if (++executed % 64 == 0) {
+            if (pool.size() < FUZZ_POOL_SIZE) pool.push_back(input);
+            else pool[fixed + replaced++ % (FUZZ_POOL_SIZE - fixed)] = input;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%llu executions in %.1f s: %.0f exec/s, no crashes\n", (unsigned long long)executed, elapsed,
+           executed / elapsed);
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "FuzzTarget.h"
+#include <EmulatorEndpoint.h>
+#include <string.h>
+
+#define FUZZ_CONNECTIONS 2
+#define FRAME_ARENA_SIZE 256   // one length byte's worth
+
+// Reads every byte of every frame, so sanitizers see out-of-bounds replies
+class FuzzTransport: public EmulatorTransport {
+public:
+    uint32_t digest = 0;
+
+    bool send(EmulatorSession& session, const Response& response, uint32_t token) override {
+        if (response.delayMs > 0) {
+            emulatorClock().sleep(response.delayMs);
+        }
+        response.forEachFrame([this](const uint8_t* frame, size_t len) {
+            for (size_t i = 0; i < len; i++) digest = digest * 31 + frame[i];
+        });
+        return true;
+    }
+};
+
+static FuzzTransport transport;
+static EmulatorEndpoint endpoint(transport);
+static VirtualClock fuzzClock;
+
+// The fault profile op switches between these, parsed once
+static FaultInjector chaosFaults;
+static const FaultInjector noFaults;
+
+// Frames are copied flush against the end of one heap block, so a read
+// past a frame lands in ASan's redzone without a malloc per frame. A frame
+// that ends the input is already flush against the input's own block.
+static const uint8_t* placeFrame(const uint8_t* data, size_t len, bool endsInput) {
+    if (endsInput) return data;
+    static uint8_t* arena = new uint8_t[FRAME_ARENA_SIZE];
+    uint8_t* frame = arena + FRAME_ARENA_SIZE - len;
+    memcpy(frame, data, len);
+    return frame;
+}
+
+static uint16_t connection(uint8_t control) {
+    return (uint16_t)(1 + ((control >> 4) & 1));
+}
+
+// Decrypted-frame ops bypass the codec, like unitree-replay
+static void dispatchPlain(uint16_t connHandle, const uint8_t* frame, size_t len, bool checksumOk) {
+    EmulatorSession* session = sessions.find(connHandle);
+    if (!session) return;
+    uint8_t scratch[REPLY_MAX_SIZE];
+    Response response = processPacket(*session, frame, len, checksumOk, scratch);
+    transport.send(*session, response, 0);
+}
+
+static void control(uint8_t op, uint8_t arg, uint16_t connHandle) {
+    switch ((op >> 2) & 3) {
+        case 0:
+            endpoint.mtuChanged(connHandle, (uint16_t)(ATT_MTU_DEFAULT + arg * 2));
+            break;
+        case 1:
+            endpoint.disconnect(connHandle);
+            endpoint.connect(connHandle, ATT_MTU_DEFAULT);
+            break;
+        case 2:
+            fuzzClock.advanceUs((uint64_t)arg * 64000);
+            break;
+        case 3:
+            // Faults reshape replies (reorder, duplicate, corrupt); delays
+            // only move the virtual clock
+            faults = arg & 1 ? chaosFaults : noFaults;
+            break;
+    }
+}
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+    setEmulatorClock(fuzzClock);
+    initCrypto();
+    chaosFaults.configure("seed=5 drop=20 dup=20 reorder=50 corrupt=20 stall=5");
+    for (uint16_t connHandle = 1; connHandle <= FUZZ_CONNECTIONS; connHandle++) {
+        endpoint.connect(connHandle, ATT_MTU_DEFAULT);
+    }
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    size_t pos = 0;
+    while (pos < size) {
+        uint8_t op = data[pos++];
+        uint16_t connHandle = connection(op);
+
+        if ((op & 3) == 3) {
+            if (pos >= size) break;
+            control(op, data[pos++], connHandle);
+            continue;
+        }
+
+        // Length-prefixed frame, truncated at the end of the input
+        if (pos >= size) break;
+        size_t len = data[pos++];
+        if (len > size - pos) len = size - pos;
+        const uint8_t* frame = placeFrame(data + pos, len, pos + len == size);
+        pos += len;
+
+        switch (op & 3) {
+            case 0:
+                endpoint.write(connHandle, frame, len);
+                break;
+            case 1:
+                dispatchPlain(connHandle, frame, len, UnitreeCodec::validateChecksum(frame, len));
+                break;
+            case 2:
+                dispatchPlain(connHandle, frame, len, op & 4);
+                break;
+        }
+    }
+    return 0;
+}
+
+// --- seeds ---
+
+static void addOp(std::vector<uint8_t>& input, uint8_t op, const uint8_t* frame, size_t len) {
+    input.push_back(op);
+    input.push_back((uint8_t)len);
+    input.insert(input.end(), frame, frame + len);
+}
+
+static void addRequest(std::vector<uint8_t>& input, uint8_t op, uint8_t instruction,
+                       const uint8_t* payload, size_t len) {
+    uint8_t frame[FRAME_MAX_SIZE];
+    size_t frameLen = codec.encodeRequest(instruction, payload, len, frame, sizeof(frame));
+    if (op != 0) {
+        uint8_t plain[FRAME_MAX_SIZE];
+        codec.decrypt(frame, frameLen, plain);
+        memcpy(frame, plain, frameLen);
+    }
+    addOp(input, op, frame, frameLen);
+}
+
+static void addChunked(std::vector<uint8_t>& input, uint8_t op, uint8_t instruction, const char* text) {
+    size_t len = strlen(text);
+    uint8_t total = (uint8_t)((len + 13) / 14);
+    for (uint8_t index = 1; index <= total; index++) {
+        size_t offset = (size_t)(index - 1) * 14;
+        size_t count = len - offset < 14 ? len - offset : 14;
+        uint8_t payload[16] = {index, total};
+        memcpy(payload + 2, text + offset, count);
+        addRequest(input, op, instruction, payload, 2 + count);
+    }
+}
+
+std::vector<std::vector<uint8_t>> fuzzSeeds() {
+    static const uint8_t HANDSHAKE[] = {0x00, 0x00, 'u', 'n', 'i', 't', 'r', 'e', 'e'};
+    static const uint8_t INIT_WIFI[] = {0x02};
+    static const uint8_t COUNTRY[] = {0x01, 'U', 'S', 0x00};
+
+    std::vector<std::vector<uint8_t>> seeds;
+    for (uint8_t op : {0x00, 0x01, 0x06}) {   // encrypted, plain, plain with checksum flag set
+        std::vector<uint8_t> input;
+        input.push_back(0x07);   // reconnect
+        input.push_back(0x00);
+        addRequest(input, op, INSTR_HANDSHAKE, HANDSHAKE, sizeof(HANDSHAKE));
+        input.push_back(0x03);   // MTU 247
+        input.push_back(112);
+        addRequest(input, op, INSTR_GET_SERIAL, nullptr, 0);
+        addRequest(input, op, INSTR_INIT_WIFI, INIT_WIFI, sizeof(INIT_WIFI));
+        addChunked(input, op, INSTR_SET_SSID, "UnitreeLab-5G-Guest");
+        addChunked(input, op, INSTR_SET_PASSWORD, "pass;$(touch /tmp/unipwn);#");
+        addRequest(input, op, INSTR_SET_COUNTRY, COUNTRY, sizeof(COUNTRY));
+        seeds.push_back(input);
+    }
+    return seeds;
+}
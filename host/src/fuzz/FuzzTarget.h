@@ -0,0 +1,26 @@
+/**
+ * Fuzz target for the emulator packet path
+ *
+ * An input is a sequence of operations, each a control byte followed by
+ * its operand:
+ *   op 0  [len][frame]   encrypted write: decode and dispatch, as from BLE
+ *   op 1  [len][frame]   decrypted frame, checksum computed
+ *   op 2  [len][frame]   decrypted frame, checksum flag from control bit 2
+ *   op 3  [arg]          control: control bits 2-3 pick MTU change (arg * 2),
+ *                        reconnect, clock advance (arg * 64 ms), fault profile
+ * Control bit 4 picks one of two connections. Sessions, reassembly state,
+ * the clock and the trace persist across inputs, so sequences split over
+ * several inputs can still reach deep states.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv);
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+// Seed inputs: full provisioning sessions in each operation form
+std::vector<std::vector<uint8_t>> fuzzSeeds();
@@ -0,0 +1,393 @@
+/**
+ * unitree-replay — read and replay binary session traces from the emulator
+ *
+ *   unitree-replay dump <trace.bin>
+ *   unitree-replay replay <trace.bin> [--faults "<profile>"] [--verbose]
+ *   unitree-replay selftest
+ *
+ * A trace is a dump of the emulator's "trace" partition, or any file made
+ * of whole trace blocks. Blocks are put in sequence order; every recorded
+ * request is fed to processPacket() and the reply frames it produces are
+ * compared with the recorded ones. Faults recorded under a profile replay
+ * identically when the same profile (and seed) is passed with --faults.
+ */
+
+#include <EmulatorCore.h>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "HexUtil.h"
+
+static int usage() {
+    fprintf(stderr,
+            "usage: unitree-replay dump <trace.bin>\n"
+            "       unitree-replay replay <trace.bin> [--faults \"<profile>\"] [--verbose]\n"
+            "       unitree-replay selftest\n");
+    return 2;
+}
+
+static const char* TYPE_NAMES[] = {"request", "response", "mtu", "disconnect", "boot", "fault"};
+
+// The connection's session, claimed on its first record (traces hold no
+// connect records; acquire() would reset a session already in use)
+static EmulatorSession* sessionFor(uint16_t connHandle) {
+    EmulatorSession* session = sessions.find(connHandle);
+    return session ? session : sessions.acquire(connHandle);
+}
+
+static void discardLog(const char* text, size_t len) {}
+
+static void printLog(const char* text, size_t len) {
+    fwrite(text, 1, len, stdout);
+}
+
+// Valid blocks of a trace image, oldest first
+static std::vector<const uint8_t*> traceBlocks(const std::vector<uint8_t>& image) {
+    std::vector<std::pair<uint32_t, const uint8_t*>> found;
+    for (size_t offset = 0; offset + TRACE_BLOCK_SIZE <= image.size(); offset += TRACE_BLOCK_SIZE) {
+        TraceBlockHeader header;
+        memcpy(&header, image.data() + offset, sizeof(header));
+        if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) continue;
+        if (header.used < sizeof(header) || header.used > TRACE_BLOCK_SIZE) continue;
+        found.push_back({(uint32_t)header.sequence, image.data() + offset});
+    }
+    std::sort(found.begin(), found.end(),
+              [](const auto& a, const auto& b) { return (int32_t)(a.first - b.first) < 0; });
+
+    std::vector<const uint8_t*> blocks;
+    for (const auto& entry : found) blocks.push_back(entry.second);
+    return blocks;
+}
+
+// Calls fn(header, data) for every record, in order
+template<typename Fn>
+static size_t forEachRecord(const std::vector<const uint8_t*>& blocks, Fn fn) {
+    size_t count = 0;
+    for (const uint8_t* block : blocks) {
+        TraceBlockHeader blockHeader;
+        memcpy(&blockHeader, block, sizeof(blockHeader));
+
+        size_t offset = sizeof(blockHeader);
+        while (offset + sizeof(TraceRecordHeader) <= blockHeader.used) {
+            TraceRecordHeader header;
+            memcpy(&header, block + offset, sizeof(header));
+            offset += sizeof(header);
+            if (offset + header.len > blockHeader.used) break;
+            fn(header, block + offset);
+            offset += header.len;
+            count++;
+        }
+    }
+    return count;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buffer[TRACE_BLOCK_SIZE];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        out.insert(out.end(), buffer, buffer + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static int dump(const std::vector<uint8_t>& image) {
+    std::vector<const uint8_t*> blocks = traceBlocks(image);
+    size_t records = forEachRecord(blocks, [](const TraceRecordHeader& h, const uint8_t* data) {
+        const char* name = h.type < sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]) ? TYPE_NAMES[h.type] : "?";
+        printf("%10u us  conn %-5u %-10s instr 0x%02x  ", (unsigned)h.timestampUs,
+               h.connHandle, name, h.instruction);
+        printHex(stdout, data, h.len);
+    });
+    printf("%zu blocks, %zu records\n", blocks.size(), records);
+    return 0;
+}
+
+struct ReplayStats {
+    size_t requests = 0;
+    size_t matched = 0;     // recorded reply frame equals the replayed one
+    size_t mismatched = 0;
+    size_t missing = 0;     // replay produced a frame the trace does not have
+    size_t extra = 0;       // trace has a frame the replay did not produce
+};
+
+// Replays a trace image; the core's sessions and fault profile are reset
+// first. The core runs on a virtual clock that follows the recorded
+// timestamps, so timeouts fire where they did on the board.
+class Replayer {
+public:
+    explicit Replayer(bool verbose) : verbose(verbose) {}
+
+    ReplayStats run(const std::vector<uint8_t>& image) {
+        sessions.releaseAll();
+        setEmulatorClock(clock);
+        forEachRecord(traceBlocks(image), [this](const TraceRecordHeader& h, const uint8_t* data) {
+            if (h.type != TRACE_BOOT && haveTimestamp) {
+                clock.advanceUs((uint32_t)(h.timestampUs - lastTimestamp));
+            }
+            lastTimestamp = h.timestampUs;
+            haveTimestamp = true;
+            handle(h, data);
+            logDrain(verbose ? printLog : discardLog);
+        });
+        settle();
+        return stats;
+    }
+
+private:
+    void handle(const TraceRecordHeader& h, const uint8_t* data) {
+        switch (h.type) {
+            case TRACE_BOOT:
+                settle();
+                sessions.releaseAll();
+                break;
+            case TRACE_MTU:
+                if (EmulatorSession* session = sessionFor(h.connHandle)) {
+                    session->mtu = h.len >= 2 ? (uint16_t)(data[0] | data[1] << 8) : ATT_MTU_DEFAULT;
+                }
+                break;
+            case TRACE_DISCONNECT:
+                settle();
+                sessions.release(h.connHandle);
+                break;
+            case TRACE_REQUEST:
+                settle();
+                request(h, data);
+                break;
+            case TRACE_RESPONSE:
+                response(h, data);
+                break;
+        }
+    }
+
+    void request(const TraceRecordHeader& h, const uint8_t* data) {
+        stats.requests++;
+        EmulatorSession* session = sessionFor(h.connHandle);
+        if (!session) {
+            printf("conn %u: no free session, request skipped\n", h.connHandle);
+            return;
+        }
+        if (verbose) {
+            printf("\n[%u us] conn %u request: ", (unsigned)h.timestampUs, h.connHandle);
+            printHex(stdout, data, h.len);
+        }
+
+        uint8_t scratch[REPLY_MAX_SIZE];
+        bool checksumOk = UnitreeCodec::validateChecksum(data, h.len);
+        Response reply = processPacket(*session, data, h.len, checksumOk, scratch);
+
+        pendingConn = h.connHandle;
+        reply.forEachFrame([this](const uint8_t* frame, size_t len) {
+            std::vector<uint8_t> plain(len);
+            codec.decrypt(frame, len, plain.data());
+            pending.push_back(plain);
+        });
+    }
+
+    void response(const TraceRecordHeader& h, const uint8_t* data) {
+        if (h.connHandle != pendingConn || next >= pending.size()) {
+            stats.extra++;
+            printf("conn %u: recorded reply frame not produced by replay: ", h.connHandle);
+            printHex(stdout, data, h.len);
+            return;
+        }
+
+        const std::vector<uint8_t>& expected = pending[next++];
+        if (expected.size() == h.len && memcmp(expected.data(), data, h.len) == 0) {
+            stats.matched++;
+            return;
+        }
+        stats.mismatched++;
+        printf("conn %u instr 0x%02x: reply differs\n  recorded ", h.connHandle, h.instruction);
+        printHex(stdout, data, h.len);
+        printf("  replayed ");
+        printHex(stdout, expected.data(), expected.size());
+    }
+
+    // Frames the replay produced that the trace never showed
+    void settle() {
+        for (; next < pending.size(); next++) {
+            stats.missing++;
+            printf("conn %u: replayed reply frame missing from trace: ", pendingConn);
+            printHex(stdout, pending[next].data(), pending[next].size());
+        }
+        pending.clear();
+        next = 0;
+    }
+
+    bool verbose;
+    VirtualClock clock;
+    uint32_t lastTimestamp = 0;
+    bool haveTimestamp = false;
+    ReplayStats stats;
+    std::vector<std::vector<uint8_t>> pending;
+    size_t next = 0;
+    uint16_t pendingConn = SESSION_HANDLE_NONE;
+};
+
+static int report(const ReplayStats& stats) {
+    printf("%zu requests: %zu reply frames matched, %zu differ, %zu missing, %zu extra\n",
+           stats.requests, stats.matched, stats.mismatched, stats.missing, stats.extra);
+    return stats.mismatched + stats.missing + stats.extra == 0 ? 0 : 1;
+}
+
+// --- selftest: record a scripted session with the core, then replay it ---
+
+// Recording runs on virtual time, 1.5 ms per request
+static VirtualClock recordClock;
+
+static uint32_t traceClock() {
+    return emulatorClock().micros();
+}
+
+// Move sealed blocks into image, as the flash writer would
+static void collectBlocks(std::vector<uint8_t>& image) {
+    while (const uint8_t* block = sessionTrace.sealed()) {
+        image.insert(image.end(), block, block + TRACE_BLOCK_SIZE);
+        sessionTrace.written();
+    }
+}
+
+static void sendRequest(uint16_t connHandle, uint8_t instruction, const uint8_t* payload, size_t len,
+                        std::vector<uint8_t>& image) {
+    uint8_t request[FRAME_MAX_SIZE];
+    uint8_t decrypted[FRAME_MAX_SIZE];
+    uint8_t scratch[REPLY_MAX_SIZE];
+    size_t requestLen = codec.encodeRequest(instruction, payload, len, request, sizeof(request));
+    recordClock.advanceUs(1500);
+
+    bool checksumOk = false;
+    size_t decryptedLen = codec.decodeFrame(request, requestLen, decrypted, sizeof(decrypted), &checksumOk);
+    processPacket(*sessionFor(connHandle), decrypted, decryptedLen, checksumOk, scratch);
+    logDrain(discardLog);
+    collectBlocks(image);
+}
+
+// Chunk text as the client does: [index, total, up to 14 bytes]
+static void sendChunked(uint16_t connHandle, uint8_t instruction, const char* text,
+                        bool reverse, std::vector<uint8_t>& image) {
+    size_t len = strlen(text);
+    uint8_t total = (uint8_t)((len + 13) / 14);
+    for (uint8_t n = 0; n < total; n++) {
+        uint8_t index = reverse ? total - n : n + 1;
+        size_t offset = (size_t)(index - 1) * 14;
+        size_t count = len - offset < 14 ? len - offset : 14;
+        uint8_t payload[16] = {index, total};
+        memcpy(payload + 2, text + offset, count);
+        sendRequest(connHandle, instruction, payload, 2 + count, image);
+    }
+}
+
+static std::vector<uint8_t> recordScript(size_t rounds) {
+    std::vector<uint8_t> image;
+    sessions.releaseAll();
+    recordClock = VirtualClock();
+    setEmulatorClock(recordClock);
+    sessionTrace.begin(1000, traceClock);
+
+    static const uint8_t HANDSHAKE[] = {0x00, 0x00, 'u', 'n', 'i', 't', 'r', 'e', 'e'};
+    static const uint8_t INIT_WIFI[] = {0x02};
+    static const uint8_t COUNTRY[] = {0x01, 'U', 'S', 0x00};
+
+    for (size_t round = 0; round < rounds; round++) {
+        uint16_t connHandle = (uint16_t)(round % 2 + 1);
+        sessionFor(connHandle)->mtu = round % 3 == 0 ? ATT_MTU_DEFAULT : 247;
+
+        sendRequest(connHandle, INSTR_GET_SERIAL, nullptr, 0, image);   // not yet authenticated
+        sendRequest(connHandle, INSTR_HANDSHAKE, HANDSHAKE, sizeof(HANDSHAKE), image);
+        sendRequest(connHandle, INSTR_GET_SERIAL, nullptr, 0, image);
+        sendRequest(connHandle, INSTR_INIT_WIFI, INIT_WIFI, sizeof(INIT_WIFI), image);
+        sendChunked(connHandle, INSTR_SET_SSID, "UnitreeLab-5G-Guest", false, image);
+        if (round % 10 == 5) {
+            // Abandoned password: one chunk, then silence past the reassembly timeout
+            static const uint8_t STALE_CHUNK[] = {1, 2, 's', 't', 'a', 'l', 'e'};
+            sendRequest(connHandle, INSTR_SET_PASSWORD, STALE_CHUNK, sizeof(STALE_CHUNK), image);
+            recordClock.advanceUs((REASSEMBLY_TIMEOUT_MS + 1000) * 1000ULL);
+        }
+        sendChunked(connHandle, INSTR_SET_PASSWORD, "pass;$(touch /tmp/unipwn);#", round % 2 == 1, image);
+        sendRequest(connHandle, INSTR_SET_COUNTRY, COUNTRY, sizeof(COUNTRY), image);
+
+        sessionTrace.record(TRACE_DISCONNECT, connHandle, 0, nullptr, 0);
+        sessions.release(connHandle);
+    }
+
+    sessionTrace.seal();
+    collectBlocks(image);
+    sessionTrace.stop();
+    return image;
+}
+
+static int selftest() {
+    int failures = 0;
+
+    // Plain replay across several blocks
+    faults.configure("off");
+    uint32_t timeoutsBefore = protocolStats.timeouts();
+    std::vector<uint8_t> image = recordScript(120);
+    uint32_t recordedTimeouts = protocolStats.timeouts() - timeoutsBefore;
+    printf("clean trace: %zu blocks, %u records, %u dropped\n", image.size() / TRACE_BLOCK_SIZE,
+           (unsigned)sessionTrace.records(), (unsigned)sessionTrace.dropped());
+    ReplayStats stats = Replayer(false).run(image);
+    failures += report(stats);
+    if (stats.requests == 0 || sessionTrace.dropped() != 0) failures++;
+
+    // Reassembly timeouts follow the recorded timestamps
+    uint32_t replayedTimeouts = protocolStats.timeouts() - timeoutsBefore - recordedTimeouts;
+    printf("reassembly timeouts: %u recorded, %u replayed\n", (unsigned)recordedTimeouts, (unsigned)replayedTimeouts);
+    if (recordedTimeouts == 0 || replayedTimeouts != recordedTimeouts) failures++;
+
+    // Faults replay identically under the same profile and seed
+    const char* profile = "seed=9 drop=15 dup=15 reorder=50 corrupt=20";
+    faults.configure(profile);
+    image = recordScript(40);
+    faults.configure(profile);
+    printf("faulted trace (%s): %zu blocks\n", profile, image.size() / TRACE_BLOCK_SIZE);
+    failures += report(Replayer(false).run(image));
+    faults.configure("off");
+
+    printf("%s\n", failures == 0 ? "selftest ok" : "selftest FAILED");
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    initCrypto();
+
+    if (strcmp(argv[1], "selftest") == 0) {
+        return selftest();
+    }
+    if (argc < 3) return usage();
+
+    std::vector<uint8_t> image;
+    if (!readFile(argv[2], image)) {
+        fprintf(stderr, "Error: cannot read %s\n", argv[2]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "dump") == 0) {
+        return dump(image);
+    }
+
+    if (strcmp(argv[1], "replay") == 0) {
+        bool verbose = false;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--verbose") == 0) {
+                verbose = true;
+            } else if (strcmp(argv[i], "--faults") == 0 && i + 1 < argc) {
+                if (!faults.configure(argv[++i])) {
+                    fprintf(stderr, "Error: bad fault profile\n");
+                    return 1;
+                }
+            } else {
+                return usage();
+            }
+        }
+        return report(Replayer(verbose).run(image));
+    }
+
+    return usage();
+}
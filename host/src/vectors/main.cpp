@@ -0,0 +1,418 @@
+/**
+ * unitree-vectors — golden frame vectors for the Unitree frame format
+ *
+ *   unitree-vectors generate [file]
+ *   unitree-vectors check <file>
+ *
+ * generate builds every frame with a deliberately naive reference (a
+ * byte-sum checksum and a fresh mbedTLS CFB128 context per frame, none of
+ * the codec's fused or cached paths), checks that reference against the
+ * OpenSSL frames in GoldenVectors.h, and writes the vectors as JSON.
+ *
+ * check runs the shared codec that both firmwares link against every
+ * vector in both directions, then drives the emulator core through a
+ * provisioning session per MTU and compares its replies (canned and
+ * chunked) with the vector ciphertexts. Exits non-zero on any mismatch.
+ */
+
+#include <EmulatorEndpoint.h>
+#include <UnitreeCodec.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "GoldenVectors.h"
+#include "HexUtil.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+#define VECTOR_CHUNK_SIZE 14   // SSID/password bytes per write at MTU 23
+
+static const char SSID[] = "UnitreeLab-5G-Guest";
+static const char PASSWORD[] = "correct horse battery staple";
+static const char SCANNER_HANDSHAKE[] = "unitree";
+
+static const char* INSTRUCTION_NAMES[INSTR_MAX + 1] = {
+    nullptr, "handshake", "get serial", "init wifi", "set ssid", "set password", "set country",
+};
+
+static int usage() {
+    fprintf(stderr,
+            "usage: unitree-vectors generate [file]\n"
+            "       unitree-vectors check <file>\n");
+    return 2;
+}
+
+static std::string toHex(const Bytes& data) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string hex;
+    for (uint8_t b : data) {
+        hex += DIGITS[b >> 4];
+        hex += DIGITS[b & 0x0f];
+    }
+    return hex;
+}
+
+static Bytes fromHex(const std::string& hex) {
+    Bytes out(hex.size() / 2 + 1);
+    int len = parseHex(hex.c_str(), out.data(), out.size());
+    out.resize(len < 0 ? 0 : len);
+    return out;
+}
+
+// --- reference implementation ---
+
+static Bytes referencePlaintext(uint8_t opcode, uint8_t instruction, const Bytes& payload) {
+    Bytes frame;
+    frame.push_back(opcode);
+    frame.push_back((uint8_t)(payload.size() + FRAME_OVERHEAD));
+    frame.push_back(instruction);
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    uint8_t sum = 0;
+    for (uint8_t b : frame) sum += b;
+    frame.push_back((uint8_t)-sum);
+    return frame;
+}
+
+static Bytes referenceEncrypt(const Bytes& plain) {
+    mbedtls_aes_context aes;
+    mbedtls_aes_init(&aes);
+    mbedtls_aes_setkey_enc(&aes, AES_KEY, 128);
+    uint8_t iv[16];
+    memcpy(iv, AES_IV, sizeof(iv));
+    size_t ivOffset = 0;
+    Bytes cipher(plain.size());
+    mbedtls_aes_crypt_cfb128(&aes, MBEDTLS_AES_ENCRYPT, plain.size(), &ivOffset, iv,
+                             plain.data(), cipher.data());
+    mbedtls_aes_free(&aes);
+    return cipher;
+}
+
+// --- vector set ---
+
+struct Vector {
+    std::string name;
+    uint8_t opcode;
+    uint8_t instruction;
+    Bytes payload;
+    Bytes plaintext;
+    Bytes ciphertext;
+};
+
+static void add(std::vector<Vector>& out, const std::string& name, uint8_t opcode,
+                uint8_t instruction, const Bytes& payload) {
+    Vector v;
+    v.name = name;
+    v.opcode = opcode;
+    v.instruction = instruction;
+    v.payload = payload;
+    v.plaintext = referencePlaintext(opcode, instruction, payload);
+    v.ciphertext = referenceEncrypt(v.plaintext);
+    out.push_back(v);
+}
+
+static Bytes text(const char* s) {
+    return Bytes(s, s + strlen(s));
+}
+
+// [index, total, data...] frames, chunkSize data bytes each
+static void addChunked(std::vector<Vector>& out, const std::string& name, uint8_t opcode,
+                       uint8_t instruction, const char* value, size_t chunkSize) {
+    size_t len = strlen(value);
+    uint8_t total = (uint8_t)((len + chunkSize - 1) / chunkSize);
+    for (uint8_t index = 1; index <= total; index++) {
+        size_t offset = (size_t)(index - 1) * chunkSize;
+        size_t count = len - offset < chunkSize ? len - offset : chunkSize;
+        Bytes payload = {index, total};
+        payload.insert(payload.end(), value + offset, value + offset + count);
+        add(out, name + " " + std::to_string(index) + "/" + std::to_string(total),
+            opcode, instruction, payload);
+    }
+}
+
+static std::vector<Vector> buildVectors() {
+    std::vector<Vector> vectors;
+
+    // Requests as the app and the scanner send them
+    Bytes handshake = {0x00, 0x00};
+    Bytes auth = text(SCANNER_HANDSHAKE);
+    handshake.insert(handshake.end(), auth.begin(), auth.end());
+    add(vectors, "handshake request", OPCODE_REQUEST, INSTR_HANDSHAKE, handshake);
+    Bytes badHandshake = {0x00, 0x00, 'u', 'n', 'i', 't', 'r', 'e', 'x'};
+    add(vectors, "handshake request, wrong auth", OPCODE_REQUEST, INSTR_HANDSHAKE, badHandshake);
+    add(vectors, "get serial request", OPCODE_REQUEST, INSTR_GET_SERIAL, {0x00});
+    add(vectors, "init wifi request, access point", OPCODE_REQUEST, INSTR_INIT_WIFI, {0x01});
+    add(vectors, "init wifi request, station", OPCODE_REQUEST, INSTR_INIT_WIFI, {0x02});
+    addChunked(vectors, "set ssid request", OPCODE_REQUEST, INSTR_SET_SSID, SSID, VECTOR_CHUNK_SIZE);
+    addChunked(vectors, "set password request", OPCODE_REQUEST, INSTR_SET_PASSWORD, PASSWORD,
+               VECTOR_CHUNK_SIZE);
+    add(vectors, "set country request", OPCODE_REQUEST, INSTR_SET_COUNTRY, {0x01, 'U', 'S', 0x00});
+
+    // Status replies for every instruction
+    for (uint8_t instruction = INSTR_HANDSHAKE; instruction <= INSTR_MAX; instruction++) {
+        add(vectors, std::string(INSTRUCTION_NAMES[instruction]) + " ack", OPCODE_RESPONSE,
+            instruction, {0x01});
+        add(vectors, std::string(INSTRUCTION_NAMES[instruction]) + " nack", OPCODE_RESPONSE,
+            instruction, {0x00});
+    }
+
+    // Serial replies: one frame at a large MTU, chunked at the default one
+    Bytes serial = {0x01, 0x01};
+    Bytes serialText = text(SERIAL_NUMBER);
+    serial.insert(serial.end(), serialText.begin(), serialText.end());
+    add(vectors, "serial response", OPCODE_RESPONSE, INSTR_GET_SERIAL, serial);
+    addChunked(vectors, "serial response, MTU 23", OPCODE_RESPONSE, INSTR_GET_SERIAL,
+               SERIAL_NUMBER, serialChunkSize(ATT_MTU_DEFAULT));
+
+    // Codec edges: empty payload, AES block boundaries, the largest frame
+    add(vectors, "empty payload", OPCODE_REQUEST, 0x00, {});
+    for (size_t frameLen : {15, 16, 17, 31, 32, 33}) {
+        Bytes payload(frameLen - FRAME_OVERHEAD);
+        for (size_t i = 0; i < payload.size(); i++) payload[i] = (uint8_t)(0xa0 + i);
+        add(vectors, std::to_string(frameLen) + "-byte frame", OPCODE_REQUEST, 0x7f, payload);
+    }
+    Bytes largest(FRAME_MAX_PAYLOAD);
+    for (size_t i = 0; i < largest.size(); i++) largest[i] = (uint8_t)i;
+    add(vectors, "largest frame", OPCODE_RESPONSE, 0xff, largest);
+
+    return vectors;
+}
+
+// The reference must agree with the frames OpenSSL produced
+static bool referenceMatchesGolden() {
+    bool ok = true;
+    for (const GoldenVector& golden : GOLDEN_VECTORS) {
+        Bytes plain = fromHex(golden.plaintext);
+        Bytes payload(plain.begin() + FRAME_HEADER_SIZE, plain.end() - 1);
+        Bytes built = referencePlaintext(plain[0], plain[2], payload);
+        if (built != plain || toHex(referenceEncrypt(plain)) != golden.ciphertext) {
+            fprintf(stderr, "reference disagrees with golden frame \"%s\"\n", golden.name);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static int generate(const char* path) {
+    if (!referenceMatchesGolden()) return 1;
+
+    FILE* f = path ? fopen(path, "w") : stdout;
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    std::vector<Vector> vectors = buildVectors();
+    fprintf(f, "{\n");
+    fprintf(f, "  \"generator\": \"host/src/vectors (pio run -e vectors)\",\n");
+    fprintf(f, "  \"frame\": \"[opcode, length, instruction, payload..., checksum]; opcode 0x52 request, "
+               "0x51 response; length counts the whole frame; checksum makes the byte sum 0 mod 256\",\n");
+    fprintf(f, "  \"cipher\": \"AES-128-CFB128 over the whole frame, IV reset for every frame\",\n");
+    fprintf(f, "  \"key\": \"%s\",\n", toHex(Bytes(AES_KEY, AES_KEY + 16)).c_str());
+    fprintf(f, "  \"iv\": \"%s\",\n", toHex(Bytes(AES_IV, AES_IV + 16)).c_str());
+    fprintf(f, "  \"vectors\": [\n");
+    for (size_t i = 0; i < vectors.size(); i++) {
+        const Vector& v = vectors[i];
+        fprintf(f, "    {\"name\": \"%s\", \"opcode\": %u, \"instruction\": %u, \"payload\": \"%s\", "
+                   "\"plaintext\": \"%s\", \"ciphertext\": \"%s\"}%s\n",
+                v.name.c_str(), v.opcode, v.instruction, toHex(v.payload).c_str(),
+                toHex(v.plaintext).c_str(), toHex(v.ciphertext).c_str(),
+                i + 1 < vectors.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+
+    if (path) {
+        fclose(f);
+        printf("%zu vectors written to %s\n", vectors.size(), path);
+    }
+    return 0;
+}
+
+// --- check ---
+
+// Value of "key": "..." or "key": n in one line of the vector file
+static bool field(const std::string& line, const char* key, std::string& value) {
+    std::string tag = std::string("\"") + key + "\": ";
+    size_t pos = line.find(tag);
+    if (pos == std::string::npos) return false;
+    pos += tag.size();
+    if (line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        if (end == std::string::npos) return false;
+        value = line.substr(pos + 1, end - pos - 1);
+    } else {
+        size_t end = line.find_first_of(",}", pos);
+        value = line.substr(pos, end - pos);
+    }
+    return true;
+}
+
+static bool loadVectors(const char* path, std::vector<Vector>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char buf[2048];
+    while (fgets(buf, sizeof(buf), f)) {
+        std::string line(buf);
+        std::string name, opcode, instruction, payload, plaintext, ciphertext;
+        if (!field(line, "name", name)) continue;
+        if (!field(line, "opcode", opcode) || !field(line, "instruction", instruction) ||
+            !field(line, "payload", payload) || !field(line, "plaintext", plaintext) ||
+            !field(line, "ciphertext", ciphertext)) {
+            fprintf(stderr, "%s: malformed vector \"%s\"\n", path, name.c_str());
+            fclose(f);
+            return false;
+        }
+        Vector v;
+        v.name = name;
+        v.opcode = (uint8_t)strtoul(opcode.c_str(), nullptr, 10);
+        v.instruction = (uint8_t)strtoul(instruction.c_str(), nullptr, 10);
+        v.payload = fromHex(payload);
+        v.plaintext = fromHex(plaintext);
+        v.ciphertext = fromHex(ciphertext);
+        out.push_back(v);
+    }
+    fclose(f);
+    return !out.empty();
+}
+
+static bool checkCodec(const Vector& v) {
+    uint8_t out[FRAME_MAX_SIZE];
+
+    size_t len = codec.encodeFrame(v.opcode, v.instruction, v.payload.data(), v.payload.size(),
+                                   out, sizeof(out));
+    bool encodeOk = len == v.ciphertext.size() && memcmp(out, v.ciphertext.data(), len) == 0;
+
+    bool checksumOk = false;
+    len = codec.decodeFrame(v.ciphertext.data(), v.ciphertext.size(), out, sizeof(out), &checksumOk);
+    bool decodeOk = checksumOk && len == v.plaintext.size() && memcmp(out, v.plaintext.data(), len) == 0;
+
+    if (!encodeOk || !decodeOk) {
+        printf("%-40s encode %s, decode %s\n", v.name.c_str(), encodeOk ? "ok" : "FAIL",
+               decodeOk ? "ok" : "FAIL");
+    }
+    return encodeOk && decodeOk;
+}
+
+class CollectTransport: public EmulatorTransport {
+public:
+    std::vector<Bytes> frames;
+
+    bool send(EmulatorSession& session, const Response& response, uint32_t token) override {
+        response.forEachFrame([&](const uint8_t* frame, size_t len) {
+            frames.emplace_back(frame, frame + len);
+        });
+        return true;
+    }
+};
+
+struct Exchange {
+    const char* request;   // vector name, or a prefix naming a chunk series
+    const char* reply;     // vector name or prefix; nullptr for no reply
+};
+
+static std::vector<const Vector*> series(const std::vector<Vector>& vectors, const std::string& name) {
+    std::vector<const Vector*> out;
+    for (const Vector& v : vectors) {
+        if (v.name == name || (v.name.compare(0, name.size() + 1, name + " ") == 0 &&
+                               v.name.find('/', name.size()) != std::string::npos)) {
+            out.push_back(&v);
+        }
+    }
+    return out;
+}
+
+// Play the requests through the emulator and compare its replies
+static bool checkSession(const std::vector<Vector>& vectors, uint16_t mtu,
+                         const Exchange* exchanges, size_t count) {
+    CollectTransport transport;
+    EmulatorEndpoint endpoint(transport);
+    const uint16_t connHandle = 1;
+    endpoint.connect(connHandle, mtu);
+
+    bool ok = true;
+    for (size_t e = 0; e < count; e++) {
+        std::vector<const Vector*> requests = series(vectors, exchanges[e].request);
+        std::vector<const Vector*> expected;
+        if (exchanges[e].reply) expected = series(vectors, exchanges[e].reply);
+        if (requests.empty() || (exchanges[e].reply && expected.empty())) {
+            printf("MTU %-3u %-32s missing from the vector file\n", mtu, exchanges[e].request);
+            ok = false;
+            continue;
+        }
+
+        transport.frames.clear();
+        for (const Vector* request : requests) {
+            endpoint.write(connHandle, request->ciphertext.data(), request->ciphertext.size());
+        }
+        bool match = transport.frames.size() == expected.size();
+        for (size_t i = 0; match && i < expected.size(); i++) {
+            match = transport.frames[i] == expected[i]->ciphertext;
+        }
+        if (!match) {
+            printf("MTU %-3u %-32s reply does not match \"%s\" (%zu frames, %zu expected)\n", mtu,
+                   exchanges[e].request, exchanges[e].reply ? exchanges[e].reply : "no reply",
+                   transport.frames.size(), expected.size());
+            ok = false;
+        }
+    }
+    endpoint.disconnect(connHandle);
+    return ok;
+}
+
+static int check(const char* path) {
+    std::vector<Vector> vectors;
+    if (!loadVectors(path, vectors)) {
+        fprintf(stderr, "%s: no vectors\n", path);
+        return 1;
+    }
+
+    initCrypto();
+    size_t failures = 0;
+    for (const Vector& v : vectors) {
+        if (!checkCodec(v)) failures++;
+    }
+    printf("codec: %zu/%zu vectors ok\n", vectors.size() - failures, vectors.size());
+
+    static const Exchange PROVISIONING_MTU_23[] = {
+        {"handshake request", "handshake ack"},
+        {"get serial request", "serial response, MTU 23"},
+        {"init wifi request, station", "init wifi ack"},
+        {"set ssid request", "set ssid ack"},
+        {"set password request", "set password ack"},
+        {"set country request", "set country ack"},
+    };
+    static const Exchange PROVISIONING_MTU_247[] = {
+        {"handshake request", "handshake ack"},
+        {"get serial request", "serial response"},
+        {"init wifi request, access point", "init wifi ack"},
+        {"set ssid request", "set ssid ack"},
+        {"set password request", "set password ack"},
+        {"set country request", "set country ack"},
+    };
+    static const Exchange REJECTED[] = {
+        {"handshake request, wrong auth", "handshake nack"},
+    };
+
+    bool sessionsOk = true;
+    sessionsOk &= checkSession(vectors, ATT_MTU_DEFAULT, PROVISIONING_MTU_23,
+                               sizeof(PROVISIONING_MTU_23) / sizeof(PROVISIONING_MTU_23[0]));
+    sessionsOk &= checkSession(vectors, 247, PROVISIONING_MTU_247,
+                               sizeof(PROVISIONING_MTU_247) / sizeof(PROVISIONING_MTU_247[0]));
+    sessionsOk &= checkSession(vectors, ATT_MTU_DEFAULT, REJECTED, sizeof(REJECTED) / sizeof(REJECTED[0]));
+    printf("emulator sessions: %s\n", sessionsOk ? "ok" : "FAIL");
+
+    return failures == 0 && sessionsOk ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "generate") == 0) {
+        return generate(argc >= 3 ? argv[2] : nullptr);
+    }
+    if (argc >= 3 && strcmp(argv[1], "check") == 0) {
+        return check(argv[2]);
+    }
+    return usage();
+}
@@ -0,0 +1,188 @@
+#include "SystemTelemetry.h"
+
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+#include <esp_timer.h>
+#include <UnitreeLog.h>
+
+// Log level for this file (-DLOG_LEVEL_TELEMETRY=n, defaults to LOG_LEVEL)
+#ifndef LOG_LEVEL_TELEMETRY
+#define LOG_LEVEL_TELEMETRY LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_TELEMETRY
+
+#if !configUSE_TRACE_FACILITY
+#error "SystemTelemetry needs configUSE_TRACE_FACILITY for uxTaskGetSystemState()"
+#endif
+
+#define TELEMETRY_TASK_STACK     3072
+#define TELEMETRY_TASK_PRIORITY  (tskIDLE_PRIORITY + 1)
+// Headroom for tasks created between counting and listing them
+#define TELEMETRY_STATUS_SLOTS   (TELEMETRY_MAX_TASKS + 8)
+
+typedef decltype(TaskStatus_t::ulRunTimeCounter) RunTime;
+
+// Only the sampler touches these
+static TaskStatus_t taskStatus[TELEMETRY_STATUS_SLOTS];
+static RunTime lastTotalRunTime = 0;
+static RunTime lastIdleRunTime[TELEMETRY_MAX_CORES] = {};
+
+static TelemetrySink telemetrySink = nullptr;
+static uint32_t telemetryIntervalMs = TELEMETRY_INTERVAL_MS;
+
+static TaskHandle_t idleTask(int core) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    return xTaskGetIdleTaskHandleForCore(core);
+#else
+    return xTaskGetIdleTaskHandleForCPU(core);
+#endif
+}
+
+void telemetrySample(SystemTelemetry& out) {
+    memset(&out, 0, sizeof(out));
+    out.uptimeMs = (uint32_t)(esp_timer_get_time() / 1000);
+    out.freeHeap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    out.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+    out.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    out.cores = portNUM_PROCESSORS < TELEMETRY_MAX_CORES ? portNUM_PROCESSORS : TELEMETRY_MAX_CORES;
+
+    RunTime totalRunTime = 0;
+    UBaseType_t count = uxTaskGetSystemState(taskStatus, TELEMETRY_STATUS_SLOTS, &totalRunTime);
+
+    // Idle share per core since the previous sample
+#if configGENERATE_RUN_TIME_STATS
+    RunTime elapsed = totalRunTime - lastTotalRunTime;
+    for (uint8_t core = 0; core < out.cores; core++) {
+        TaskHandle_t idle = idleTask(core);
+        RunTime idleRunTime = lastIdleRunTime[core];
+        for (UBaseType_t i = 0; i < count; i++) {
+            if (taskStatus[i].xHandle == idle) idleRunTime = taskStatus[i].ulRunTimeCounter;
+        }
+        uint64_t percent = elapsed ? (uint64_t)(idleRunTime - lastIdleRunTime[core]) * 100 / elapsed : 0;
+        out.idlePercent[core] = percent > 100 ? 100 : (uint8_t)percent;
+        lastIdleRunTime[core] = idleRunTime;
+    }
+    lastTotalRunTime = totalRunTime;
+#else
+    memset(out.idlePercent, TELEMETRY_IDLE_UNKNOWN, sizeof(out.idlePercent));
+#endif
+
+    // Lowest stack headroom first
+    for (UBaseType_t i = 1; i < count; i++) {
+        TaskStatus_t status = taskStatus[i];
+        UBaseType_t j = i;
+        for (; j > 0 && taskStatus[j - 1].usStackHighWaterMark > status.usStackHighWaterMark; j--) {
+            taskStatus[j] = taskStatus[j - 1];
+        }
+        taskStatus[j] = status;
+    }
+
+    out.taskCount = count < TELEMETRY_MAX_TASKS ? count : TELEMETRY_MAX_TASKS;
+    out.tasksOmitted = count - out.taskCount;
+    for (uint8_t i = 0; i < out.taskCount; i++) {
+        TaskTelemetry& task = out.tasks[i];
+        strncpy(task.name, taskStatus[i].pcTaskName, TELEMETRY_NAME_LEN);
+        task.stackFree = taskStatus[i].usStackHighWaterMark * sizeof(StackType_t);
+#if configTASKLIST_INCLUDE_COREID
+        task.core = taskStatus[i].xCoreID < out.cores ? taskStatus[i].xCoreID : TELEMETRY_CORE_ANY;
+#else
+        task.core = TELEMETRY_CORE_ANY;
+#endif
+    }
+}
+
+void telemetryLog(const SystemTelemetry& sample) {
+    LOG_INFO("\n[*] Heap: free %u, largest block %u, min free %u\n",
+             (unsigned)sample.freeHeap, (unsigned)sample.largestFreeBlock, (unsigned)sample.minFreeHeap);
+    if (sample.idlePercent[0] == TELEMETRY_IDLE_UNKNOWN) {
+        LOG_INFO("[*] Idle: unknown (no FreeRTOS run-time stats)\n");
+    } else if (sample.cores > 1) {
+        LOG_INFO("[*] Idle: core 0 %u%%, core 1 %u%%\n",
+                 (unsigned)sample.idlePercent[0], (unsigned)sample.idlePercent[1]);
+    } else {
+        LOG_INFO("[*] Idle: core 0 %u%%\n", (unsigned)sample.idlePercent[0]);
+    }
+    for (uint8_t i = 0; i < sample.taskCount; i++) {
+        const TaskTelemetry& task = sample.tasks[i];
+        if (task.core == TELEMETRY_CORE_ANY) {
+            LOG_DEBUG("    %-16s stack free %5u\n", task.name, (unsigned)task.stackFree);
+        } else {
+            LOG_DEBUG("    %-16s stack free %5u (core %u)\n", task.name, (unsigned)task.stackFree,
+                      (unsigned)task.core);
+        }
+    }
+    if (sample.tasksOmitted) {
+        LOG_DEBUG("    (%u more tasks)\n", (unsigned)sample.tasksOmitted);
+    }
+}
+
+static uint8_t* putWord(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+    return out + 4;
+}
+
+size_t telemetrySerialize(const SystemTelemetry& sample, uint8_t* out, size_t cap) {
+    size_t fixed = 20 + sample.cores;
+    if (cap < fixed) return 0;
+
+    uint8_t* p = out;
+    *p++ = TELEMETRY_VERSION;
+    *p++ = sample.cores;
+    uint8_t* taskCount = p++;
+    uint8_t* tasksOmitted = p++;
+    p = putWord(p, sample.uptimeMs);
+    p = putWord(p, sample.freeHeap);
+    p = putWord(p, sample.largestFreeBlock);
+    p = putWord(p, sample.minFreeHeap);
+    memcpy(p, sample.idlePercent, sample.cores);
+    p += sample.cores;
+
+    // As many tasks as fit, most constrained first
+    uint8_t written = 0;
+    for (; written < sample.taskCount; written++) {
+        const TaskTelemetry& task = sample.tasks[written];
+        size_t nameLen = strnlen(task.name, TELEMETRY_NAME_LEN);
+        if ((size_t)(p - out) + 4 + nameLen > cap) break;
+        uint16_t stackFree = task.stackFree > UINT16_MAX ? UINT16_MAX : task.stackFree;
+        *p++ = task.core;
+        *p++ = (uint8_t)stackFree;
+        *p++ = (uint8_t)(stackFree >> 8);
+        *p++ = (uint8_t)nameLen;
+        memcpy(p, task.name, nameLen);
+        p += nameLen;
+    }
+    *taskCount = written;
+    *tasksOmitted = sample.tasksOmitted + (sample.taskCount - written);
+
+    return p - out;
+}
+
+static void telemetryTask(void* param) {
+    static SystemTelemetry sample;
+    static uint8_t serialized[TELEMETRY_MAX_SIZE];
+
+    // Baseline for the first idle percentage
+    telemetrySample(sample);
+
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(telemetryIntervalMs));
+        telemetrySample(sample);
+        telemetryLog(sample);
+        if (telemetrySink) {
+            telemetrySink(serialized, telemetrySerialize(sample, serialized, sizeof(serialized)));
+        }
+    }
+}
+
+void telemetryBegin(TelemetrySink sink, uint32_t intervalMs) {
+    telemetrySink = sink;
+    telemetryIntervalMs = intervalMs;
+    xTaskCreate(telemetryTask, "telemetry", TELEMETRY_TASK_STACK, nullptr, TELEMETRY_TASK_PRIORITY, nullptr);
+}
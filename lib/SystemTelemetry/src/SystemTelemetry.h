@@ -0,0 +1,69 @@
+/**
+ * System resource telemetry
+ *
+ * A low-priority task samples heap, stack and CPU use every
+ * TELEMETRY_INTERVAL_MS, logs it and hands a serialised copy to the
+ * firmware (which publishes it on a GATT characteristic):
+ *   - free heap, largest free block and the all-time minimum free heap
+ *   - stack high-water mark (bytes never touched) of every task, lowest
+ *     first, so the tasks closest to overflowing survive truncation
+ *   - idle percentage per core since the previous sample, from the
+ *     FreeRTOS run-time counters; TELEMETRY_IDLE_UNKNOWN when the SDK was
+ *     built without configGENERATE_RUN_TIME_STATS
+ *
+ * telemetrySerialize() layout, little-endian:
+ *   u8  version (TELEMETRY_VERSION)
+ *   u8  cores c, u8 tasks n, u8 tasks omitted
+ *   u32 uptimeMs, freeHeap, largestFreeBlock, minFreeHeap
+ *   u8  idlePercent[c]
+ *   n x { u8 core (0xFF unpinned), u16 stackFree, u8 nameLen, name }
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TELEMETRY_INTERVAL_MS
+#define TELEMETRY_INTERVAL_MS   10000
+#endif
+#define TELEMETRY_MAX_TASKS     24
+#define TELEMETRY_MAX_CORES     2
+#define TELEMETRY_NAME_LEN      16
+#define TELEMETRY_VERSION       1
+#define TELEMETRY_IDLE_UNKNOWN  0xFF
+#define TELEMETRY_CORE_ANY      0xFF
+#define TELEMETRY_MAX_SIZE      (20 + TELEMETRY_MAX_CORES + TELEMETRY_MAX_TASKS * (4 + TELEMETRY_NAME_LEN))
+
+struct TaskTelemetry {
+    char name[TELEMETRY_NAME_LEN + 1];
+    uint8_t core;          // TELEMETRY_CORE_ANY when not pinned
+    uint32_t stackFree;    // bytes
+};
+
+struct SystemTelemetry {
+    uint32_t uptimeMs;
+    uint32_t freeHeap;
+    uint32_t largestFreeBlock;
+    uint32_t minFreeHeap;
+    uint8_t cores;
+    uint8_t idlePercent[TELEMETRY_MAX_CORES];
+    uint8_t taskCount;
+    uint8_t tasksOmitted;  // more tasks than TELEMETRY_MAX_TASKS
+    TaskTelemetry tasks[TELEMETRY_MAX_TASKS];
+};
+
+// Receives each serialised sample on the telemetry task
+typedef void (*TelemetrySink)(const uint8_t* data, size_t len);
+
+// Start the sampler task; sink may be null (serial log only)
+void telemetryBegin(TelemetrySink sink = nullptr, uint32_t intervalMs = TELEMETRY_INTERVAL_MS);
+
+// Take a sample now. Idle percentages cover the time since the previous
+// call; only one task should sample.
+void telemetrySample(SystemTelemetry& out);
+
+void telemetryLog(const SystemTelemetry& sample);
+
+// Serialise sample into out; returns bytes written (at most cap)
+size_t telemetrySerialize(const SystemTelemetry& sample, uint8_t* out, size_t cap);
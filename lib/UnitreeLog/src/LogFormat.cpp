@@ -0,0 +1,152 @@
+#include "LogRecord.h"
+#include <stdio.h>
+
+// Cursor over the tagged arguments of a record
+class LogArgReader {
+public:
+    LogArgReader(const uint8_t* data, size_t len) : p(data), end(data + len) {}
+
+    bool next(uint8_t& tag, const uint8_t*& value, size_t& len) {
+        if (p >= end) return false;
+        tag = *p++;
+        switch (tag) {
+            case LOG_ARG_WORD:    len = 4; break;
+            case LOG_ARG_QUAD:    len = 8; break;
+            case LOG_ARG_DOUBLE:  len = sizeof(double); break;
+            case LOG_ARG_POINTER: len = sizeof(void*); break;
+            case LOG_ARG_STRING:
+            case LOG_ARG_BLOB:
+                if (p >= end) return false;
+                len = *p++;
+                break;
+            default:
+                return false;
+        }
+        if ((size_t)(end - p) < len) return false;
+        value = p;
+        p += len;
+        return true;
+    }
+
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+};
+
+// Appends to a fixed output buffer, always NUL-terminated
+class LogOutput {
+public:
+    LogOutput(char* out, size_t cap) : out(out), cap(cap), pos(0) {
+        if (cap) out[0] = '\0';
+    }
+
+    void put(char c) {
+        if (pos + 1 < cap) {
+            out[pos++] = c;
+            out[pos] = '\0';
+        }
+    }
+
+    template <typename T>
+    void print(const char* spec, T value) {
+        if (pos + 1 >= cap) return;
+        int n = snprintf(out + pos, cap - pos, spec, value);
+        if (n > 0) pos += (size_t)n < cap - pos ? (size_t)n : cap - pos - 1;
+    }
+
+    size_t size() const { return pos; }
+
+private:
+    char* out;
+    size_t cap;
+    size_t pos;
+};
+
+// Hex dump in the style of the old printHex helper
+static void printBlob(LogOutput& out, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        out.print("%02X ", data[i]);
+        if ((i + 1) % 16 == 0 && i < len - 1) {
+            out.print("%s", "\n                  ");
+        }
+    }
+}
+
+size_t formatLogRecord(const uint8_t* record, size_t len, char* out, size_t outCap) {
+    LogOutput output(out, outCap);
+
+    const char* format;
+    if (len < sizeof(format)) return 0;
+    memcpy(&format, record, sizeof(format));
+    LogArgReader args(record + sizeof(format), len - sizeof(format));
+
+    for (const char* f = format; *f; f++) {
+        if (*f != '%') {
+            output.put(*f);
+            continue;
+        }
+        if (f[1] == '%') {
+            output.put('%');
+            f++;
+            continue;
+        }
+
+        // Collect flags, width and precision; length modifiers are replaced
+        // by what the stored argument actually is
+        char spec[16];
+        size_t n = 0;
+        spec[n++] = '%';
+        f++;
+        while (*f && strchr("-+ #0123456789.", *f) && n < sizeof(spec) - 4) spec[n++] = *f++;
+        while (*f && strchr("hlzjtL", *f)) f++;
+        char conv = *f;
+        if (!conv) break;
+
+        uint8_t tag;
+        const uint8_t* value;
+        size_t valueLen;
+        if (!args.next(tag, value, valueLen)) {
+            output.put('?');
+            continue;
+        }
+
+        if (tag == LOG_ARG_WORD) {
+            uint32_t word;
+            memcpy(&word, value, sizeof(word));
+            spec[n++] = conv;
+            spec[n] = '\0';
+            if (conv == 'd' || conv == 'i' || conv == 'c') output.print(spec, (int)word);
+            else output.print(spec, (unsigned)word);
+        } else if (tag == LOG_ARG_QUAD) {
+            uint64_t quad;
+            memcpy(&quad, value, sizeof(quad));
+            spec[n++] = 'l';
+            spec[n++] = 'l';
+            spec[n++] = conv;
+            spec[n] = '\0';
+            if (conv == 'd' || conv == 'i') output.print(spec, (long long)quad);
+            else output.print(spec, (unsigned long long)quad);
+        } else if (tag == LOG_ARG_DOUBLE) {
+            double d;
+            memcpy(&d, value, sizeof(d));
+            spec[n++] = conv;
+            spec[n] = '\0';
+            output.print(spec, d);
+        } else if (tag == LOG_ARG_POINTER) {
+            const void* ptr;
+            memcpy(&ptr, value, sizeof(ptr));
+            output.print("%p", ptr);
+        } else if (tag == LOG_ARG_STRING) {
+            char str[LOG_MAX_STRING + 1];
+            memcpy(str, value, valueLen);
+            str[valueLen] = '\0';
+            spec[n++] = 's';
+            spec[n] = '\0';
+            output.print(spec, (const char*)str);
+        } else if (tag == LOG_ARG_BLOB) {
+            printBlob(output, value, valueLen);
+        }
+    }
+
+    return output.size();
+}
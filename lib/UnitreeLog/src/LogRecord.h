@@ -0,0 +1,101 @@
+/**
+ * Binary log records
+ *
+ * A record is the address of the format literal (its id; literals never
+ * move) followed by the arguments, each tagged with its storage type.
+ * Strings and byte blobs are copied in, so nothing points at caller
+ * memory once the record is queued.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#define LOG_MAX_RECORD   320
+#define LOG_MAX_STRING   192
+#define LOG_MAX_BLOB     128
+
+// Argument storage tags
+#define LOG_ARG_WORD     'w'   // integers up to 32 bits
+#define LOG_ARG_QUAD     'q'   // 64-bit integers
+#define LOG_ARG_DOUBLE   'f'
+#define LOG_ARG_STRING   's'   // [len u8][bytes]
+#define LOG_ARG_BLOB     'b'   // [len u8][bytes], printed by %H
+#define LOG_ARG_POINTER  'p'
+
+class LogRecordWriter {
+public:
+    explicit LogRecordWriter(const char* format) {
+        memcpy(buf, &format, sizeof(format));
+        pos = sizeof(format);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    put(T value) {
+        if (sizeof(T) <= 4) {
+            uint32_t word = (uint32_t)value;
+            putTagged(LOG_ARG_WORD, &word, sizeof(word));
+        } else {
+            uint64_t quad = (uint64_t)value;
+            putTagged(LOG_ARG_QUAD, &quad, sizeof(quad));
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    put(T value) {
+        double d = value;
+        putTagged(LOG_ARG_DOUBLE, &d, sizeof(d));
+    }
+
+    void put(const char* str) {
+        if (!str) str = "(null)";
+        size_t len = strnlen(str, LOG_MAX_STRING);
+        putBytes(LOG_ARG_STRING, (const uint8_t*)str, len);
+    }
+
+    void put(char* str) {
+        put((const char*)str);
+    }
+
+    void put(const void* ptr) {
+        putTagged(LOG_ARG_POINTER, &ptr, sizeof(ptr));
+    }
+
+    void putBlob(const uint8_t* data, size_t len) {
+        putBytes(LOG_ARG_BLOB, data, len < LOG_MAX_BLOB ? len : LOG_MAX_BLOB);
+    }
+
+    const uint8_t* data() const { return buf; }
+    size_t size() const { return pos; }
+
+private:
+    void putTagged(uint8_t tag, const void* value, size_t len) {
+        if (pos + 1 + len > sizeof(buf)) return;
+        buf[pos++] = tag;
+        memcpy(buf + pos, value, len);
+        pos += len;
+    }
+
+    void putBytes(uint8_t tag, const uint8_t* bytes, size_t len) {
+        if (pos + 2 + len > sizeof(buf)) {
+            if (pos + 2 > sizeof(buf)) return;
+            len = sizeof(buf) - pos - 2;
+        }
+        buf[pos++] = tag;
+        buf[pos++] = (uint8_t)len;
+        memcpy(buf + pos, bytes, len);
+        pos += len;
+    }
+
+    uint8_t buf[LOG_MAX_RECORD];
+    size_t pos;
+};
+
+// Render a record into out as text. Returns the number of characters
+// written (always NUL-terminated, truncated to outCap - 1).
+size_t formatLogRecord(const uint8_t* record, size_t len, char* out, size_t outCap);
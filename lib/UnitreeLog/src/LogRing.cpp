@@ -0,0 +1,71 @@
+#include "LogRing.h"
+#include <string.h>
+
+// Records are stored as [len u16][bytes]
+#define LOG_LEN_SIZE 2
+
+void LogRing::lock() {
+#if defined(ESP_PLATFORM)
+    portENTER_CRITICAL(&mux);
+#else
+    mutex.lock();
+#endif
+}
+
+void LogRing::unlock() {
+#if defined(ESP_PLATFORM)
+    portEXIT_CRITICAL(&mux);
+#else
+    mutex.unlock();
+#endif
+}
+
+void LogRing::write(size_t at, const uint8_t* src, size_t len) {
+    size_t offset = at % LOG_RING_SIZE;
+    size_t first = len < LOG_RING_SIZE - offset ? len : LOG_RING_SIZE - offset;
+    memcpy(buf + offset, src, first);
+    memcpy(buf, src + first, len - first);
+}
+
+void LogRing::read(size_t at, uint8_t* dst, size_t len) const {
+    size_t offset = at % LOG_RING_SIZE;
+    size_t first = len < LOG_RING_SIZE - offset ? len : LOG_RING_SIZE - offset;
+    memcpy(dst, buf + offset, first);
+    memcpy(dst + first, buf, len - first);
+}
+
+bool LogRing::push(const uint8_t* record, size_t len) {
+    uint16_t recordLen = (uint16_t)len;
+
+    lock();
+    if (head - tail + LOG_LEN_SIZE + len > LOG_RING_SIZE) {
+        droppedCount++;
+        unlock();
+        return false;
+    }
+    write(head, (const uint8_t*)&recordLen, LOG_LEN_SIZE);
+    write(head + LOG_LEN_SIZE, record, len);
+    head += LOG_LEN_SIZE + len;
+    unlock();
+    return true;
+}
+
+size_t LogRing::pop(uint8_t* out, size_t outCap) {
+    lock();
+    if (head == tail) {
+        unlock();
+        return 0;
+    }
+
+    uint16_t recordLen;
+    read(tail, (uint8_t*)&recordLen, LOG_LEN_SIZE);
+    size_t copied = recordLen < outCap ? recordLen : outCap;
+    read(tail + LOG_LEN_SIZE, out, copied);
+    tail += LOG_LEN_SIZE + recordLen;
+    unlock();
+    return copied;
+}
+
+size_t LogRing::used() const {
+    return head - tail;
+}
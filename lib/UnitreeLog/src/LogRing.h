@@ -0,0 +1,54 @@
+/**
+ * Preallocated multi-producer, single-consumer byte ring for log records
+ *
+ * Producers never block: when a record does not fit it is dropped and
+ * counted. The lock is held only for the memcpy.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#else
+#include <mutex>
+#endif
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 8192
+#endif
+
+// Positions are free-running counters; a power of two keeps them valid
+// across wrap-around
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+class LogRing {
+public:
+    // Queue a record; false (and counted as dropped) when the ring is full
+    bool push(const uint8_t* record, size_t len);
+
+    // Dequeue the oldest record into out. Returns its size, 0 when empty.
+    size_t pop(uint8_t* out, size_t outCap);
+
+    uint32_t dropped() const { return droppedCount; }
+    size_t used() const;
+
+private:
+    void lock();
+    void unlock();
+    void write(size_t at, const uint8_t* src, size_t len);
+    void read(size_t at, uint8_t* dst, size_t len) const;
+
+    uint8_t buf[LOG_RING_SIZE];
+    size_t head = 0;  // total bytes written
+    size_t tail = 0;  // total bytes consumed
+    volatile uint32_t droppedCount = 0;
+
+#if defined(ESP_PLATFORM)
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#else
+    std::mutex mutex;
+#endif
+};
@@ -0,0 +1,58 @@
+#include "UnitreeLog.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#endif
+
+#define LOG_LINE_SIZE 512
+
+LogRing logRing;
+
+size_t logDrain(LogSink sink, size_t maxRecords) {
+    static uint32_t reportedDrops = 0;
+
+    uint8_t record[LOG_MAX_RECORD];
+    char line[LOG_LINE_SIZE];
+    size_t drained = 0;
+
+    while (drained < maxRecords) {
+        size_t len = logRing.pop(record, sizeof(record));
+        if (len == 0) break;
+        sink(line, formatLogRecord(record, len, line, sizeof(line)));
+        drained++;
+    }
+
+    uint32_t dropped = logRing.dropped();
+    if (dropped != reportedDrops) {
+        int n = snprintf(line, sizeof(line), "[log] %u records dropped\n",
+                         (unsigned)(dropped - reportedDrops));
+        sink(line, n);
+        reportedDrops = dropped;
+    }
+
+    return drained;
+}
+
+#if defined(ARDUINO)
+
+#define LOG_TASK_STACK    4096
+#define LOG_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define LOG_IDLE_MS       10
+
+static void serialSink(const char* text, size_t len) {
+    Serial.write((const uint8_t*)text, len);
+}
+
+static void logTask(void* param) {
+    for (;;) {
+        if (logDrain(serialSink, 16) == 0) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_IDLE_MS));
+        }
+    }
+}
+
+void logBegin() {
+    xTaskCreate(logTask, "log_drain", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, nullptr);
+}
+
+#endif
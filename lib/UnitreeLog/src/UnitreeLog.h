@@ -0,0 +1,84 @@
+/**
+ * Asynchronous logging front-end
+ *
+ * logPrint() encodes its arguments into a binary record and queues it in
+ * a preallocated ring; formatting and UART time happen later on a
+ * low-priority drain task. A full ring drops the record and counts it
+ * rather than blocking the caller, so logging from BLE callbacks costs a
+ * memcpy.
+ *
+ * Call sites use the LOG_ERROR .. LOG_DEBUG macros, which compare against
+ * the file's LOG_MODULE_LEVEL with if constexpr: a disabled statement is
+ * discarded at compile time, arguments and format string included. Each
+ * source file maps LOG_MODULE_LEVEL to its own -DLOG_LEVEL_<MODULE> flag,
+ * falling back to the global LOG_LEVEL.
+ *
+ * Format strings must be literals (their address is the record id).
+ * Supported conversions: d i u x X o c s f g e p, plus %H for a hex dump
+ * of a blob passed through logHex().
+ */
+
+#pragma once
+
+#include "LogRecord.h"
+#include "LogRing.h"
+
+// Log levels
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4   // per-frame chatter and hex dumps
+
+// Global default for modules without their own flag
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// The dead logFormatCheck() call gives every statement, enabled or not,
+// the compiler's printf format checking; it is never evaluated
+#define LOG_AT(level, ...) \
+    do { \
+        if (false) logFormatCheck(__VA_ARGS__); \
+        if constexpr ((level) <= (LOG_MODULE_LEVEL)) logPrint(__VA_ARGS__); \
+    } while (0)
+
+#define LOG_ERROR(...)  LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)   LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)   LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)  LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#define LOG_HEX(label, data, len) \
+    do { if constexpr (LOG_LEVEL_DEBUG <= (LOG_MODULE_LEVEL)) logHex(label, data, len); } while (0)
+
+extern LogRing logRing;
+
+// Never called at run time; see LOG_AT
+__attribute__((format(printf, 1, 2))) inline void logFormatCheck(const char*, ...) {}
+
+template <typename... Args>
+inline void logPrint(const char* format, Args... args) {
+    LogRecordWriter record(format);
+    int expand[] = {0, (record.put(args), 0)...};
+    (void)expand;
+    logRing.push(record.data(), record.size());
+}
+
+// Labelled hex dump: "<label> [<n> bytes]: XX XX ..."
+inline void logHex(const char* label, const uint8_t* data, size_t len) {
+    LogRecordWriter record("%s [%u bytes]: %H\n");
+    record.put(label);
+    record.put((uint32_t)len);
+    record.putBlob(data, len);
+    logRing.push(record.data(), record.size());
+}
+
+// Format and hand up to maxRecords queued records to sink. Reports records
+// dropped since the previous call. Returns the number drained.
+typedef void (*LogSink)(const char* text, size_t len);
+size_t logDrain(LogSink sink, size_t maxRecords = SIZE_MAX);
+
+#if defined(ARDUINO)
+// Start the drain task writing to Serial
+void logBegin();
+#endif
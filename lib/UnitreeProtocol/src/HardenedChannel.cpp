@@ -0,0 +1,227 @@
+#include "HardenedChannel.h"
+#include <string.h>
+#include "mbedtls/ecdh.h"
+#include "mbedtls/md.h"
+#include "UnitreeCodec.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_random.h>
+#else
+#include <sys/random.h>
+#endif
+
+int hardenedRandom(void* context, unsigned char* out, size_t len) {
+#if defined(ESP_PLATFORM)
+    esp_fill_random(out, len);
+    return 0;
+#else
+    while (len > 0) {
+        ssize_t n = getrandom(out, len, 0);
+        if (n <= 0) return -1;
+        out += n;
+        len -= n;
+    }
+    return 0;
+#endif
+}
+
+static const mbedtls_md_info_t* sha256() {
+    return mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+}
+
+// Volatile accumulator so the compiler cannot turn this into an early exit
+static bool equalConstantTime(const uint8_t* a, const uint8_t* b, size_t len) {
+    volatile uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+static void wipe(void* data, size_t len) {
+    volatile uint8_t* p = (volatile uint8_t*)data;
+    while (len--) *p++ = 0;
+}
+
+HardenedChannel::HardenedChannel() {
+    mbedtls_ccm_init(&ccm);
+}
+
+HardenedChannel::~HardenedChannel() {
+    end();
+    mbedtls_ccm_free(&ccm);
+}
+
+bool HardenedChannel::begin(Role channelRole) {
+    end();
+    role = channelRole;
+
+    mbedtls_ecp_group group;
+    mbedtls_mpi secret;
+    mbedtls_ecp_point point;
+    mbedtls_ecp_group_init(&group);
+    mbedtls_mpi_init(&secret);
+    mbedtls_ecp_point_init(&point);
+
+    size_t publicLen = 0;
+    bool ok = mbedtls_ecp_group_load(&group, MBEDTLS_ECP_DP_CURVE25519) == 0 &&
+              mbedtls_ecdh_gen_public(&group, &secret, &point, hardenedRandom, nullptr) == 0 &&
+              mbedtls_mpi_write_binary_le(&secret, privateKey, sizeof(privateKey)) == 0 &&
+              mbedtls_ecp_point_write_binary(&group, &point, MBEDTLS_ECP_PF_UNCOMPRESSED, &publicLen,
+                                             publicKey, sizeof(publicKey)) == 0 &&
+              publicLen == sizeof(publicKey) &&
+              hardenedRandom(nullptr, challenge, sizeof(challenge)) == 0;
+
+    mbedtls_ecp_point_free(&point);
+    mbedtls_mpi_free(&secret);
+    mbedtls_ecp_group_free(&group);
+
+    hasKeyPair = ok;
+    return ok;
+}
+
+size_t HardenedChannel::encodeHello(uint8_t* out, size_t outCap) const {
+    if (!hasKeyPair || outCap < HARDENED_HELLO_SIZE) return 0;
+
+    out[0] = role == CLIENT ? OPCODE_REQUEST : OPCODE_RESPONSE;
+    out[1] = HARDENED_HELLO_SIZE;
+    out[2] = HARDENED_FRAME_HELLO;
+    memcpy(out + HARDENED_HEADER_SIZE, publicKey, HARDENED_KEY_SIZE);
+    memcpy(out + HARDENED_HEADER_SIZE + HARDENED_KEY_SIZE, challenge, HARDENED_CHALLENGE_SIZE);
+    return HARDENED_HELLO_SIZE;
+}
+
+bool HardenedChannel::acceptHello(const uint8_t* frame, size_t len) {
+    if (!hasKeyPair || !isHello(frame, len)) return false;
+    const uint8_t* peerKey = frame + HARDENED_HEADER_SIZE;
+    const uint8_t* peerChallenge = peerKey + HARDENED_KEY_SIZE;
+
+    mbedtls_ecp_group group;
+    mbedtls_mpi secret;
+    mbedtls_mpi shared;
+    mbedtls_ecp_point peer;
+    mbedtls_ecp_group_init(&group);
+    mbedtls_mpi_init(&secret);
+    mbedtls_mpi_init(&shared);
+    mbedtls_ecp_point_init(&peer);
+
+    // A low-order peer key yields an all-zero secret; refuse it
+    uint8_t sharedSecret[HARDENED_KEY_SIZE];
+    bool ok = mbedtls_ecp_group_load(&group, MBEDTLS_ECP_DP_CURVE25519) == 0 &&
+              mbedtls_ecp_point_read_binary(&group, &peer, peerKey, HARDENED_KEY_SIZE) == 0 &&
+              mbedtls_mpi_read_binary_le(&secret, privateKey, sizeof(privateKey)) == 0 &&
+              mbedtls_ecdh_compute_shared(&group, &shared, &peer, &secret, hardenedRandom, nullptr) == 0 &&
+              mbedtls_mpi_cmp_int(&shared, 0) != 0 &&
+              mbedtls_mpi_write_binary_le(&shared, sharedSecret, sizeof(sharedSecret)) == 0;
+
+    mbedtls_ecp_point_free(&peer);
+    mbedtls_mpi_free(&shared);
+    mbedtls_mpi_free(&secret);
+    mbedtls_ecp_group_free(&group);
+    if (!ok) {
+        wipe(sharedSecret, sizeof(sharedSecret));
+        return false;
+    }
+
+    // Transcript: client key, server key, client challenge, server challenge
+    bool client = role == CLIENT;
+    uint8_t material[2 * HARDENED_KEY_SIZE + 2 * HARDENED_CHALLENGE_SIZE];
+    uint8_t* p = material;
+    memcpy(p, client ? publicKey : peerKey, HARDENED_KEY_SIZE);
+    p += HARDENED_KEY_SIZE;
+    memcpy(p, client ? peerKey : publicKey, HARDENED_KEY_SIZE);
+    p += HARDENED_KEY_SIZE;
+    memcpy(p, client ? challenge : peerChallenge, HARDENED_CHALLENGE_SIZE);
+    p += HARDENED_CHALLENGE_SIZE;
+    memcpy(p, client ? peerChallenge : challenge, HARDENED_CHALLENGE_SIZE);
+    mbedtls_md(sha256(), material, sizeof(material), transcript);
+
+    // HKDF-SHA256: extract with the transcript as salt, one expand block
+    static const uint8_t INFO[] = "unipwn hardened v1\x01";
+    uint8_t prk[32];
+    uint8_t okm[32];
+    mbedtls_md_hmac(sha256(), transcript, sizeof(transcript), sharedSecret, sizeof(sharedSecret), prk);
+    mbedtls_md_hmac(sha256(), prk, sizeof(prk), INFO, sizeof(INFO) - 1, okm);
+    hasKey = mbedtls_ccm_setkey(&ccm, MBEDTLS_CIPHER_ID_AES, okm, 128) == 0;
+
+    wipe(sharedSecret, sizeof(sharedSecret));
+    wipe(prk, sizeof(prk));
+    wipe(okm, sizeof(okm));
+    wipe(privateKey, sizeof(privateKey));
+    return hasKey;
+}
+
+void HardenedChannel::proof(Role proofRole, uint8_t* out) const {
+    static const uint8_t SECRET[] = HARDENED_PAIRING_SECRET;
+    uint8_t input[1 + sizeof(transcript)];
+    input[0] = proofRole == CLIENT ? 'C' : 'S';
+    memcpy(input + 1, transcript, sizeof(transcript));
+
+    uint8_t mac[32];
+    mbedtls_md_hmac(sha256(), SECRET, sizeof(SECRET) - 1, input, sizeof(input), mac);
+    memcpy(out, mac, HARDENED_PROOF_SIZE);
+}
+
+bool HardenedChannel::checkPeerProof(const uint8_t* peerProof, size_t len) const {
+    if (!hasKey || len != HARDENED_PROOF_SIZE) return false;
+    uint8_t expected[HARDENED_PROOF_SIZE];
+    proof(role == CLIENT ? SERVER : CLIENT, expected);
+    return equalConstantTime(expected, peerProof, HARDENED_PROOF_SIZE);
+}
+
+size_t HardenedChannel::seal(uint8_t opcode, uint8_t instruction, const uint8_t* payload,
+                             size_t payloadLen, uint8_t* out, size_t outCap) {
+    size_t frameLen = HARDENED_SEAL_OVERHEAD + payloadLen;
+    if (!hasKey || frameLen > outCap || frameLen > FRAME_MAX_SIZE) return 0;
+
+    out[0] = opcode;
+    out[1] = (uint8_t)frameLen;
+    out[2] = HARDENED_FRAME_SEALED;
+    uint8_t* nonce = out + HARDENED_HEADER_SIZE;
+    uint8_t* body = nonce + HARDENED_NONCE_SIZE;
+    uint8_t* tag = body + 1 + payloadLen;
+    if (hardenedRandom(nullptr, nonce, HARDENED_NONCE_SIZE) != 0) return 0;
+
+    // CCM reads the plaintext from out, so stage it there first
+    body[0] = instruction;
+    memmove(body + 1, payload, payloadLen);
+    if (mbedtls_ccm_encrypt_and_tag(&ccm, 1 + payloadLen, nonce, HARDENED_NONCE_SIZE,
+                                    out, HARDENED_HEADER_SIZE, body, body,
+                                    tag, HARDENED_TAG_SIZE) != 0) {
+        return 0;
+    }
+    return frameLen;
+}
+
+size_t HardenedChannel::open(const uint8_t* frame, size_t len, uint8_t* out, size_t outCap) {
+    if (!hasKey || !isSealed(frame, len)) return 0;
+
+    size_t bodyLen = len - HARDENED_HEADER_SIZE - HARDENED_NONCE_SIZE - HARDENED_TAG_SIZE;
+    size_t plainLen = bodyLen + 3;   // opcode, length, checksum around the body
+    if (plainLen > outCap) return 0;
+
+    const uint8_t* nonce = frame + HARDENED_HEADER_SIZE;
+    const uint8_t* body = nonce + HARDENED_NONCE_SIZE;
+    if (mbedtls_ccm_auth_decrypt(&ccm, bodyLen, nonce, HARDENED_NONCE_SIZE,
+                                 frame, HARDENED_HEADER_SIZE, body, out + 2,
+                                 body + bodyLen, HARDENED_TAG_SIZE) != 0) {
+        return 0;
+    }
+
+    out[0] = frame[0];
+    out[1] = (uint8_t)plainLen;
+    out[plainLen - 1] = UnitreeCodec::checksum(out, plainLen - 1);
+    return plainLen;
+}
+
+void HardenedChannel::end() {
+    wipe(privateKey, sizeof(privateKey));
+    wipe(transcript, sizeof(transcript));
+    if (hasKey) {
+        // Drop the expanded CCM key schedule along with the key
+        mbedtls_ccm_free(&ccm);
+        mbedtls_ccm_init(&ccm);
+    }
+    hasKeyPair = false;
+    hasKey = false;
+}
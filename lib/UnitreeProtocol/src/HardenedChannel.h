@@ -0,0 +1,125 @@
+/**
+ * Hardened Unitree channel
+ *
+ * What the protocol should have been: each connection agrees a fresh
+ * AES-128 key over X25519, every frame is sealed with AES-CCM under a
+ * random nonce, and the handshake proves knowledge of a per-device pairing
+ * secret instead of sending the literal "unitree". Used by the emulator's
+ * and scanner's hardened builds (HARDENED_PROTOCOL=1) to put numbers on
+ * the cost of fixing the vulnerable profile.
+ *
+ * Wire frames keep the [opcode, length, ...] header; the byte after it
+ * says which kind follows:
+ *   hello   [opcode, length, 0xA1, X25519 public key (32), challenge (16)]
+ *   sealed  [opcode, length, 0xA2, nonce (12), CCM(instruction, payload), tag (8)]
+ * The sealed header bytes are authenticated data. Opening a sealed frame
+ * yields an ordinary plaintext frame (checksum filled in), so the existing
+ * dispatch and parsers run unchanged.
+ *
+ * Handshake, after both hellos: the client sends a sealed INSTR_HANDSHAKE
+ * whose payload is its proof; the server answers [status, server proof].
+ * Proofs are HMAC-SHA256(pairing secret, role || transcript) truncated to
+ * 16 bytes, the transcript being SHA-256 over both public keys and both
+ * challenges, so a relay that swapped keys cannot produce them. The
+ * session key is HKDF-SHA256(X25519 secret, salt = transcript).
+ *
+ * Not covered: replay of sealed frames within a session (no counter).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbedtls/ccm.h"
+#include "UnitreeProtocol.h"
+
+// Build the hardened profile (set by the *-hardened envs)
+#ifndef HARDENED_PROTOCOL
+#define HARDENED_PROTOCOL 0
+#endif
+
+// Per-device pairing secret both sides prove knowledge of
+#ifndef HARDENED_PAIRING_SECRET
+#define HARDENED_PAIRING_SECRET "unipwn-demo-pairing-secret"
+#endif
+
+#define HARDENED_FRAME_HELLO     0xA1
+#define HARDENED_FRAME_SEALED    0xA2
+
+#define HARDENED_HEADER_SIZE     3    // opcode, length, frame kind
+#define HARDENED_KEY_SIZE        32   // X25519 public key
+#define HARDENED_CHALLENGE_SIZE  16
+#define HARDENED_NONCE_SIZE      12
+#define HARDENED_TAG_SIZE        8
+#define HARDENED_PROOF_SIZE      16
+#define HARDENED_HELLO_SIZE      (HARDENED_HEADER_SIZE + HARDENED_KEY_SIZE + HARDENED_CHALLENGE_SIZE)
+
+// Smallest ATT MTU whose notifications fit a hello
+#define HARDENED_MIN_MTU         (HARDENED_HELLO_SIZE + ATT_NOTIFY_OVERHEAD)
+
+// Sealed frame bytes around the payload, and the growth over a plain frame
+#define HARDENED_SEAL_OVERHEAD   (HARDENED_HEADER_SIZE + HARDENED_NONCE_SIZE + 1 + HARDENED_TAG_SIZE)
+#define HARDENED_SEAL_GROWTH     (HARDENED_SEAL_OVERHEAD - FRAME_OVERHEAD)
+
+class HardenedChannel {
+public:
+    enum Role : uint8_t { CLIENT, SERVER };
+
+    HardenedChannel();
+    ~HardenedChannel();
+    HardenedChannel(const HardenedChannel&) = delete;
+    HardenedChannel& operator=(const HardenedChannel&) = delete;
+
+    // Fresh key pair and challenge for a new connection; forgets any
+    // previous session. False if key generation failed.
+    bool begin(Role role);
+
+    // Our hello, [opcode, length, 0xA1, public key, challenge]. Returns its
+    // size, or 0 before begin() or if it does not fit in outCap.
+    size_t encodeHello(uint8_t* out, size_t outCap) const;
+
+    // The peer's hello: X25519, transcript and session key. False for a
+    // malformed frame or a key that gives a degenerate secret.
+    bool acceptHello(const uint8_t* frame, size_t len);
+
+    bool keyed() const { return hasKey; }
+
+    // Proof for role (ours or the peer's) over this session's transcript
+    void proof(Role role, uint8_t* out) const;
+
+    // Constant-time check of a proof received from the peer
+    bool checkPeerProof(const uint8_t* proof, size_t len) const;
+
+    // Seal [instruction, payload] under a random nonce. Returns the frame
+    // size, or 0 if unkeyed or the frame would not fit outCap or the length byte.
+    size_t seal(uint8_t opcode, uint8_t instruction, const uint8_t* payload, size_t payloadLen,
+                uint8_t* out, size_t outCap);
+
+    // Verify and decrypt a sealed frame into a plaintext frame [opcode,
+    // length, instruction, payload..., checksum]. Returns its size, or 0 on
+    // a malformed frame or a tag mismatch.
+    size_t open(const uint8_t* frame, size_t len, uint8_t* out, size_t outCap);
+
+    // Wipe the key material
+    void end();
+
+    static bool isHello(const uint8_t* frame, size_t len) {
+        return len == HARDENED_HELLO_SIZE && frame[1] == len && frame[2] == HARDENED_FRAME_HELLO;
+    }
+    static bool isSealed(const uint8_t* frame, size_t len) {
+        return len >= HARDENED_SEAL_OVERHEAD && frame[1] == len && frame[2] == HARDENED_FRAME_SEALED;
+    }
+
+private:
+    Role role = CLIENT;
+    bool hasKeyPair = false;
+    bool hasKey = false;
+    mbedtls_ccm_context ccm;
+    uint8_t privateKey[HARDENED_KEY_SIZE];
+    uint8_t publicKey[HARDENED_KEY_SIZE];
+    uint8_t challenge[HARDENED_CHALLENGE_SIZE];
+    uint8_t transcript[32];
+};
+
+// Fill out with random bytes (hardware RNG on the ESP32, getrandom on the host)
+int hardenedRandom(void* context, unsigned char* out, size_t len);
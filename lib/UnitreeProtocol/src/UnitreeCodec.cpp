@@ -0,0 +1,123 @@
+#include "UnitreeCodec.h"
+#include <string.h>
+
+void UnitreeCodec::begin() {
+    mbedtls_aes_init(&aesCtx);
+    // Same key is used for both encrypt and decrypt in CFB mode
+    mbedtls_aes_setkey_enc(&aesCtx, AES_KEY, 128);
+
+    // Key and IV are fixed, so the first keystream block never changes
+    mbedtls_aes_crypt_ecb(&aesCtx, MBEDTLS_AES_ENCRYPT, AES_IV, firstKeystream);
+}
+
+bool UnitreeCodec::crypt(int mode, const uint8_t* in, size_t len, uint8_t* out) {
+    size_t head = len < sizeof(firstKeystream) ? len : sizeof(firstKeystream);
+
+    // The next block's IV is the first ciphertext block; grab it before an
+    // in-place decrypt overwrites it
+    uint8_t iv[16];
+    if (mode == MBEDTLS_AES_DECRYPT && len > head) {
+        memcpy(iv, in, sizeof(iv));
+    }
+
+    for (size_t i = 0; i < head; i++) {
+        out[i] = in[i] ^ firstKeystream[i];
+    }
+
+    if (len == head) return true;
+
+    if (mode == MBEDTLS_AES_ENCRYPT) {
+        memcpy(iv, out, sizeof(iv));
+    }
+
+    // Continue the CFB chain from the second block
+    size_t ivOffset = 0;
+    return mbedtls_aes_crypt_cfb128(&aesCtx, mode, len - head, &ivOffset, iv,
+                                    in + head, out + head) == 0;
+}
+
+bool UnitreeCodec::encrypt(const uint8_t* in, size_t len, uint8_t* out) {
+    return crypt(MBEDTLS_AES_ENCRYPT, in, len, out);
+}
+
+bool UnitreeCodec::decrypt(const uint8_t* in, size_t len, uint8_t* out) {
+    return crypt(MBEDTLS_AES_DECRYPT, in, len, out);
+}
+
+uint8_t UnitreeCodec::checksum(const uint8_t* data, size_t len) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += data[i];
+    }
+    return (-sum) & 0xFF;
+}
+
+bool UnitreeCodec::validateChecksum(const uint8_t* frame, size_t len) {
+    if (len < FRAME_OVERHEAD) return false;
+
+    uint32_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += frame[i];
+    }
+    return (sum & 0xFF) == 0;
+}
+
+size_t UnitreeCodec::encodeFrame(uint8_t opcode, uint8_t instruction,
+                                 const uint8_t* payload, size_t payloadLen,
+                                 uint8_t* out, size_t outCap) {
+    size_t frameLen = payloadLen + FRAME_OVERHEAD;
+    if (payloadLen > FRAME_MAX_PAYLOAD || frameLen > outCap) return 0;
+
+    const uint8_t* keystream = firstKeystream;
+    uint8_t nextKeystream[16];
+    uint32_t sum = 0;
+    size_t pos = 0;
+
+    // Encrypt one plaintext byte; the next keystream block is AES of the
+    // ciphertext block just completed
+    auto put = [&](uint8_t plain) {
+        sum += plain;
+        out[pos] = plain ^ keystream[pos & 15];
+        if ((pos & 15) == 15 && pos + 1 < frameLen) {
+            mbedtls_aes_crypt_ecb(&aesCtx, MBEDTLS_AES_ENCRYPT, out + pos - 15, nextKeystream);
+            keystream = nextKeystream;
+        }
+        pos++;
+    };
+
+    put(opcode);
+    put((uint8_t)frameLen);
+    put(instruction);
+    for (size_t i = 0; i < payloadLen; i++) {
+        put(payload[i]);
+    }
+    put((-sum) & 0xFF);
+
+    return frameLen;
+}
+
+size_t UnitreeCodec::decodeFrame(const uint8_t* in, size_t len, uint8_t* out, size_t outCap,
+                                 bool* checksumOk) {
+    if (len == 0 || len > outCap) return 0;
+
+    const uint8_t* keystream = firstKeystream;
+    uint8_t nextKeystream[16];
+    uint8_t cipherBlock[16];  // survives an in-place decrypt
+    uint32_t sum = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = in[i];
+        cipherBlock[i & 15] = c;
+        out[i] = c ^ keystream[i & 15];
+        sum += out[i];
+        if ((i & 15) == 15 && i + 1 < len) {
+            mbedtls_aes_crypt_ecb(&aesCtx, MBEDTLS_AES_ENCRYPT, cipherBlock, nextKeystream);
+            keystream = nextKeystream;
+        }
+    }
+
+    if (checksumOk) {
+        *checksumOk = len >= FRAME_OVERHEAD && (sum & 0xFF) == 0;
+    }
+    return len;
+}
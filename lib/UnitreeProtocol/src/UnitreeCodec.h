@@ -0,0 +1,63 @@
+/**
+ * Unitree frame codec
+ *
+ * Builds, encrypts, decrypts and validates Unitree frames. All routines
+ * work on caller-provided buffers and never touch the heap, so they are
+ * safe to call from BLE callbacks and cheap enough for the hot path.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbedtls/aes.h"
+#include "UnitreeProtocol.h"
+
+class UnitreeCodec {
+public:
+    // Initialise the AES context with the fixed Unitree key and cache the
+    // first keystream block
+    void begin();
+
+    // AES-CFB128 with the fixed IV; in and out may alias. Frames of up to
+    // one block are a plain XOR with the cached keystream.
+    bool encrypt(const uint8_t* in, size_t len, uint8_t* out);
+    bool decrypt(const uint8_t* in, size_t len, uint8_t* out);
+
+    // Two's-complement checksum over data
+    static uint8_t checksum(const uint8_t* data, size_t len);
+
+    // True when the frame sums to zero (checksum byte included)
+    static bool validateChecksum(const uint8_t* frame, size_t len);
+
+    // Build and encrypt a frame into out in a single pass, summing the
+    // checksum as bytes stream through CFB. Returns the frame size, or 0 if
+    // the payload does not fit in outCap or in the length byte.
+    size_t encodeFrame(uint8_t opcode, uint8_t instruction,
+                       const uint8_t* payload, size_t payloadLen,
+                       uint8_t* out, size_t outCap);
+
+    size_t encodeRequest(uint8_t instruction, const uint8_t* payload, size_t payloadLen,
+                         uint8_t* out, size_t outCap) {
+        return encodeFrame(OPCODE_REQUEST, instruction, payload, payloadLen, out, outCap);
+    }
+
+    size_t encodeResponse(uint8_t instruction, const uint8_t* payload, size_t payloadLen,
+                          uint8_t* out, size_t outCap) {
+        return encodeFrame(OPCODE_RESPONSE, instruction, payload, payloadLen, out, outCap);
+    }
+
+    // Decrypt a received frame into out (in and out may alias), validating
+    // the checksum in the same pass. Returns the plaintext size, or 0 if the
+    // frame does not fit in outCap. Structure is not checked here.
+    size_t decodeFrame(const uint8_t* in, size_t len, uint8_t* out, size_t outCap,
+                       bool* checksumOk = nullptr);
+
+private:
+    bool crypt(int mode, const uint8_t* in, size_t len, uint8_t* out);
+
+    mbedtls_aes_context aesCtx;
+
+    // AES(IV): the first CFB keystream block, identical for every frame
+    uint8_t firstKeystream[16];
+};
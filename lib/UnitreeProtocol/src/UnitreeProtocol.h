@@ -0,0 +1,49 @@
+/**
+ * Unitree BLE provisioning protocol constants
+ *
+ * Shared by the scanner, the emulator and the host tools so every
+ * implementation agrees on the wire format.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// BLE Service and Characteristic UUIDs (from Unitree protocol)
+#define SERVICE_UUID           "0000ffe0-0000-1000-8000-00805f9b34fb"
+#define CHARACTERISTIC_NOTIFY  "0000ffe1-0000-1000-8000-00805f9b34fb"
+#define CHARACTERISTIC_WRITE   "0000ffe2-0000-1000-8000-00805f9b34fb"
+
+// AES Encryption constants (hardcoded in Unitree firmware)
+const uint8_t AES_KEY[16] = {
+    0xdf, 0x98, 0xb7, 0x15, 0xd5, 0xc6, 0xed, 0x2b,
+    0x25, 0x81, 0x7b, 0x6f, 0x25, 0x54, 0x12, 0x4a
+};
+
+const uint8_t AES_IV[16] = {
+    0x28, 0x41, 0xae, 0x97, 0x41, 0x9c, 0x29, 0x73,
+    0x29, 0x6a, 0x0d, 0x4b, 0xdf, 0xe1, 0x9a, 0x4f
+};
+
+// Packet opcodes
+#define OPCODE_REQUEST   0x52
+#define OPCODE_RESPONSE  0x51
+
+// Instructions
+#define INSTR_HANDSHAKE      0x01
+#define INSTR_GET_SERIAL     0x02
+#define INSTR_INIT_WIFI      0x03
+#define INSTR_SET_SSID       0x04
+#define INSTR_SET_PASSWORD   0x05
+#define INSTR_SET_COUNTRY    0x06
+#define INSTR_MAX            INSTR_SET_COUNTRY  // highest known instruction
+
+// Frame layout: [opcode, length, instruction, payload..., checksum]
+#define FRAME_HEADER_SIZE    3
+#define FRAME_OVERHEAD       4
+#define FRAME_MAX_SIZE       255  // length byte covers the whole frame
+#define FRAME_MAX_PAYLOAD    (FRAME_MAX_SIZE - FRAME_OVERHEAD)
+
+// BLE ATT: MTU before any exchange, and the notify header (opcode + handle)
+#define ATT_MTU_DEFAULT      23
+#define ATT_NOTIFY_OVERHEAD  3